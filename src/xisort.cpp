@@ -2,18 +2,78 @@
 // AUTHOR: FARUK ALPAY
 // ORCID: 0009-0009-2207-6528
 
+#include <algorithm>
 #include <cstdint>
 #include <cstddef>
 #include <atomic>
 #include <cstdio>
 #include <cstring>
+#include <cmath>
+#include <limits>
 #include <vector>
 #include <string>
 #include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <queue>
+#include <functional>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <map>
+#include <filesystem>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define XISORT_COROUTINES 1
+#endif
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+// Order among elements with equal keys (legacy TieBreak). Under STRICT ordering equal
+// keys are bit-identical doubles, so the policy is only observable through
+// xi_argsort(_file); XI_TIE_VALUE additionally switches to key-only records.
+enum XiTieBreak {
+    XI_TIE_INDEX = 0,     // input order (stable), the default
+    XI_TIE_VALUE = 1,     // no tie fields: sort 8-byte keys only, still in input order
+    XI_TIE_RANDOM = 2,    // seeded counter-based hash of the input index
+    XI_TIE_SHUFFLE = 3    // same as RANDOM (legacy only differed in its separate NaN tail)
+};
+
+// "index" / "value" / "random" / "shuffle" → policy
+static inline bool xi_tie_break_parse(const std::string &name, XiTieBreak &t) {
+    static const char *const names[4] = {"index", "value", "random", "shuffle"};
+    for(int i = 0; i < 4; ++i) {
+        if(name == names[i]) {
+            t = (XiTieBreak)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Thrown by a sort that observed cfg.cancel or ran past cfg.timeout_ms
+struct XiCancelled : std::runtime_error {
+    explicit XiCancelled(const char *why = "sort cancelled") : std::runtime_error(why) {}
+};
+
+// Sort order (legacy Mode): STRICT is the IEEE-754 total order of the values;
+// CURVED orders finite values by the metric norm + epsilon * cos(pi * norm), with
+// norm = (x - min) / (max - min) over the finite inputs
+enum XiMode {
+    XI_MODE_STRICT = 0,
+    XI_MODE_CURVED = 1
+};
+
 // Configuration for XiSort behavior
 struct XiSortConfig {
     bool external;
@@ -21,14 +81,196 @@ struct XiSortConfig {
     bool parallel;
     std::size_t mem_limit;
     std::size_t buffer_elems;
+    bool gallop;            // exponential search + bulk copy on one-sided merge stretches
+    bool events;            // record per-thread spans for xi_write_trace_events()
+    XiTieBreak tie_break;
+    uint64_t seed;          // XI_TIE_RANDOM / XI_TIE_SHUFFLE stream
+    XiMode mode;
+    double epsilon;         // CURVED amplitude, 0 <= pi * epsilon < 1
+    std::atomic<bool> *cancel;  // optional: set to true to abort the sort
+    double timeout_ms;          // abort once the call has run this long (0 = no deadline)
+    std::size_t index_stride;   // xi_sort_file: write <out>.xidx with every stride-th key (0 = none)
+    std::string scratch_dir;    // directory for run and spill files (empty = working directory)
     XiSortConfig()
         : external(false), trace(false), parallel(false),
-          mem_limit(SIZE_MAX), buffer_elems((1ULL << 15)) {}
+          mem_limit(SIZE_MAX), buffer_elems((1ULL << 15)), gallop(true), events(false),
+          tie_break(XI_TIE_INDEX), seed(0), mode(XI_MODE_STRICT), epsilon(0.01),
+          cancel(nullptr), timeout_ms(0.0), index_stride(0) {}
+};
+
+// One bin of the Φ(χ) curvature profile: Φ = Σ 1/len over merge segments, where a
+// segment is a maximal stretch taken from the same input, and `elements` counts the
+// elements those merges moved. elements / segments is the mean segment length — long
+// segments (low Φ per element) are what galloping exploits.
+struct XiPhiBin {
+    double phi;
+    long long segments;
+    long long elements;
+};
+
+// File classes of the external pipeline, for per-class I/O accounting
+enum XiFileClass {
+    XI_FILE_INPUT = 0,     // unsorted input read by xi_sort_file / the CLI
+    XI_FILE_RUN = 1,       // run files: written in phase 1 and by merges, read by merges
+    XI_FILE_OUTPUT = 2     // sorted output
+};
+static const int XI_FILE_CLASSES = 3;
+static const int XI_LAT_BUCKETS = 40;
+
+static inline const char *xi_file_class_name(int cls) {
+    static const char *const names[XI_FILE_CLASSES] = {"input", "run", "output"};
+    return (cls >= 0 && cls < XI_FILE_CLASSES) ? names[cls] : "?";
+}
+
+// Latency histogram of one I/O direction of one file class. bucket[b] counts
+// operations that took [2^b, 2^(b+1)) ns; the last bucket also holds anything slower.
+// Latency includes the I/O throttle, i.e. the emulated device time.
+struct XiLatHist {
+    uint64_t ops;
+    uint64_t bytes;
+    double total_ms;
+    double max_ms;
+    uint64_t bucket[XI_LAT_BUCKETS];
+};
+struct XiIoClassStats {
+    XiLatHist read;
+    XiLatHist write;
+};
+
+// Statistics of one xi_sort / xi_sort_file call
+struct XiSortStats {
+    std::size_t runs;          // initial sorted runs written (external paths)
+    std::size_t merge_rounds;  // pairwise rounds, or 1 for the k-way merge
+    double run_ms;             // phase 1: run formation
+    double merge_ms;           // phase 2: merging (incl. final read-back)
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    double io_wait_ms;         // time spent in the I/O throttle
+    uint64_t tail_elems;       // NaN/±inf values placed around the sort instead of merged
+    // Sorter-owned heap (XiCountingAllocator): key arrays, run buffers, stream buffers
+    uint64_t mem_peak_bytes;   // high-water mark during the call
+    uint64_t mem_live_bytes;   // still allocated on return (0 unless leaking)
+    uint64_t mem_allocs;
+    uint64_t mem_frees;
+    XiIoClassStats io[XI_FILE_CLASSES];   // per-class latency histograms, see XiFileClass
+    // Φ(χ) profile (filled only when cfg.trace is set)
+    double phi;                           // Σ of the profile below
+    long long curv_segments;              // segments behind phi
+    std::vector<XiPhiBin> phi_levels;     // [L]: merges whose output length is in (2^(L-1), 2^L]
+    std::vector<XiPhiBin> phi_runs;       // [r]: all in-memory merging inside initial run r
+    std::vector<XiPhiBin> phi_rounds;     // [k]: external merge round k (file merges)
+};
+
+// Shared accumulators behind XiSortStats::io ([class][0 = read, 1 = write]); one
+// relaxed increment per block-sized operation
+struct XiLatAtomic {
+    std::atomic<uint64_t> ops;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> ns;
+    std::atomic<uint64_t> max_ns;
+    std::atomic<uint64_t> bucket[XI_LAT_BUCKETS];
+};
+
+// ─── per-call state ────────────────────────────────────────────────────────────
+// Everything one public call gathers or obeys: its statistics, I/O and heap counters,
+// the Φ(χ) trace, the abort state and a tag that keeps its scratch-file names apart
+// from every other call's. Each entry point owns one (XiCall) and makes it current on
+// its thread; OpenMP regions and helper threads adopt their caller's (XiCallScope).
+// Calls on different threads share nothing, so they run concurrently. I/O and
+// allocations outside any call go to a per-thread ambient state.
+static const int XI_PHI_LEVELS = 64;
+struct XiPhiBins {
+    XiPhiBin level[XI_PHI_LEVELS];
+};
+static std::atomic<uint64_t> xiCallIds(0);
+
+static inline long xi_process_id() {
+#ifdef _WIN32
+    return (long)_getpid();
+#else
+    return (long)getpid();
+#endif
+}
+
+struct XiCallState {
+    uint64_t id;
+    XiSortStats stats = XiSortStats();
+    std::atomic<uint64_t> bytesRead{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<long long> waitNs{0};
+    XiLatAtomic lat[XI_FILE_CLASSES][2] = {};
+    // XiCountingAllocator heap, net of this call's allocations and frees
+    std::atomic<long long> memCurrent{0};
+    std::atomic<long long> memPeak{0};
+    std::atomic<uint64_t> memAllocs{0};
+    std::atomic<uint64_t> memFrees{0};
+    // Φ(χ): one bin set per thread that merged, folded by phi_collect()
+    std::atomic<double> phiTrace{0.0};
+    std::atomic<long long> curvCount{0};
+    std::mutex phiMutex;
+    std::vector<std::unique_ptr<XiPhiBins>> phiBins;
+    // abort state, latched by abort_begin()
+    std::atomic<bool> *abortFlag = nullptr;
+    bool abortArmed = false;        // a flag or a deadline: the fast path tests only this
+    bool abortHasDeadline = false;
+    std::chrono::steady_clock::time_point abortDeadline;
+    int abortFd = -1;               // readable means abort (a dist worker's coordinator link)
+    std::string scratchTag;         // "<pid>_<call id>"
+    XiCallState() : id(++xiCallIds) {
+        scratchTag = std::to_string(xi_process_id()) + "_" + std::to_string(id);
+    }
+    XiCallState(const XiCallState &) = delete;
+    XiCallState &operator=(const XiCallState &) = delete;
+};
+
+static thread_local XiCallState *xiCur = nullptr;
+static thread_local XiSortStats xiLastStats = XiSortStats();
+
+static inline XiCallState &thread_ambient() {
+    static thread_local XiCallState ambient;
+    return ambient;
+}
+
+// State of the call running on this thread (or the thread's ambient state)
+static inline XiCallState &cur_call() {
+    return xiCur ? *xiCur : thread_ambient();
+}
+
+// Makes `cs` current on this thread for the scope: the way OpenMP regions and helper
+// threads join the call that started them
+struct XiCallScope {
+    XiCallState *prev;
+    explicit XiCallScope(XiCallState *cs) : prev(xiCur) { xiCur = cs; }
+    ~XiCallScope() { xiCur = prev; }
+    XiCallScope(const XiCallScope &) = delete;
+    XiCallScope &operator=(const XiCallScope &) = delete;
 };
 
-// Static atomic variables for curvature trace
-static std::atomic<double> phiTrace;
-static std::atomic<long long> curvCount;
+// State of one public call, current on its thread until the call returns; its
+// statistics then become the thread's xi_sort_stats()
+struct XiCall : XiCallState {
+    XiCallScope scope;
+    XiCall() : scope(this) {}
+    ~XiCall() { xiLastStats = std::move(stats); }
+};
+
+// Simulated device for the I/O throttle: every read/write occupies the device for
+// latency + bytes / bandwidth, serialised across threads like a single queue-depth-1
+// disk. Disabled (zero cost) while mb_per_s == 0 and latency_us == 0.
+struct XiIoThrottle {
+    double mb_per_s;
+    double latency_us;
+};
+static XiIoThrottle ioThrottle = {0.0, 0.0};
+static std::mutex ioThrottleMutex;
+static std::chrono::steady_clock::time_point ioDeviceFreeAt;
+
+void xi_set_io_throttle(double mb_per_s, double latency_us) {
+    std::lock_guard<std::mutex> lock(ioThrottleMutex);
+    ioThrottle.mb_per_s = mb_per_s > 0.0 ? mb_per_s : 0.0;
+    ioThrottle.latency_us = latency_us > 0.0 ? latency_us : 0.0;
+    ioDeviceFreeAt = std::chrono::steady_clock::now();
+}
 
 // Convert double to 64-bit key implementing IEEE-754 total order
 static inline uint64_t double_to_key(double x) {
@@ -39,6 +281,103 @@ static inline uint64_t double_to_key(double x) {
     return u ^ mask;
 }
 
+// Inverse of double_to_key
+static inline double key_to_double(uint64_t k) {
+    uint64_t u = (k >> 63) ? (k ^ 0x8000000000000000ULL) : ~k;
+    union { double d; uint64_t u; } conv;
+    conv.u = u;
+    return conv.d;
+}
+
+// Counter-based RNG (splitmix64 at position `ctr` of stream `seed`): any element's
+// draw is computable independently, so results do not depend on thread count
+static inline uint64_t xi_mix64(uint64_t seed, uint64_t ctr) {
+    uint64_t x = seed + (ctr + 1) * 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// a * b + c, fused only where the target fuses in hardware. Every multiply-add of
+// the CURVED metric goes through here, so the compiler has nothing left to contract
+// and the vectorised key pass and the scalar keys of the file merges agree bit-for-bit.
+static inline double xi_madd(double a, double b, double c) {
+#ifdef FP_FAST_FMA
+    return std::fma(a, b, c);
+#else
+    return a * b + c;
+#endif
+}
+
+// cos(pi * t) for t in [0, 1], as sin(pi * u) with u = 1/2 - t: an odd degree-15
+// polynomial in u (Chebyshev fit on |u| <= 1/2). Max abs error below 6e-16, i.e.
+// under 3 ulp of 1; branch-free so `omp simd` loops vectorise it.
+static inline double xi_cospi(double t) {
+    const double u = 0.5 - t;
+    const double s = u * u;
+    double p = -2.1143030125171367e-05;
+    p = xi_madd(p, s, 0.00046599442694486966);
+    p = xi_madd(p, s, -0.00737036658558759);
+    p = xi_madd(p, s, 0.08214587915911954);
+    p = xi_madd(p, s, -0.5992645288539113);
+    p = xi_madd(p, s, 2.5501640398632754);
+    p = xi_madd(p, s, -5.167712780049818);
+    p = xi_madd(p, s, 3.1415926535897927);
+    return u * p;
+}
+
+// Sort-key function: the IEEE total order, or the CURVED metric fixed by one min/max
+// pass over the whole input (the external paths scan before forming runs, so every
+// run and every merge uses the same normalisation)
+struct XiCurve {
+    bool on;
+    double h;       // 1, or 1/2 when max - min overflows
+    double lo_h;    // min * h
+    double inv;     // 1 / ((max - min) * h), 0 for a constant input
+    double eps;
+};
+
+static inline uint64_t xi_key(double x, const XiCurve &c) {
+    if(!c.on) return double_to_key(x);
+    // ±inf and NaN keep their total-order keys, which bracket every finite metric
+    const bool finite = (x - x) == 0.0;
+    const double t = xi_madd(x, c.h, -c.lo_h) * c.inv;
+    const double m = xi_madd(c.eps, xi_cospi(t), t);
+    return double_to_key(finite ? m : x);
+}
+
+// Fused min/max of the finite values in x[0, n), folded into lo/hi
+static void curve_scan(const double *x, std::size_t n, bool parallel, double &lo, double &hi) {
+    (void)parallel;     // only read by the OpenMP clause
+    double l = lo, u = hi;
+    const long long cnt = (long long)n;
+    #pragma omp parallel for simd reduction(min:l) reduction(max:u) if(parallel && cnt >= (1LL << 16))
+    for(long long i = 0; i < cnt; ++i) {
+        const double v = x[i];
+        const bool finite = (v - v) == 0.0;
+        l = (finite && v < l) ? v : l;
+        u = (finite && v > u) ? v : u;
+    }
+    lo = l;
+    hi = u;
+}
+
+static XiCurve curve_make(const XiSortConfig &cfg, double lo, double hi) {
+    XiCurve c = {false, 1.0, 0.0, 0.0, 0.0};
+    if(cfg.mode != XI_MODE_CURVED) return c;
+    c.on = true;
+    c.eps = cfg.epsilon;
+    if(!(lo <= hi)) return c;          // no finite values
+    double span = hi - lo;
+    if(!std::isfinite(span)) {
+        c.h = 0.5;
+        span = hi * 0.5 - lo * 0.5;
+    }
+    c.lo_h = lo * c.h;
+    c.inv = (span > std::numeric_limits<double>::min()) ? 1.0 / span : 0.0;
+    return c;
+}
+
 // Structure representing an element with sorting keys
 struct XiItem {
     uint64_t key;
@@ -56,15 +395,511 @@ static inline void atomic_add_double(std::atomic<double>& atom, double val) {
     } while(!atom.compare_exchange_weak(curr, newVal, std::memory_order_relaxed));
 }
 
-// Merge function for in-memory mergesort (stable merge)
-static void merge_arrays(XiItem *arr, XiItem *aux, std::size_t left, std::size_t mid, std::size_t right, bool trace) {
-    // Copy the segment [left, right] into aux
-    for(std::size_t k = left; k <= right; ++k) {
-        aux[k] = arr[k];
+// Byte and call counters behind XiCountingAllocator, charged to the current call
+static inline void mem_charge(std::size_t bytes) {
+    XiCallState &cs = cur_call();
+    long long cur = cs.memCurrent.fetch_add((long long)bytes, std::memory_order_relaxed) + (long long)bytes;
+    cs.memAllocs.fetch_add(1, std::memory_order_relaxed);
+    long long peak = cs.memPeak.load(std::memory_order_relaxed);
+    while(peak < cur && !cs.memPeak.compare_exchange_weak(peak, cur, std::memory_order_relaxed)) {
+    }
+}
+
+static inline void mem_release(std::size_t bytes) {
+    XiCallState &cs = cur_call();
+    cs.memCurrent.fetch_sub((long long)bytes, std::memory_order_relaxed);
+    cs.memFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Allocator for every large buffer the sorter owns, so xi_sort_stats() can report the
+// real footprint. Storage is left uninitialised by allocate(), like new T[n].
+template<class T>
+struct XiCountingAllocator {
+    typedef T value_type;
+    XiCountingAllocator() {}
+    template<class U> XiCountingAllocator(const XiCountingAllocator<U>&) {}
+    T *allocate(std::size_t n) {
+        T *p = static_cast<T*>(::operator new(n * sizeof(T)));
+        mem_charge(n * sizeof(T));
+        return p;
+    }
+    void deallocate(T *p, std::size_t n) {
+        mem_release(n * sizeof(T));
+        ::operator delete(p);
+    }
+};
+template<class T, class U>
+static inline bool operator==(const XiCountingAllocator<T>&, const XiCountingAllocator<U>&) { return true; }
+template<class T, class U>
+static inline bool operator!=(const XiCountingAllocator<T>&, const XiCountingAllocator<U>&) { return false; }
+
+template<class T>
+using xi_vector = std::vector<T, XiCountingAllocator<T>>;
+
+// File streams whose filebuf buffer comes from the counting allocator. The buffer is
+// a base so it is constructed before and destroyed after the stream (which flushes
+// into it on close); pubsetbuf must precede open().
+static const std::size_t XI_STREAM_BUF = 8192;
+struct XiStreamBuf {
+    xi_vector<char> iobuf;
+    XiStreamBuf() : iobuf(XI_STREAM_BUF) {}
+};
+template<class Stream>
+struct XiFile : XiStreamBuf, Stream {
+    XiFile() {
+        this->rdbuf()->pubsetbuf(iobuf.data(), (std::streamsize)iobuf.size());
+    }
+    XiFile(const std::string &path, std::ios::openmode mode) : XiFile() {
+        this->open(path, mode);
+    }
+};
+typedef XiFile<std::ifstream> XiInFile;
+typedef XiFile<std::ofstream> XiOutFile;
+
+// Φ(χ) accumulators, one per merge level. Every thread that merges for a call gets
+// its own bin set in that call's state (on its first merge), so merge_arrays never
+// touches shared bins; the profile is reduced by phi_collect() once the parallel
+// region has finished.
+static thread_local uint64_t phiBinsCall = 0;
+static thread_local XiPhiBin *phiBinsTL = nullptr;
+
+static inline XiPhiBin *phi_bins() {
+    XiCallState &cs = cur_call();
+    if(phiBinsCall != cs.id) {
+        std::lock_guard<std::mutex> lock(cs.phiMutex);
+        cs.phiBins.emplace_back(new XiPhiBins());
+        phiBinsTL = cs.phiBins.back()->level;
+        phiBinsCall = cs.id;
+    }
+    return phiBinsTL;
+}
+
+static inline int phi_level(std::size_t len) {
+    int lvl = 0;
+    while(lvl < XI_PHI_LEVELS - 1 && ((std::size_t)1 << lvl) < len) {
+        ++lvl;
+    }
+    return lvl;
+}
+
+static inline void phi_add(XiPhiBin &bin, double phi, long long segments, long long elements) {
+    bin.phi += phi;
+    bin.segments += segments;
+    bin.elements += elements;
+}
+
+// Fold the call's per-thread accumulators into its stats.phi_levels (and its trace),
+// clear them, and return the total. Must not run concurrently with the call's merging.
+static XiPhiBin phi_collect() {
+    XiPhiBin total = {0.0, 0, 0};
+    XiCallState &cs = cur_call();
+    std::lock_guard<std::mutex> lock(cs.phiMutex);
+    for(const std::unique_ptr<XiPhiBins> &tl : cs.phiBins) {
+        for(int l = 0; l < XI_PHI_LEVELS; ++l) {
+            XiPhiBin &b = tl->level[l];
+            if(b.segments == 0) {
+                continue;
+            }
+            if(cs.stats.phi_levels.size() <= (std::size_t)l) {
+                cs.stats.phi_levels.resize(l + 1, XiPhiBin{0.0, 0, 0});
+            }
+            phi_add(cs.stats.phi_levels[l], b.phi, b.segments, b.elements);
+            phi_add(total, b.phi, b.segments, b.elements);
+            b = XiPhiBin{0.0, 0, 0};
+        }
+    }
+    atomic_add_double(cs.phiTrace, total.phi);
+    cs.curvCount.fetch_add(total.segments, std::memory_order_relaxed);
+    return total;
+}
+
+// Chrome Trace Event recording (cfg.events). Each thread appends complete ("X")
+// spans to its own buffer without locking; the registry mutex is only taken when a
+// thread first records, when it exits, and by xi_write_trace_events(), which must not
+// run concurrently with a sort.
+struct XiEvent {
+    const char *name;       // string literals only
+    const char *cat;
+    double ts_us;           // relative to eventEpoch
+    double dur_us;
+    const char *arg_name;   // optional single numeric argument
+    long long arg;
+};
+struct XiEventLocal;
+static std::atomic<bool> eventsOn(false);
+static const std::chrono::steady_clock::time_point eventEpoch = std::chrono::steady_clock::now();
+static std::mutex eventRegistryMutex;
+static std::vector<XiEventLocal*> eventRegistry;
+static std::vector<std::pair<int, std::vector<XiEvent>>> eventRetired; // exited threads
+static int eventNextTid = 1;
+struct XiEventLocal {
+    int tid;
+    std::vector<XiEvent> events;
+    XiEventLocal() {
+        std::lock_guard<std::mutex> lock(eventRegistryMutex);
+        tid = eventNextTid++;
+        eventRegistry.push_back(this);
+    }
+    ~XiEventLocal() {
+        std::lock_guard<std::mutex> lock(eventRegistryMutex);
+        if(!events.empty()) {
+            eventRetired.emplace_back(tid, std::move(events));
+        }
+        for(std::size_t i = 0; i < eventRegistry.size(); ++i) {
+            if(eventRegistry[i] == this) {
+                eventRegistry[i] = eventRegistry.back();
+                eventRegistry.pop_back();
+                break;
+            }
+        }
+    }
+};
+static thread_local XiEventLocal eventLocalTL;
+
+static inline double event_now_us() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - eventEpoch).count();
+}
+
+// RAII span: records [construction, destruction) on the calling thread when tracing
+// is on, costs one relaxed load otherwise
+struct XiSpan {
+    const char *name;
+    const char *cat;
+    const char *argName;
+    long long arg;
+    double t0;
+    XiSpan(const char *n, const char *c, const char *an = nullptr, long long a = 0)
+        : name(n), cat(c), argName(an), arg(a),
+          t0(eventsOn.load(std::memory_order_relaxed) ? event_now_us() : -1.0) {}
+    ~XiSpan() {
+        if(t0 >= 0.0) {
+            eventLocalTL.events.push_back(XiEvent{name, cat, t0, event_now_us() - t0, argName, arg});
+        }
+    }
+};
+
+static void events_json_string(std::FILE *f, const char *s) {
+    std::fputc('"', f);
+    for(; *s; ++s) {
+        if(*s == '"' || *s == '\\') std::fputc('\\', f);
+        std::fputc(*s, f);
+    }
+    std::fputc('"', f);
+}
+
+// Discard all recorded events
+void xi_clear_trace_events() {
+    std::lock_guard<std::mutex> lock(eventRegistryMutex);
+    for(XiEventLocal *tl : eventRegistry) {
+        tl->events.clear();
+    }
+    eventRetired.clear();
+}
+
+// Write every event recorded so far (all sorts since the last clear) as Chrome Trace
+// Event JSON, loadable in chrome://tracing and ui.perfetto.dev. Throws std::runtime_error.
+void xi_write_trace_events(const std::string &path) {
+    std::FILE *f = std::fopen(path.c_str(), "w");
+    if(!f) throw std::runtime_error("cannot open trace file " + path);
+    std::lock_guard<std::mutex> lock(eventRegistryMutex);
+    std::vector<std::pair<int, const std::vector<XiEvent>*>> all;
+    for(XiEventLocal *tl : eventRegistry) {
+        all.emplace_back(tl->tid, &tl->events);
+    }
+    for(const auto &r : eventRetired) {
+        all.emplace_back(r.first, &r.second);
+    }
+    std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"xisort\"}}");
+    for(const auto &t : all) {
+        if(t.second->empty()) {
+            continue;
+        }
+        std::fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                        "\"args\":{\"name\":\"xisort-%d\"}}", t.first, t.first);
+        for(const XiEvent &e : *t.second) {
+            std::fprintf(f, ",\n{\"name\":");
+            events_json_string(f, e.name);
+            std::fprintf(f, ",\"cat\":");
+            events_json_string(f, e.cat);
+            std::fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                         t.first, e.ts_us, e.dur_us);
+            if(e.arg_name) {
+                std::fprintf(f, ",\"args\":{");
+                events_json_string(f, e.arg_name);
+                std::fprintf(f, ":%lld}", e.arg);
+            }
+            std::fputc('}', f);
+        }
+    }
+    std::fprintf(f, "\n]}\n");
+    bool ok = !std::ferror(f);
+    ok = (std::fclose(f) == 0) && ok;
+    if(!ok) throw std::runtime_error("I/O error while writing " + path);
+}
+
+// Charge one I/O operation of `bytes` to the simulated device and sleep until it completes
+static void io_throttle(std::size_t bytes) {
+    std::chrono::steady_clock::time_point done;
+    {
+        std::lock_guard<std::mutex> lock(ioThrottleMutex);
+        if(ioThrottle.mb_per_s <= 0.0 && ioThrottle.latency_us <= 0.0) {
+            return;
+        }
+        double us = ioThrottle.latency_us;
+        if(ioThrottle.mb_per_s > 0.0) {
+            us += (double)bytes / ioThrottle.mb_per_s; // 1 MB/s == 1 byte/us
+        }
+        auto now = std::chrono::steady_clock::now();
+        auto start = (ioDeviceFreeAt > now) ? ioDeviceFreeAt : now;
+        done = start + std::chrono::microseconds((long long)us);
+        ioDeviceFreeAt = done;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    std::this_thread::sleep_until(done);
+    cur_call().waitNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - t0).count(),
+                       std::memory_order_relaxed);
+}
+
+static void io_record(XiFileClass cls, int dir, std::size_t bytes, std::chrono::steady_clock::time_point t0) {
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - t0).count();
+    int b = 0;
+    while(b < XI_LAT_BUCKETS - 1 && (ns >> (b + 1)) != 0) {
+        ++b;
+    }
+    XiLatAtomic &h = cur_call().lat[cls][dir];
+    h.ops.fetch_add(1, std::memory_order_relaxed);
+    h.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    h.ns.fetch_add(ns, std::memory_order_relaxed);
+    h.bucket[b].fetch_add(1, std::memory_order_relaxed);
+    uint64_t prev = h.max_ns.load(std::memory_order_relaxed);
+    while(prev < ns && !h.max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+    }
+}
+
+// All file traffic goes through these two wrappers (byte accounting, per-class
+// latency histogram, throttle)
+static std::size_t xi_read(std::ifstream &in, void *dst, std::size_t bytes, XiFileClass cls) {
+    auto t0 = std::chrono::steady_clock::now();
+    in.read(reinterpret_cast<char*>(dst), (std::streamsize)bytes);
+    std::size_t got = (std::size_t)in.gcount();
+    cur_call().bytesRead.fetch_add(got, std::memory_order_relaxed);
+    io_throttle(got);
+    io_record(cls, 0, got, t0);
+    return got;
+}
+
+static void xi_write(std::ofstream &out, const void *src, std::size_t bytes, XiFileClass cls) {
+    auto t0 = std::chrono::steady_clock::now();
+    out.write(reinterpret_cast<const char*>(src), (std::streamsize)bytes);
+    cur_call().bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+    io_throttle(bytes);
+    io_record(cls, 1, bytes, t0);
+}
+
+// Live I/O histograms of one file class on the calling thread: of the call it is
+// running, or, between calls, of its traffic since its last call began
+// (xi_sort_stats().io is the snapshot taken when that call returned)
+XiIoClassStats xi_io_class_stats(XiFileClass cls) {
+    XiIoClassStats st;
+    XiLatHist *dst[2] = {&st.read, &st.write};
+    for(int d = 0; d < 2; ++d) {
+        const XiLatAtomic &h = cur_call().lat[cls][d];
+        dst[d]->ops = h.ops.load(std::memory_order_relaxed);
+        dst[d]->bytes = h.bytes.load(std::memory_order_relaxed);
+        dst[d]->total_ms = (double)h.ns.load(std::memory_order_relaxed) / 1.0e6;
+        dst[d]->max_ms = (double)h.max_ns.load(std::memory_order_relaxed) / 1.0e6;
+        for(int b = 0; b < XI_LAT_BUCKETS; ++b) {
+            dst[d]->bucket[b] = h.bucket[b].load(std::memory_order_relaxed);
+        }
+    }
+    return st;
+}
+
+// Latency (ms) below which a fraction q of the operations completed, resolved to the
+// upper edge of the histogram bucket (and capped by the observed maximum)
+double xi_lat_quantile_ms(const XiLatHist &h, double q) {
+    if(h.ops == 0) {
+        return 0.0;
+    }
+    uint64_t rank = (uint64_t)(q * (double)h.ops);
+    if(rank >= h.ops) rank = h.ops - 1;
+    uint64_t seen = 0;
+    for(int b = 0; b < XI_LAT_BUCKETS; ++b) {
+        seen += h.bucket[b];
+        if(seen > rank) {
+            double edge = (double)((uint64_t)1 << (b + 1)) / 1.0e6;
+            return edge < h.max_ms ? edge : h.max_ms;
+        }
+    }
+    return h.max_ms;
+}
+
+// The call's own counters start at zero (XiCall); what restarts is the thread's
+// traffic between calls, which xi_io_class_stats() reports afterwards
+static void stats_begin() {
+    XiCallState &amb = thread_ambient();
+    amb.bytesRead.store(0, std::memory_order_relaxed);
+    amb.bytesWritten.store(0, std::memory_order_relaxed);
+    amb.waitNs.store(0, std::memory_order_relaxed);
+    for(int c = 0; c < XI_FILE_CLASSES; ++c) {
+        for(XiLatAtomic &h : amb.lat[c]) {
+            h.ops.store(0, std::memory_order_relaxed);
+            h.bytes.store(0, std::memory_order_relaxed);
+            h.ns.store(0, std::memory_order_relaxed);
+            h.max_ns.store(0, std::memory_order_relaxed);
+            for(std::atomic<uint64_t> &b : h.bucket) {
+                b.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+static void stats_end(bool trace) {
+    XiCallState &cs = cur_call();
+    XiSortStats &st = cs.stats;
+    st.phi = trace ? cs.phiTrace.load(std::memory_order_relaxed) : 0.0;
+    st.curv_segments = trace ? cs.curvCount.load(std::memory_order_relaxed) : 0;
+    st.bytes_read = cs.bytesRead.load(std::memory_order_relaxed);
+    st.bytes_written = cs.bytesWritten.load(std::memory_order_relaxed);
+    st.io_wait_ms = (double)cs.waitNs.load(std::memory_order_relaxed) / 1.0e6;
+    // net counts: memory allocated before the call and freed in it does not count
+    const long long peak = cs.memPeak.load(std::memory_order_relaxed);
+    const long long live = cs.memCurrent.load(std::memory_order_relaxed);
+    st.mem_peak_bytes = peak > 0 ? (uint64_t)peak : 0;
+    st.mem_live_bytes = live > 0 ? (uint64_t)live : 0;
+    st.mem_allocs = cs.memAllocs.load(std::memory_order_relaxed);
+    st.mem_frees = cs.memFrees.load(std::memory_order_relaxed);
+    for(int c = 0; c < XI_FILE_CLASSES; ++c) {
+        st.io[c] = xi_io_class_stats((XiFileClass)c);
+    }
+}
+
+static inline double ms_between(std::chrono::steady_clock::time_point t0,
+                                std::chrono::steady_clock::time_point t1) {
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+// Statistics of the most recent sort call made by the calling thread
+XiSortStats xi_sort_stats() {
+    return xiLastStats;
+}
+
+// Merges switch to galloping after this many consecutive wins from one side
+static const long long XI_MIN_GALLOP = 7;
+
+// Length of the prefix [0, n) on which `in` holds (`in` must be monotone: true then
+// false), by exponential then binary search: O(log len) compares for a run of len.
+template <typename Pred>
+static inline std::size_t gallop_prefix(std::size_t n, Pred in) {
+    if(n == 0 || !in(0)) {
+        return 0;
     }
+    std::size_t lo = 0, hi = 1;   // invariant: in(lo); hi == n or !in(hi) once found
+    while(hi < n && in(hi)) {
+        lo = hi;
+        hi = 2 * hi + 1;
+    }
+    if(hi > n) {
+        hi = n;
+    }
+    while(lo + 1 < hi) {
+        std::size_t m = lo + (hi - lo) / 2;
+        if(in(m)) {
+            lo = m;
+        } else {
+            hi = m;
+        }
+    }
+    return hi;
+}
+
+// Stable merge order: key, then tie, then original sequence
+static inline bool item_le(const XiItem &a, const XiItem &b) {
+    return a.key < b.key ||
+           (a.key == b.key && a.tie < b.tie) ||
+           (a.key == b.key && a.tie == b.tie && a.seq <= b.seq);
+}
+
+// Key-only records (XI_TIE_VALUE): equal keys are bit-identical doubles, so the merge
+// needs no tie fields; <= keeps it stable all the same
+static inline bool item_le(uint64_t a, uint64_t b) {
+    return a <= b;
+}
+
+struct XiKeyIdx {
+    uint64_t key;
+    uint64_t idx;
+};
+static inline bool item_le(const XiKeyIdx &a, const XiKeyIdx &b) {
+    return a.key <= b.key;
+}
+
+// ─── cancellation and deadline ──────────────────────────────────────────────
+// Latched from the config into the call's state when a public entry point starts.
+// Polled once per block: a chunk, a buffer refill, or XI_CANCEL_POLL merged elements,
+// in memory or on disk. Tasks of an OpenMP sort and in-memory merges only stop early;
+// the exception is thrown after the parallel region has joined.
+static const int XI_CANCEL_POLL = 1 << 16;
+
+static void abort_begin(const XiSortConfig &cfg) {
+    XiCallState &cs = cur_call();
+    cs.abortFlag = cfg.cancel;
+    cs.abortHasDeadline = cfg.timeout_ms > 0.0;
+    cs.abortArmed = cs.abortFlag || cs.abortHasDeadline;
+    if(cs.abortHasDeadline) {
+        cs.abortDeadline = std::chrono::steady_clock::now()
+                         + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                               std::chrono::duration<double, std::milli>(cfg.timeout_ms));
+    }
+}
+
+static inline bool abort_requested() {
+    const XiCallState &cs = cur_call();
+    if(!cs.abortArmed) return false;
+    if(cs.abortFlag && cs.abortFlag->load(std::memory_order_relaxed)) return true;
+    return cs.abortHasDeadline && std::chrono::steady_clock::now() >= cs.abortDeadline;
+}
+
+static inline void cancel_point() {
+    const XiCallState &cs = cur_call();
+    if(!cs.abortArmed) return;
+    if(cs.abortFlag && cs.abortFlag->load(std::memory_order_relaxed)) throw XiCancelled();
+    if(cs.abortHasDeadline && std::chrono::steady_clock::now() >= cs.abortDeadline)
+        throw XiCancelled("sort deadline exceeded");
+}
+
+// Merge function for in-memory mergesort (stable merge); T is XiItem, XiKeyIdx or a
+// bare uint64_t key
+template <typename T>
+static void merge_arrays(T *arr, T *aux, std::size_t left, std::size_t mid, std::size_t right, bool trace, bool gallop) {
+    if(gallop) {
+        // Whole halves already in order (or swapped): two segments, no element-wise merge
+        const std::size_t lenL = mid - left + 1, lenR = right - mid;
+        bool ordered = item_le(arr[mid], arr[mid + 1]);
+        if(ordered || !item_le(arr[left], arr[right])) {
+            if(!ordered) {
+                std::memcpy(aux + left, arr + left, lenL * sizeof(T));
+                std::memmove(arr + left, arr + mid + 1, lenR * sizeof(T));
+                std::memcpy(arr + left + lenR, aux + left, lenL * sizeof(T));
+            }
+            if(trace) {
+                phi_add(phi_bins()[phi_level(right - left + 1)],
+                        1.0 / (double)lenL + 1.0 / (double)lenR, 2, (long long)(right - left + 1));
+            }
+            return;
+        }
+    }
+    // Copy the segment [left, right] into aux
+    std::memcpy(aux + left, arr + left, (right - left + 1) * sizeof(T));
     std::size_t i = left;
     std::size_t j = mid + 1;
     std::size_t k = left;
+    // next output position that polls for an abort (never reached when none is armed);
+    // an aborted merge leaves arr[left, right] half-written, which callers discard
+    std::size_t pollAt = cur_call().abortArmed ? left + XI_CANCEL_POLL : right + 1;
     // curvature trace local accumulators
     double phiLocal = 0.0;
     long long countLocal = 0;
@@ -72,10 +907,14 @@ static void merge_arrays(XiItem *arr, XiItem *aux, std::size_t left, std::size_t
     long long segLen = 0;
     // Merge two sorted halves, track segments for curvature
     while(i <= mid && j <= right) {
+        if(k >= pollAt) {
+            if(abort_requested()) {
+                return;
+            }
+            pollAt = k + XI_CANCEL_POLL;
+        }
         // Compare keys (with tie-breakers for stability)
-        if(aux[i].key < aux[j].key || 
-           (aux[i].key == aux[j].key && aux[i].tie < aux[j].tie) || 
-           (aux[i].key == aux[j].key && aux[i].tie == aux[j].tie && aux[i].seq <= aux[j].seq)) {
+        if(item_le(aux[i], aux[j])) {
             // Taking element from left half
             if(lastSource != 1) {
                 if(segLen > 0 && trace) {
@@ -88,6 +927,18 @@ static void merge_arrays(XiItem *arr, XiItem *aux, std::size_t left, std::size_t
             }
             arr[k++] = aux[i++];
             ++segLen;
+            // Left keeps winning: gallop to the last left element <= right head
+            if(gallop && segLen >= XI_MIN_GALLOP && i <= mid) {
+                const T &head = aux[j];
+                const T *run = aux + i;
+                std::size_t cnt = gallop_prefix(mid - i + 1, [&](std::size_t t) {
+                    return item_le(run[t], head);
+                });
+                std::memcpy(arr + k, run, cnt * sizeof(T));
+                k += cnt;
+                i += cnt;
+                segLen += (long long)cnt;
+            }
         } else {
             // Taking element from right half
             if(lastSource != 2) {
@@ -100,6 +951,18 @@ static void merge_arrays(XiItem *arr, XiItem *aux, std::size_t left, std::size_t
             }
             arr[k++] = aux[j++];
             ++segLen;
+            // Right keeps winning: gallop to the last right element < left head
+            if(gallop && segLen >= XI_MIN_GALLOP && j <= right) {
+                const T &head = aux[i];
+                const T *run = aux + j;
+                std::size_t cnt = gallop_prefix(right - j + 1, [&](std::size_t t) {
+                    return !item_le(head, run[t]);
+                });
+                std::memcpy(arr + k, run, cnt * sizeof(T));
+                k += cnt;
+                j += cnt;
+                segLen += (long long)cnt;
+            }
         }
     }
     // Append remaining elements from left side (if any)
@@ -115,9 +978,7 @@ static void merge_arrays(XiItem *arr, XiItem *aux, std::size_t left, std::size_t
         long long remaining = (long long)(mid - i + 1);
         segLen += remaining;
         // Copy the remainder of left half
-        while(i <= mid) {
-            arr[k++] = aux[i++];
-        }
+        std::memcpy(arr + k, aux + i, (std::size_t)remaining * sizeof(T));
     }
     // Append remaining elements from right side (if any)
     if(j <= right) {
@@ -131,327 +992,452 @@ static void merge_arrays(XiItem *arr, XiItem *aux, std::size_t left, std::size_t
         }
         long long remaining = (long long)(right - j + 1);
         segLen += remaining;
-        while(j <= right) {
-            arr[k++] = aux[j++];
-        }
+        std::memcpy(arr + k, aux + j, (std::size_t)remaining * sizeof(T));
     }
     // Finalize last segment
     if(segLen > 0 && trace) {
         phiLocal += 1.0 / (double)segLen;
         ++countLocal;
     }
-    // Update global trace accumulators atomically
+    // Update this thread's profile; phi_collect() publishes it
     if(trace) {
-        atomic_add_double(phiTrace, phiLocal);
-        curvCount.fetch_add(countLocal, std::memory_order_relaxed);
+        phi_add(phi_bins()[phi_level(right - left + 1)], phiLocal, countLocal,
+                (long long)(right - left + 1));
     }
 }
 
+// Path of scratch file `index` of kind `stem` for the current call:
+// <stem>_<pid>_<call>_<index>.bin, under cfg.scratch_dir or relative to the working
+// directory. The tag keeps concurrent calls, and processes, apart.
+static std::string scratch_path(const XiSortConfig &cfg, const char *stem, std::size_t index) {
+    const std::string name = std::string(stem) + "_" + cur_call().scratchTag + "_" + std::to_string(index) + ".bin";
+    return cfg.scratch_dir.empty() ? name : (std::filesystem::path(cfg.scratch_dir) / name).string();
+}
+
+// Scratch files of one sort, removed however the sort ends. keep() releases a file
+// that is a result rather than scratch.
+struct XiScratch {
+    std::vector<std::string> paths;
+    void add(const std::string &p) { paths.push_back(p); }
+    void keep(const std::string &p) {
+        paths.erase(std::remove(paths.begin(), paths.end(), p), paths.end());
+    }
+    ~XiScratch() {
+        for(const auto &p : paths) std::remove(p.c_str());
+    }
+};
+
+// Uninitialised array from the counting allocator, released on unwind
+template <class T>
+struct XiArray {
+    XiCountingAllocator<T> alloc;
+    T *p;
+    std::size_t n;
+    explicit XiArray(std::size_t count) : p(alloc.allocate(count)), n(count) {}
+    ~XiArray() { alloc.deallocate(p, n); }
+    XiArray(const XiArray &) = delete;
+    XiArray &operator=(const XiArray &) = delete;
+};
+
 // Recursive mergesort (with optional OpenMP parallel tasks)
-static void merge_sort_rec(XiItem *arr, XiItem *aux, std::size_t left, std::size_t right, bool parallel, std::size_t taskThreshold, bool trace) {
+template <typename T>
+static void merge_sort_rec(T *arr, T *aux, std::size_t left, std::size_t right, bool parallel, std::size_t taskThreshold, bool trace, bool gallop) {
     if(left >= right) {
         return;
     }
+    if(right - left >= (std::size_t)XI_CANCEL_POLL && abort_requested()) {
+        return;
+    }
     std::size_t mid = (left + right) >> 1;
     if(parallel && (right - left + 1) >= taskThreshold) {
         // Parallelize the two recursive sorts using OpenMP tasks
         #pragma omp task shared(arr, aux)
         {
-            merge_sort_rec(arr, aux, left, mid, parallel, taskThreshold, trace);
+            XiSpan span("sort_task", "cpu", "elems", (long long)(mid - left + 1));
+            merge_sort_rec(arr, aux, left, mid, parallel, taskThreshold, trace, gallop);
         }
         #pragma omp task shared(arr, aux)
         {
-            merge_sort_rec(arr, aux, mid + 1, right, parallel, taskThreshold, trace);
+            XiSpan span("sort_task", "cpu", "elems", (long long)(right - mid));
+            merge_sort_rec(arr, aux, mid + 1, right, parallel, taskThreshold, trace, gallop);
         }
         #pragma omp taskwait
     } else {
         // Recurse sequentially
-        merge_sort_rec(arr, aux, left, mid, parallel, taskThreshold, trace);
-        merge_sort_rec(arr, aux, mid + 1, right, parallel, taskThreshold, trace);
-    }
-    merge_arrays(arr, aux, left, mid, right, trace);
-}
-
-// Merge two run files (external merge)
-static void merge_files(const std::string &file1, const std::string &file2, const std::string &outFile, const XiSortConfig &cfg) {
-    std::ifstream fin1(file1, std::ios::binary);
-    std::ifstream fin2(file2, std::ios::binary);
-    std::ofstream fout(outFile, std::ios::binary);
-    // Buffers for reading from files
-    std::size_t bufSize = cfg.buffer_elems;
-    std::vector<XiItem> buffer1(bufSize);
-    std::vector<XiItem> buffer2(bufSize);
-    std::vector<double> outBuffer;
-    outBuffer.reserve(bufSize);
-    bool end1 = false, end2 = false;
-    std::size_t count1 = 0, count2 = 0;
-    // initial fill of both buffers
-    if(fin1.good()) {
-        // read up to buffer_elems doubles from file1
-        std::vector<double> temp(bufSize);
-        fin1.read(reinterpret_cast<char*>(temp.data()), bufSize * sizeof(double));
-        std::size_t readDoubles = fin1.gcount() / sizeof(double);
-        for(std::size_t i = 0; i < readDoubles; ++i) {
-            buffer1[i].value = temp[i];
-            buffer1[i].key = double_to_key(temp[i]);
-            // for external merge, original sequence order is preserved by merge procedure, tie/seq can be zero
-            buffer1[i].tie = 0;
-            buffer1[i].seq = 0;
-        }
-        count1 = readDoubles;
-        if(readDoubles < bufSize) {
-            end1 = true;
-        }
-    } else {
-        end1 = true;
-        count1 = 0;
-    }
-    if(fin2.good()) {
-        std::vector<double> temp(bufSize);
-        fin2.read(reinterpret_cast<char*>(temp.data()), bufSize * sizeof(double));
-        std::size_t readDoubles = fin2.gcount() / sizeof(double);
-        for(std::size_t i = 0; i < readDoubles; ++i) {
-            buffer2[i].value = temp[i];
-            buffer2[i].key = double_to_key(temp[i]);
-            buffer2[i].tie = 0;
-            buffer2[i].seq = 0;
-        }
-        count2 = readDoubles;
-        if(readDoubles < bufSize) {
-            end2 = true;
+        merge_sort_rec(arr, aux, left, mid, parallel, taskThreshold, trace, gallop);
+        merge_sort_rec(arr, aux, mid + 1, right, parallel, taskThreshold, trace, gallop);
+    }
+    if(right - left >= (std::size_t)XI_CANCEL_POLL && abort_requested()) {
+        return;
+    }
+    merge_arrays(arr, aux, left, mid, right, trace, gallop);
+}
+
+// Buffered sequential reader over a run file of doubles (pairwise and k-way merges),
+// or of fixed-size records such as XiGroup
+template <class T>
+struct XiBlockCursor {
+    XiInFile file;
+    xi_vector<T> buffer;
+    std::size_t idx;
+    bool eof;
+};
+typedef XiBlockCursor<double> XiRunCursor;
+
+// Make the cursor's current element available, refilling from disk when the buffer
+// is spent; false once the run is exhausted
+template <class T>
+static bool cursor_ready(XiBlockCursor<T> &r, std::size_t bufElems) {
+    if(r.idx < r.buffer.size()) {
+        return true;
+    }
+    if(r.eof) {
+        return false;
+    }
+    XiSpan span("refill", "io", "bytes", (long long)(bufElems * sizeof(T)));
+    r.buffer.resize(bufElems);
+    std::size_t got = xi_read(r.file, r.buffer.data(), bufElems * sizeof(T), XI_FILE_RUN) / sizeof(T);
+    r.buffer.resize(got);
+    r.idx = 0;
+    r.eof = (got == 0);
+    return !r.eof;
+}
+
+// Every stride-th key of a sorted output, sampled as it is written (the sidecar
+// index of xi_sort_file)
+struct XiFenceSampler {
+    uint64_t stride;
+    uint64_t pos;
+    xi_vector<uint64_t> keys;
+    explicit XiFenceSampler(uint64_t s) : stride(s), pos(0) {}
+    void observe(const double *p, std::size_t n) {
+        for(uint64_t next = (pos + stride - 1) / stride * stride; next < pos + n; next += stride) {
+            keys.push_back(double_to_key(p[next - pos]));
         }
-    } else {
-        end2 = true;
-        count2 = 0;
+        pos += n;
     }
-    // indices into buffers
-    std::size_t idx1 = 0;
-    std::size_t idx2 = 0;
-    double phiLocal = 0.0;
-    long long countLocal = 0;
-    int lastSource = 0;
-    long long segLen = 0;
-    // Merging loop reading from buffers and writing output
-    while(true) {
-        // If either buffer is empty, break to handle remainder outside
-        if(idx1 >= count1 || idx2 >= count2) {
-            // If one file finished and the other still has data buffered, break out to flush remainder
-            break;
-        }
-        // Compare current elements from each buffer
-        XiItem &a = buffer1[idx1];
-        XiItem &b = buffer2[idx2];
-        if(a.key < b.key || (a.key == b.key && a.tie < b.tie) || (a.key == b.key && a.tie == b.tie && a.seq <= b.seq)) {
-            // from buffer1
-            if(lastSource != 1) {
-                if(segLen > 0 && cfg.trace) {
-                    phiLocal += 1.0 / (double)segLen;
-                    ++countLocal;
-                }
-                segLen = 0;
-                lastSource = 1;
-            }
-            outBuffer.push_back(a.value);
-            ++segLen;
-            idx1++;
-            // if buffer1 is exhausted, refill from file1
-            if(idx1 >= count1 && !end1) {
-                std::vector<double> temp(bufSize);
-                fin1.read(reinterpret_cast<char*>(temp.data()), bufSize * sizeof(double));
-                std::size_t readDoubles = fin1.gcount() / sizeof(double);
-                for(std::size_t i = 0; i < readDoubles; ++i) {
-                    buffer1[i].value = temp[i];
-                    buffer1[i].key = double_to_key(temp[i]);
-                    buffer1[i].tie = 0;
-                    buffer1[i].seq = 0;
-                }
-                count1 = readDoubles;
-                idx1 = 0;
-                if(readDoubles < bufSize) {
-                    end1 = true;
-                }
-            }
-        } else {
-            // from buffer2
-            if(lastSource != 2) {
-                if(segLen > 0 && cfg.trace) {
-                    phiLocal += 1.0 / (double)segLen;
-                    ++countLocal;
-                }
-                segLen = 0;
-                lastSource = 2;
-            }
-            outBuffer.push_back(b.value);
-            ++segLen;
-            idx2++;
-            if(idx2 >= count2 && !end2) {
-                std::vector<double> temp(bufSize);
-                fin2.read(reinterpret_cast<char*>(temp.data()), bufSize * sizeof(double));
-                std::size_t readDoubles = fin2.gcount() / sizeof(double);
-                for(std::size_t i = 0; i < readDoubles; ++i) {
-                    buffer2[i].value = temp[i];
-                    buffer2[i].key = double_to_key(temp[i]);
-                    buffer2[i].tie = 0;
-                    buffer2[i].seq = 0;
-                }
-                count2 = readDoubles;
-                idx2 = 0;
-                if(readDoubles < bufSize) {
-                    end2 = true;
-                }
-            }
+};
+
+// Output side of the file merges: stages elements (doubles, or record bytes) and writes
+// whole blocks; blocks at least a buffer long (galloped stretches) bypass the staging copy
+template <class T>
+struct XiBlockWriter {
+    std::ofstream &file;
+    xi_vector<T> buf;
+    std::size_t cap;
+    XiFileClass cls;
+    XiFenceSampler *fences;     // optional, doubles only
+    XiBlockWriter(std::ofstream &f, std::size_t bufElems, XiFileClass c)
+        : file(f), cap(bufElems ? bufElems : 1), cls(c), fences(nullptr) {
+        buf.reserve(cap);
+    }
+    void put(const T *p, std::size_t n) {
+        if constexpr(std::is_same<T, double>::value) {
+            if(fences) fences->observe(p, n);
         }
-        // Flush output buffer if full
-        if(outBuffer.size() >= bufSize) {
-            fout.write(reinterpret_cast<char*>(outBuffer.data()), outBuffer.size() * sizeof(double));
-            outBuffer.clear();
+        if(buf.empty() && n >= cap) {
+            xi_write(file, p, n * sizeof(T), cls);
+            return;
         }
-    }
-    // Output any remaining elements from buffer1 or buffer2 (whichever still has data)
-    if(idx1 < count1 || !end1) {
-        // flush any pending segment from other source
-        if(lastSource != 1) {
-            if(segLen > 0 && cfg.trace) {
-                phiLocal += 1.0 / (double)segLen;
-                ++countLocal;
-            }
-            segLen = 0;
-            lastSource = 1;
-        }
-        // Write out remaining in current buffer1
-        while(idx1 < count1) {
-            outBuffer.push_back(buffer1[idx1++].value);
-            ++segLen;
-            if(outBuffer.size() >= bufSize) {
-                fout.write(reinterpret_cast<char*>(outBuffer.data()), outBuffer.size() * sizeof(double));
-                outBuffer.clear();
-            }
-        }
-        // Read and output the rest of file1 beyond current buffer
-        while(!end1) {
-            std::vector<double> temp(bufSize);
-            fin1.read(reinterpret_cast<char*>(temp.data()), bufSize * sizeof(double));
-            std::size_t readDoubles = fin1.gcount() / sizeof(double);
-            if(readDoubles == 0) {
-                end1 = true;
-                break;
-            }
-            for(std::size_t t = 0; t < readDoubles; ++t) {
-                outBuffer.push_back(temp[t]);
-                ++segLen;
-                if(outBuffer.size() >= bufSize) {
-                    fout.write(reinterpret_cast<char*>(outBuffer.data()), outBuffer.size() * sizeof(double));
-                    outBuffer.clear();
-                }
-            }
-            if(readDoubles < bufSize) {
-                end1 = true;
+        while(n) {
+            std::size_t c = (n < cap - buf.size()) ? n : cap - buf.size();
+            buf.insert(buf.end(), p, p + c);
+            p += c;
+            n -= c;
+            if(buf.size() == cap) {
+                flush();
             }
         }
     }
-    if(idx2 < count2 || !end2) {
-        if(lastSource != 2) {
-            if(segLen > 0 && cfg.trace) {
-                phiLocal += 1.0 / (double)segLen;
-                ++countLocal;
-            }
-            segLen = 0;
-            lastSource = 2;
+    void flush() {
+        if(!buf.empty()) {
+            xi_write(file, buf.data(), buf.size() * sizeof(T), cls);
+            buf.clear();
         }
-        while(idx2 < count2) {
-            outBuffer.push_back(buffer2[idx2++].value);
-            ++segLen;
-            if(outBuffer.size() >= bufSize) {
-                fout.write(reinterpret_cast<char*>(outBuffer.data()), outBuffer.size() * sizeof(double));
-                outBuffer.clear();
-            }
+    }
+};
+typedef XiBlockWriter<double> XiRunWriter;
+
+// Write `count` copies of the value whose key is `key`
+static void put_repeated(XiRunWriter &out, uint64_t key, uint64_t count) {
+    double rep[512];
+    const double v = key_to_double(key);
+    for(double &d : rep) d = v;
+    while(count) {
+        std::size_t c = (count < 512) ? (std::size_t)count : 512;
+        out.put(rep, c);
+        count -= c;
+    }
+}
+
+// Φ(χ) segment bookkeeping for the file merges: a segment is a maximal stretch of
+// output taken from the same source
+struct XiSegTracker {
+    double phi;
+    long long segments;
+    long long segLen;
+    std::size_t last;
+    XiSegTracker() : phi(0.0), segments(0), segLen(0), last(SIZE_MAX) {}
+    void take(std::size_t src, long long cnt) {
+        if(src != last) {
+            close();
+            last = src;
         }
-        while(!end2) {
-            std::vector<double> temp(bufSize);
-            fin2.read(reinterpret_cast<char*>(temp.data()), bufSize * sizeof(double));
-            std::size_t readDoubles = fin2.gcount() / sizeof(double);
-            if(readDoubles == 0) {
-                end2 = true;
-                break;
-            }
-            for(std::size_t t = 0; t < readDoubles; ++t) {
-                outBuffer.push_back(temp[t]);
-                ++segLen;
-                if(outBuffer.size() >= bufSize) {
-                    fout.write(reinterpret_cast<char*>(outBuffer.data()), outBuffer.size() * sizeof(double));
-                    outBuffer.clear();
-                }
-            }
-            if(readDoubles < bufSize) {
-                end2 = true;
-            }
+        segLen += cnt;
+    }
+    void close() {
+        if(segLen > 0) {
+            phi += 1.0 / (double)segLen;
+            ++segments;
         }
+        segLen = 0;
     }
-    // flush any remaining output buffer
-    if(!outBuffer.empty()) {
-        fout.write(reinterpret_cast<char*>(outBuffer.data()), outBuffer.size() * sizeof(double));
-        outBuffer.clear();
+};
+
+// Merge two run files (external merge). Ties go to file1, the earlier run.
+static void merge_files(const std::string &file1, const std::string &file2, const std::string &outFile, const XiSortConfig &cfg, const XiCurve &curve, XiPhiBin *round) {
+    XiSpan span("merge_pair", "merge");
+    const std::size_t bufSize = cfg.buffer_elems ? cfg.buffer_elems : 1;
+    XiRunCursor src[2];
+    src[0].file.open(file1, std::ios::binary);
+    src[1].file.open(file2, std::ios::binary);
+    for(XiRunCursor &c : src) {
+        c.idx = 0;
+        c.eof = !c.file.good();
     }
-    // finalize last segment in curvature trace
-    if(segLen > 0 && cfg.trace) {
-        phiLocal += 1.0 / (double)segLen;
-        ++countLocal;
+    XiOutFile fout(outFile, std::ios::binary);
+    XiRunWriter out(fout, bufSize, XI_FILE_RUN);
+    XiSegTracker seg;
+    long long elemCount = 0;
+    int poll = XI_CANCEL_POLL;
+    // Merge while both runs have data
+    while(cursor_ready(src[0], bufSize) && cursor_ready(src[1], bufSize)) {
+        if(--poll == 0) {
+            poll = XI_CANCEL_POLL;
+            cancel_point();
+        }
+        const uint64_t k0 = xi_key(src[0].buffer[src[0].idx], curve);
+        const uint64_t k1 = xi_key(src[1].buffer[src[1].idx], curve);
+        const std::size_t w = (k0 <= k1) ? 0 : 1;
+        XiRunCursor &c = src[w];
+        out.put(&c.buffer[c.idx], 1);
+        ++c.idx;
+        seg.take(w, 1);
+        ++elemCount;
+        // One side keeps winning: bulk-copy its buffered stretch that still precedes
+        // the other head (<= for file1, < for file2 keeps the merge stable)
+        if(cfg.gallop && seg.segLen >= XI_MIN_GALLOP && c.idx < c.buffer.size()) {
+            const uint64_t other = (w == 0) ? k1 : k0;
+            const double *run = c.buffer.data() + c.idx;
+            std::size_t cnt = gallop_prefix(c.buffer.size() - c.idx, [&](std::size_t t) {
+                uint64_t k = xi_key(run[t], curve);
+                return (w == 0) ? k <= other : k < other;
+            });
+            out.put(run, cnt);
+            c.idx += cnt;
+            seg.take(w, (long long)cnt);
+            elemCount += (long long)cnt;
+        }
     }
+    // Output whatever remains of the run that is not exhausted
+    for(std::size_t w = 0; w < 2; ++w) {
+        XiRunCursor &c = src[w];
+        while(cursor_ready(c, bufSize)) {
+            cancel_point();
+            std::size_t cnt = c.buffer.size() - c.idx;
+            out.put(c.buffer.data() + c.idx, cnt);
+            c.idx += cnt;
+            seg.take(w, (long long)cnt);
+            elemCount += (long long)cnt;
+        }
+    }
+    out.flush();
+    seg.close();
     // Close files
-    fin1.close();
-    fin2.close();
+    src[0].file.close();
+    src[1].file.close();
     fout.close();
     // update curvature trace
     if(cfg.trace) {
-        atomic_add_double(phiTrace, phiLocal);
-        curvCount.fetch_add(countLocal, std::memory_order_relaxed);
+        atomic_add_double(cur_call().phiTrace, seg.phi);
+        cur_call().curvCount.fetch_add(seg.segments, std::memory_order_relaxed);
+        phi_add(*round, seg.phi, seg.segments, elemCount);
     }
 }
 
-// Main sorting function
-void xi_sort(double *data, uint64_t n, const XiSortConfig &cfg) {
-    if(n == 0) {
-        return;
-    }
-    // Initialize trace accumulators
-    if(cfg.trace) {
-        phiTrace.store(0.0, std::memory_order_relaxed);
-        curvCount.store(0, std::memory_order_relaxed);
+static void curve_check(const XiSortConfig &cfg) {
+    if(cfg.mode == XI_MODE_CURVED && !(cfg.epsilon >= 0.0 && cfg.epsilon * 3.141592653589793 < 1.0))
+        throw std::runtime_error("epsilon out of range (need 0 <= pi * epsilon < 1)");
+}
+
+// Curve for an in-memory array
+static XiCurve curve_for(const double *data, std::size_t n, const XiSortConfig &cfg) {
+    double lo = std::numeric_limits<double>::infinity(), hi = -lo;
+    if(cfg.mode == XI_MODE_CURVED) {
+        XiSpan span("minmax_scan", "cpu", "elems", (long long)n);
+        curve_scan(data, n, cfg.parallel, lo, hi);
     }
-    if(!cfg.external && n * sizeof(double) <= cfg.mem_limit) {
-        // In-memory sorting
-        // Allocate structures for keys and perform mergesort
-        std::size_t N = (std::size_t)n;
-        XiItem *arr = new XiItem[N];
-        XiItem *aux = new XiItem[N];
-        for(std::size_t i = 0; i < N; ++i) {
-            arr[i].value = data[i];
-            arr[i].key = double_to_key(data[i]);
-            arr[i].tie = (uint64_t)i;
-            arr[i].seq = (uint64_t)i;
-        }
-        // Determine task size threshold for parallel mergesort
-        std::size_t taskThreshold = 1ULL << 15; // e.g., 32768
-        if(cfg.parallel) {
-            // Parallel mergesort using OpenMP
-            #pragma omp parallel
+    return curve_make(cfg, lo, hi);
+}
+
+// Tie field of the element with input index `idx` under cfg.tie_break
+static inline uint64_t tie_of(const XiSortConfig &cfg, uint64_t idx) {
+    return (cfg.tie_break == XI_TIE_RANDOM || cfg.tie_break == XI_TIE_SHUFFLE)
+               ? xi_mix64(cfg.seed, idx) : idx;
+}
+
+template <typename T>
+static void run_merge_sort(T *arr, T *aux, std::size_t N, bool parallel, const XiSortConfig &cfg) {
+    // Determine task size threshold for parallel mergesort
+    const std::size_t taskThreshold = 1ULL << 15; // e.g., 32768
+    if(parallel) {
+        // Parallel mergesort using OpenMP; the team polls and traces for this call
+        XiCallState *cs = &cur_call();
+        #pragma omp parallel
+        {
+            XiCallScope scope(cs);
+            #pragma omp single nowait
             {
-                #pragma omp single nowait
-                {
-                    merge_sort_rec(arr, aux, 0, N - 1, true, taskThreshold, cfg.trace);
-                }
+                merge_sort_rec(arr, aux, 0, N - 1, true, taskThreshold, cfg.trace, cfg.gallop);
             }
-        } else {
-            merge_sort_rec(arr, aux, 0, N - 1, false, taskThreshold, cfg.trace);
         }
-        // Copy sorted values back to original array
+    } else {
+        merge_sort_rec(arr, aux, 0, N - 1, false, taskThreshold, cfg.trace, cfg.gallop);
+    }
+}
+
+// Sort data[0, N) in place in memory; `base` is the input index of data[0]. Key-only
+// (XI_TIE_VALUE) moves 8-byte keys instead of 32-byte XiItems; output and Φ(χ) are
+// the same, since a <= merge of keys orders equal keys exactly like index ties do.
+static void sort_block(double *data, std::size_t N, uint64_t base, const XiSortConfig &cfg,
+                       const XiCurve &curve, bool parallel) {
+    // An abort leaves data[0, N) untouched: it is only written once the sort completed
+    if(cfg.tie_break == XI_TIE_VALUE && curve.on) {
+        // the metric key does not determine the value: carry its bits alongside
+        XiArray<XiKeyIdx> arr(N), aux(N);
+        const long long cnt = (long long)N;
+        #pragma omp parallel for simd if(parallel && cnt >= (1LL << 16))
+        for(long long i = 0; i < cnt; ++i) {
+            arr.p[i].key = xi_key(data[i], curve);
+            arr.p[i].idx = double_to_key(data[i]);
+        }
+        run_merge_sort(arr.p, aux.p, N, parallel, cfg);
+        cancel_point();
+        for(std::size_t i = 0; i < N; ++i) {
+            data[i] = key_to_double(arr.p[i].idx);
+        }
+        return;
+    }
+    if(cfg.tie_break == XI_TIE_VALUE) {
+        XiArray<uint64_t> keys(N), aux(N);
+        for(std::size_t i = 0; i < N; ++i) {
+            keys.p[i] = double_to_key(data[i]);
+        }
+        run_merge_sort(keys.p, aux.p, N, parallel, cfg);
+        cancel_point();
         for(std::size_t i = 0; i < N; ++i) {
-            data[i] = arr[i].value;
+            data[i] = key_to_double(keys.p[i]);
+        }
+        return;
+    }
+    XiArray<XiItem> arr(N), aux(N);
+    const long long cnt = (long long)N;
+    #pragma omp parallel for simd if(parallel && curve.on && cnt >= (1LL << 16))
+    for(long long i = 0; i < cnt; ++i) {
+        arr.p[i].value = data[i];
+        arr.p[i].key = xi_key(data[i], curve);
+        arr.p[i].tie = tie_of(cfg, base + i);
+        arr.p[i].seq = base + i;
+    }
+    run_merge_sort(arr.p, aux.p, N, parallel, cfg);
+    cancel_point();
+    // Copy sorted values back to original array
+    for(std::size_t i = 0; i < N; ++i) {
+        data[i] = arr.p[i].value;
+    }
+}
+
+// ─── non-finite tail ───────────────────────────────────────────────────────
+// NaN and ±inf never need a comparison against finite values: in the total order
+// -NaN and -inf come before every finite key and +inf and +NaN after. They are split
+// off before sorting, and only the tail keys are sorted among themselves (NaN
+// payloads). The tail is then written around the sorted finite values.
+
+// Move the finite values of data[0, n) to its front, in order, and append the keys of
+// the others to `tail`. Returns the finite count. A read-only vectorised scan (split
+// across threads with `parallel`) finds the first block holding a non-finite value;
+// all-finite input, the common case, stops there. The compaction starts at that block
+// and is branch-free: every value is stored to both outputs and only the matching
+// cursor advances.
+static std::size_t split_nonfinite(double *data, std::size_t n, xi_vector<uint64_t> &tail, bool parallel) {
+    XiSpan span("split_nonfinite", "cpu", "elems", (long long)n);
+    const std::size_t BLK = 1024;
+    const long long blocks = (long long)((n + BLK - 1) / BLK);
+    (void)parallel;     // only read by the OpenMP clause
+    long long first = blocks;
+    #pragma omp parallel for reduction(min:first) if(parallel && blocks >= 64)
+    for(long long b = 0; b < blocks; ++b) {
+        const std::size_t lo = (std::size_t)b * BLK;
+        const std::size_t hi = (n - lo < BLK) ? n : lo + BLK;
+        int bad = 0;
+        #pragma omp simd reduction(|:bad)
+        for(std::size_t i = lo; i < hi; ++i) {
+            bad |= (data[i] - data[i]) != 0.0;
+        }
+        if(bad && b < first) first = b;
+    }
+    if(first == blocks) return n;
+    uint64_t blk[BLK];
+    std::size_t j = (std::size_t)first * BLK, t = 0;
+    for(std::size_t i = j; i < n; ++i) {
+        const double x = data[i];
+        const bool finite = (x - x) == 0.0;
+        data[j] = x;
+        blk[t] = double_to_key(x);
+        j += finite;
+        t += !finite;
+        if(t == BLK) {
+            tail.insert(tail.end(), blk, blk + t);
+            t = 0;
+        }
+    }
+    tail.insert(tail.end(), blk, blk + t);
+    return j;
+}
+
+// Sort the non-finite tail keys; an abort throws and leaves `tail` as it was
+static void sort_tail(xi_vector<uint64_t> &tail, const XiSortConfig &cfg) {
+    if(tail.size() < 2) return;
+    XiSortConfig tcfg = cfg;
+    tcfg.trace = false;
+    xi_vector<uint64_t> keys(tail), aux(tail.size());
+    run_merge_sort(keys.data(), aux.data(), keys.size(), false, tcfg);
+    cancel_point();
+    tail.swap(keys);
+}
+
+// Tail keys below this belong to -NaN / -inf and precede the finite values
+static const uint64_t XI_KEY_FINITE_MIN = 0x8000000000000000ULL;
+
+// Sorting core shared by xi_sort and xi_sort_file (does not reset trace or stats);
+// `base` is the input index of data[0].
+// Returns the Φ(χ) total of the in-memory merging it performed.
+static XiPhiBin xi_sort_impl(double *data, uint64_t n, uint64_t base, const XiSortConfig &cfg, const XiCurve &curve) {
+    XiPhiBin phiTotal = {0.0, 0, 0};
+    if(n == 0) {
+        return phiTotal;
+    }
+    if(!cfg.external && n * sizeof(double) <= cfg.mem_limit) {
+        // In-memory sorting
+        XiSpan span("sort", "cpu", "elems", (long long)n);
+        sort_block(data, (std::size_t)n, base, cfg, curve, cfg.parallel);
+        if(cfg.trace) {
+            phiTotal = phi_collect();
         }
-        delete [] arr;
-        delete [] aux;
     } else {
         // External sorting
+        auto tRuns = std::chrono::steady_clock::now();
+        XiScratch scratch;
         std::vector<std::string> runs;
         runs.reserve((n / (cfg.mem_limit/sizeof(double))) + 1);
         std::size_t N = (std::size_t)n;
@@ -461,47 +1447,51 @@ void xi_sort(double *data, uint64_t n, const XiSortConfig &cfg) {
         std::size_t offset = 0;
         int runCount = 0;
         while(offset < N) {
+            cancel_point();
             std::size_t chunkSize = (N - offset < maxElems) ? (N - offset) : maxElems;
-            // Allocate chunk array
-            XiItem *arr = new XiItem[chunkSize];
-            XiItem *aux = new XiItem[chunkSize];
-            for(std::size_t i = 0; i < chunkSize; ++i) {
-                arr[i].value = data[offset + i];
-                arr[i].key = double_to_key(data[offset + i]);
-                arr[i].tie = (uint64_t)(offset + i);
-                arr[i].seq = (uint64_t)(offset + i);
-            }
-            // Sort this run (using single-threaded mergesort for simplicity)
-            merge_sort_rec(arr, aux, 0, chunkSize - 1, false, 1ULL<<15, cfg.trace);
-            // Write this run to file
-            char filename[64];
-            std::sprintf(filename, "xisort_run_%d.bin", runCount++);
-            std::ofstream fout(filename, std::ios::binary);
-            for(std::size_t i = 0; i < chunkSize; ++i) {
-                double val = arr[i].value;
-                fout.write(reinterpret_cast<char*>(&val), sizeof(double));
+            // Sort this run in place (single-threaded mergesort for simplicity)
+            {
+                XiSpan span("run_sort", "cpu", "run", runCount);
+                sort_block(data + offset, chunkSize, base + offset, cfg, curve, false);
+            }
+            if(cfg.trace) {
+                XiPhiBin runPhi = phi_collect();
+                cur_call().stats.phi_runs.push_back(runPhi);
+                phi_add(phiTotal, runPhi.phi, runPhi.segments, runPhi.elements);
             }
+            // Write this run to file from its own slice of data, which is
+            // overwritten by the final read-back anyway
+            XiSpan wspan("run_write", "io", "run", runCount);
+            const std::string filename = scratch_path(cfg, "xisort_run", runCount++);
+            scratch.add(filename);
+            XiOutFile fout(filename, std::ios::binary);
+            xi_write(fout, data + offset, chunkSize * sizeof(double), XI_FILE_RUN);
             fout.close();
-            runs.push_back(std::string(filename));
-            delete [] arr;
-            delete [] aux;
+            runs.push_back(filename);
             offset += chunkSize;
         }
+        cur_call().stats.runs += runs.size();
+        auto tMerge = std::chrono::steady_clock::now();
+        cur_call().stats.run_ms += ms_between(tRuns, tMerge);
         // Iteratively merge runs until one sorted run remains
         while(runs.size() > 1) {
+            ++cur_call().stats.merge_rounds;
+            XiSpan span("merge_round", "merge", "round", (long long)cur_call().stats.merge_rounds);
+            cur_call().stats.phi_rounds.push_back(XiPhiBin{0.0, 0, 0});
             std::vector<std::string> newRuns;
             newRuns.reserve((runs.size() / 2) + 1);
             for(std::size_t i = 0; i + 1 < runs.size(); i += 2) {
+                cancel_point();
                 std::string fileA = runs[i];
                 std::string fileB = runs[i+1];
-                char outName[64];
-                std::sprintf(outName, "xisort_run_%d.bin", runCount++);
+                const std::string outName = scratch_path(cfg, "xisort_run", runCount++);
+                scratch.add(outName);
                 // Merge fileA and fileB into outName
-                merge_files(fileA, fileB, outName, cfg);
+                merge_files(fileA, fileB, outName, cfg, curve, &cur_call().stats.phi_rounds.back());
                 // Remove merged input files
                 std::remove(fileA.c_str());
                 std::remove(fileB.c_str());
-                newRuns.push_back(std::string(outName));
+                newRuns.push_back(outName);
             }
             if(runs.size() % 2 == 1) {
                 // If odd number of runs, carry the last one to next round
@@ -512,14 +1502,14 @@ void xi_sort(double *data, uint64_t n, const XiSortConfig &cfg) {
         // Now runs[0] is the final sorted file
         if(!runs.empty()) {
             // Load final sorted data back into memory
-            std::ifstream fin(runs[0], std::ios::binary);
+            XiSpan span("read_back", "io");
+            XiInFile fin(runs[0], std::ios::binary);
             std::size_t index = 0;
             const std::size_t bufElems = cfg.buffer_elems;
-            std::vector<double> buffer(bufElems);
+            xi_vector<double> buffer(bufElems);
             while(index < (std::size_t)n) {
                 std::size_t toRead = ((std::size_t)n - index < bufElems) ? (std::size_t)n - index : bufElems;
-                fin.read(reinterpret_cast<char*>(buffer.data()), toRead * sizeof(double));
-                std::size_t got = fin.gcount() / sizeof(double);
+                std::size_t got = xi_read(fin, buffer.data(), toRead * sizeof(double), XI_FILE_RUN) / sizeof(double);
                 for(std::size_t j = 0; j < got; ++j) {
                     data[index++] = buffer[j];
                 }
@@ -531,5 +1521,2273 @@ void xi_sort(double *data, uint64_t n, const XiSortConfig &cfg) {
             // Remove final run file
             std::remove(runs[0].c_str());
         }
+        cur_call().stats.merge_ms += ms_between(tMerge, std::chrono::steady_clock::now());
+    }
+    return phiTotal;
+}
+
+// Main sorting function. Throws std::runtime_error (CURVED epsilon out of range,
+// external-mode I/O errors).
+void xi_sort(double *data, uint64_t n, const XiSortConfig &cfg) {
+    XiCall call;
+    curve_check(cfg);
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_sort", "sort", "elems", (long long)n);
+    {
+        xi_vector<uint64_t> tail;
+        const std::size_t nf = split_nonfinite(data, (std::size_t)n, tail, cfg.parallel);
+        try {
+            xi_sort_impl(data, nf, 0, cfg, curve_for(data, nf, cfg));
+            sort_tail(tail, cfg);
+        } catch(...) {
+            // leave a permutation of the input behind
+            for(std::size_t i = 0; i < tail.size(); ++i) {
+                data[nf + i] = key_to_double(tail[i]);
+            }
+            throw;
+        }
+        if(!tail.empty()) {
+            const std::size_t low = std::lower_bound(tail.begin(), tail.end(), XI_KEY_FINITE_MIN) - tail.begin();
+            std::memmove(data + low, data, nf * sizeof(double));
+            for(std::size_t i = 0; i < low; ++i) {
+                data[i] = key_to_double(tail[i]);
+            }
+            for(std::size_t i = low; i < tail.size(); ++i) {
+                data[nf + i] = key_to_double(tail[i]);
+            }
+        }
+        cur_call().stats.tail_elems = tail.size();
+    }
+    stats_end(cfg.trace);
+}
+
+// Indirect in-memory sort: perm[r] receives the input index of the element of rank r.
+// Ties follow cfg.tie_break (XI_TIE_VALUE sorts 16-byte key/index pairs, which the
+// <= merge keeps in input order). Throws std::runtime_error for cfg.external.
+void xi_argsort(const double *data, uint64_t n, uint64_t *perm, const XiSortConfig &cfg) {
+    XiCall call;
+    if(cfg.external) throw std::runtime_error("xi_argsort is in-memory only");
+    curve_check(cfg);
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_argsort", "sort", "elems", (long long)n);
+    const std::size_t N = (std::size_t)n;
+    const XiCurve curve = curve_for(data, N, cfg);
+    if(N > 0 && cfg.tie_break == XI_TIE_VALUE) {
+        XiArray<XiKeyIdx> arr(N), aux(N);
+        for(std::size_t i = 0; i < N; ++i) {
+            arr.p[i].key = xi_key(data[i], curve);
+            arr.p[i].idx = i;
+        }
+        run_merge_sort(arr.p, aux.p, N, cfg.parallel, cfg);
+        cancel_point();
+        for(std::size_t i = 0; i < N; ++i) {
+            perm[i] = arr.p[i].idx;
+        }
+    } else if(N > 0) {
+        XiArray<XiItem> arr(N), aux(N);
+        for(std::size_t i = 0; i < N; ++i) {
+            arr.p[i].value = data[i];
+            arr.p[i].key = xi_key(data[i], curve);
+            arr.p[i].tie = tie_of(cfg, i);
+            arr.p[i].seq = i;
+        }
+        run_merge_sort(arr.p, aux.p, N, cfg.parallel, cfg);
+        cancel_point();
+        for(std::size_t i = 0; i < N; ++i) {
+            perm[i] = arr.p[i].seq;
+        }
+    }
+    if(cfg.trace) {
+        phi_collect();
+    }
+    stats_end(cfg.trace);
+}
+
+// k-way merge heap entry for xi_sort_file
+struct XiHeapItem {
+    uint64_t key;
+    std::size_t run_id;
+    // ties go to the lower run id, which holds the earlier input chunk (stable)
+    bool operator>(const XiHeapItem &o) const {
+        return key > o.key || (key == o.key && run_id > o.run_id);
+    }
+    bool operator<(const XiHeapItem &o) const {
+        return key < o.key || (key == o.key && run_id < o.run_id);
+    }
+};
+
+// Curve for an input file. CURVED: one pre-scan of the input fixes min/max before any
+// run is formed, then the stream is rewound; `buf` is the chunk buffer.
+static XiCurve curve_for_file(XiInFile &fin, uint64_t total_elems, xi_vector<double> &buf,
+                              const XiSortConfig &cfg, const std::string &in_path) {
+    double lo = std::numeric_limits<double>::infinity(), hi = -lo;
+    if(cfg.mode == XI_MODE_CURVED) {
+        const std::streampos start = fin.tellg();
+        XiSpan span("minmax_scan", "io", "elems", (long long)total_elems);
+        for(uint64_t left = total_elems; left; ) {
+            cancel_point();
+            std::size_t chunk = (left < buf.size()) ? (std::size_t)left : buf.size();
+            if(xi_read(fin, buf.data(), chunk * sizeof(double), XI_FILE_INPUT) != chunk * sizeof(double))
+                throw std::runtime_error("I/O error while reading " + in_path);
+            curve_scan(buf.data(), chunk, cfg.parallel, lo, hi);
+            left -= chunk;
+        }
+        fin.clear();
+        fin.seekg(start);
+    }
+    return curve_make(cfg, lo, hi);
+}
+
+// ─── sparse index sidecar ──────────────────────────────────────────────────────
+// <out>.xidx: an XiIndexHeader, then the key of every stride-th element of the sorted
+// file. XiSortedFile keeps the keys in memory, so a bound costs one block read.
+static const char *const XI_INDEX_SUFFIX = ".xidx";
+static const char XI_INDEX_MAGIC[8] = {'X', 'I', 'D', 'X', '1', 0, 0, 0};
+
+struct XiIndexHeader {
+    char magic[8];
+    uint64_t elems;
+    uint64_t stride;
+    uint64_t fences;
+};
+
+static void write_index(const std::string &path, const XiFenceSampler &f) {
+    XiIndexHeader h;
+    std::memcpy(h.magic, XI_INDEX_MAGIC, sizeof h.magic);
+    h.elems = f.pos;
+    h.stride = f.stride;
+    h.fences = f.keys.size();
+    XiOutFile out(path, std::ios::binary);
+    if(!out) throw std::runtime_error("cannot open index file " + path);
+    xi_write(out, &h, sizeof h, XI_FILE_OUTPUT);
+    xi_write(out, f.keys.data(), f.keys.size() * sizeof(uint64_t), XI_FILE_OUTPUT);
+    out.close();
+    if(!out) throw std::runtime_error("I/O error while writing " + path);
+}
+
+// Load the sidecar of the sorted file `path`: its stride (0 if there is no sidecar) and
+// fences. Throws std::runtime_error if a sidecar exists but does not describe the file.
+static uint64_t load_index(const std::string &path, uint64_t &elems, std::vector<uint64_t> &fences) {
+    const std::string index_path = path + XI_INDEX_SUFFIX;
+    std::ifstream idx(index_path, std::ios::binary);
+    if(!idx) return 0;
+    XiIndexHeader h;
+    if(!idx.read(reinterpret_cast<char *>(&h), sizeof h) || std::memcmp(h.magic, XI_INDEX_MAGIC, sizeof h.magic) != 0)
+        throw std::runtime_error("invalid index " + index_path);
+    std::error_code ec;
+    const uint64_t bytes = std::filesystem::file_size(path, ec);
+    if(ec || bytes != h.elems * sizeof(double) || h.stride == 0 || h.fences != (h.elems + h.stride - 1) / h.stride)
+        throw std::runtime_error("index " + index_path + " does not match " + path);
+    fences.resize((std::size_t)h.fences);
+    if(!idx.read(reinterpret_cast<char *>(fences.data()), (std::streamsize)(fences.size() * sizeof(uint64_t))))
+        throw std::runtime_error("truncated index " + index_path);
+    elems = h.elems;
+    return h.stride;
+}
+
+// Body of xi_sort_file; its streams and buffers are gone by the time stats_end runs.
+// Sorts the elements [skip, skip + limit) of the input (a distributed worker's slice).
+static void xi_sort_file_impl(const std::string &in_path, const std::string &out_path, const XiSortConfig &cfg,
+                              uint64_t skip = 0, uint64_t limit = UINT64_MAX) {
+    std::error_code ec;
+    const uint64_t total_bytes = std::filesystem::file_size(in_path, ec);
+    if(ec) throw std::runtime_error("cannot stat input file " + in_path);
+    if(total_bytes % sizeof(double)) throw std::runtime_error("input file size not multiple of 8 bytes");
+    if(skip > total_bytes / sizeof(double)) throw std::runtime_error("slice starts past the end of " + in_path);
+    const uint64_t total_elems = std::min(total_bytes / sizeof(double) - skip, limit);
+
+    // ── Phase 1: split into sorted runs ────────────────────────────────────
+    std::size_t max_elems_RAM = cfg.mem_limit / sizeof(double);
+    if(max_elems_RAM == 0) throw std::runtime_error("mem_limit too small (< 8 bytes)");
+    if(max_elems_RAM > total_elems) max_elems_RAM = (std::size_t)total_elems;
+
+    XiInFile fin(in_path, std::ios::binary);
+    if(!fin) throw std::runtime_error("cannot open input file " + in_path);
+    if(skip) fin.seekg((std::streamoff)(skip * sizeof(double)));
+
+    XiScratch scratch;
+    std::vector<std::string> run_paths;
+    xi_vector<double> buf(max_elems_RAM);
+
+    const XiCurve curve = curve_for_file(fin, total_elems, buf, cfg, in_path);
+    // Non-finite values skip the runs and are kept as per-key counts (a feed's NaNs
+    // rarely differ in payload), written before and after the merge output. Past
+    // tailCap distinct keys the counts become one more sorted run and later chunks
+    // keep their non-finite values in their own runs.
+    std::map<uint64_t, uint64_t, std::less<uint64_t>,
+             XiCountingAllocator<std::pair<const uint64_t, uint64_t>>> tailCounts;
+    const std::size_t tailCap = std::max<std::size_t>(1024, max_elems_RAM / 8);
+    bool splitting = true;
+    xi_vector<uint64_t> tail;
+    uint64_t remaining = total_elems;
+    uint64_t first = 0;
+    XiSortConfig run_cfg = cfg;
+    run_cfg.external = false;
+    run_cfg.mem_limit = SIZE_MAX;
+
+    auto t1 = std::chrono::steady_clock::now();
+    while(remaining) {
+        cancel_point();
+        std::size_t chunk = (remaining < max_elems_RAM) ? (std::size_t)remaining : max_elems_RAM;
+        const long long run_id = (long long)run_paths.size();
+        {
+            XiSpan rspan("chunk_read", "io", "run", run_id);
+            if(xi_read(fin, buf.data(), chunk * sizeof(double), XI_FILE_INPUT) != chunk * sizeof(double))
+                throw std::runtime_error("I/O error while reading " + in_path);
+        }
+        remaining -= chunk;
+        std::size_t nf = chunk;
+        if(splitting) {
+            tail.clear();
+            nf = split_nonfinite(buf.data(), chunk, tail, cfg.parallel);
+            sort_tail(tail, cfg);
+            for(std::size_t i = 0, j; i < tail.size(); i = j) {
+                for(j = i + 1; j < tail.size() && tail[j] == tail[i]; ++j) {}
+                tailCounts[tail[i]] += j - i;
+            }
+            if(tailCounts.size() > tailCap) {
+                std::string run_path = scratch_path(cfg, "xisort_run", run_paths.size());
+                scratch.add(run_path);
+                XiOutFile fout(run_path, std::ios::binary);
+                XiRunWriter out(fout, cfg.buffer_elems, XI_FILE_RUN);
+                for(const auto &kc : tailCounts) put_repeated(out, kc.first, kc.second);
+                out.flush();
+                fout.close();
+                if(!fout) throw std::runtime_error("I/O error while writing " + run_path);
+                run_paths.push_back(run_path);
+                tailCounts.clear();
+                splitting = false;
+            }
+        }
+        if(nf == 0) {
+            first += chunk;
+            continue;
+        }
+        XiPhiBin runPhi;
+        {
+            XiSpan sspan("run_sort", "cpu", "run", run_id);
+            runPhi = xi_sort_impl(buf.data(), nf, first, run_cfg, curve);
+        }
+        if(cfg.trace) {
+            cur_call().stats.phi_runs.push_back(runPhi);
+        }
+        XiSpan wspan("run_write", "io", "run", run_id);
+        std::string run_path = scratch_path(cfg, "xisort_run", run_paths.size());
+        scratch.add(run_path);
+        XiOutFile fout(run_path, std::ios::binary);
+        xi_write(fout, buf.data(), nf * sizeof(double), XI_FILE_RUN);
+        fout.close();
+        if(!fout) throw std::runtime_error("I/O error while writing " + run_path);
+        run_paths.push_back(run_path);
+        first += chunk;
+    }
+    xi_vector<uint64_t>().swap(tail);
+    fin.close();
+    xi_vector<double>().swap(buf);
+    auto t2 = std::chrono::steady_clock::now();
+    cur_call().stats.runs = run_paths.size();
+    cur_call().stats.run_ms = ms_between(t1, t2);
+
+    // ── Phase 2: k-way merge ──────────────────────────────────────────────
+    XiSpan mspan("merge_round", "merge", "runs", (long long)run_paths.size());
+    const std::size_t RUN_BUF = cfg.buffer_elems ? cfg.buffer_elems : 1;
+    std::vector<XiRunCursor> runs(run_paths.size());
+    std::priority_queue<XiHeapItem, std::vector<XiHeapItem>, std::greater<XiHeapItem>> heap;
+    for(std::size_t i = 0; i < run_paths.size(); ++i) {
+        XiRunCursor &r = runs[i];
+        r.file.open(run_paths[i], std::ios::binary);
+        r.idx = 0;
+        r.eof = false;
+        if(cursor_ready(r, RUN_BUF)) heap.push({xi_key(r.buffer[0], curve), i});
+    }
+
+    scratch.add(out_path);      // a partial output is removed too
+    XiOutFile fout(out_path, std::ios::binary);
+    if(!fout) throw std::runtime_error("cannot open output file " + out_path);
+    XiRunWriter out(fout, RUN_BUF, XI_FILE_OUTPUT);
+    // the sidecar index is sampled from the output stream as it is written
+    const std::string index_path = out_path + XI_INDEX_SUFFIX;
+    std::remove(index_path.c_str());        // never leave a stale index beside new output
+    std::unique_ptr<XiFenceSampler> fences;
+    if(cfg.index_stride) {
+        fences.reset(new XiFenceSampler(cfg.index_stride));
+        out.fences = fences.get();
+    }
+    auto highTail = tailCounts.lower_bound(XI_KEY_FINITE_MIN);
+    for(auto it = tailCounts.begin(); it != highTail; ++it) {
+        put_repeated(out, it->first, it->second);
+        cur_call().stats.tail_elems += it->second;
+    }
+    // Φ(χ) of the k-way round: a segment is a maximal stretch from the same run
+    XiSegTracker seg;
+    long long merged = 0;
+    int poll = XI_CANCEL_POLL;
+    while(!heap.empty()) {
+        if(--poll == 0) {
+            poll = XI_CANCEL_POLL;
+            cancel_point();
+        }
+        XiHeapItem it = heap.top(); heap.pop();
+        XiRunCursor &r = runs[it.run_id];
+        out.put(&r.buffer[r.idx], 1);
+        ++r.idx;
+        ++merged;
+        seg.take(it.run_id, 1);
+        // Same run keeps winning: emit its buffered stretch that still precedes the
+        // next-best head without touching the heap
+        if(cfg.gallop && seg.segLen >= XI_MIN_GALLOP && !heap.empty()) {
+            const XiHeapItem next = heap.top();
+            while(r.idx < r.buffer.size()) {
+                const double *run = r.buffer.data() + r.idx;
+                std::size_t avail = r.buffer.size() - r.idx;
+                std::size_t cnt = gallop_prefix(avail, [&](std::size_t t) {
+                    return XiHeapItem{xi_key(run[t], curve), it.run_id} < next;
+                });
+                out.put(run, cnt);
+                r.idx += cnt;
+                merged += (long long)cnt;
+                seg.take(it.run_id, (long long)cnt);
+                if(cnt < avail || !cursor_ready(r, RUN_BUF)) {
+                    break;
+                }
+            }
+        }
+        if(cursor_ready(r, RUN_BUF)) heap.push({xi_key(r.buffer[r.idx], curve), it.run_id});
+    }
+    for(auto it = highTail; it != tailCounts.end(); ++it) {
+        put_repeated(out, it->first, it->second);
+        cur_call().stats.tail_elems += it->second;
+    }
+    out.flush();
+    seg.close();
+    fout.close();
+    if(!fout) throw std::runtime_error("I/O error while writing " + out_path);
+    runs.clear();
+    if(fences) {
+        scratch.add(index_path);
+        write_index(index_path, *fences);
+        scratch.keep(index_path);
+    }
+    scratch.keep(out_path);
+    cur_call().stats.merge_rounds = run_paths.empty() ? 0 : 1;
+    cur_call().stats.merge_ms = ms_between(t2, std::chrono::steady_clock::now());
+    if(cfg.trace && !run_paths.empty()) {
+        atomic_add_double(cur_call().phiTrace, seg.phi);
+        cur_call().curvCount.fetch_add(seg.segments, std::memory_order_relaxed);
+        cur_call().stats.phi_rounds.push_back(XiPhiBin{seg.phi, seg.segments, merged});
+    }
+}
+
+// File-to-file external sort: phase 1 sorts mem_limit-sized chunks of in_path into
+// run files, phase 2 k-way merges them into out_path (and, with cfg.index_stride, its
+// sidecar index). Throws std::runtime_error.
+void xi_sort_file(const std::string &in_path, const std::string &out_path, const XiSortConfig &cfg) {
+    XiCall call;
+    curve_check(cfg);
+    if(cfg.index_stride && cfg.mode != XI_MODE_STRICT)
+        throw std::runtime_error("the index sidecar needs STRICT mode");
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_sort_file", "sort");
+    xi_sort_file_impl(in_path, out_path, cfg);
+    stats_end(cfg.trace);
+}
+
+// Read-only view of a sorted file through its .xidx sidecar. lower_bound/upper_bound
+// search the in-memory fences, then read the one block that holds the answer; count
+// costs two block reads and range one sequential read of the result. Positions are
+// element indices in the IEEE total order. Not thread-safe (one stream per object).
+class XiSortedFile {
+    std::ifstream file;
+    uint64_t n;
+    uint64_t stride;
+    std::vector<uint64_t> fences;
+    std::vector<double> block;
+    uint64_t reads;
+
+    void read_at(uint64_t pos, double *dst, std::size_t cnt) {
+        file.clear();
+        file.seekg((std::streamoff)(pos * sizeof(double)));
+        file.read(reinterpret_cast<char *>(dst), (std::streamsize)(cnt * sizeof(double)));
+        if((std::size_t)file.gcount() != cnt * sizeof(double)) throw std::runtime_error("short read on sorted file");
+        ++reads;
+    }
+
+    // First position whose key is >= key (upper: > key)
+    uint64_t bound(uint64_t key, bool upper) {
+        auto it = upper ? std::upper_bound(fences.begin(), fences.end(), key)
+                        : std::lower_bound(fences.begin(), fences.end(), key);
+        const uint64_t j = (uint64_t)(it - fences.begin());
+        if(j == 0) return 0;
+        // fence j-1 is below the answer and fence j (or the end) at or above it
+        const uint64_t lo = (j - 1) * stride;
+        const uint64_t hi = (j * stride < n) ? j * stride : n;
+        block.resize((std::size_t)(hi - lo));
+        read_at(lo, block.data(), block.size());
+        auto in = std::partition_point(block.begin(), block.end(), [&](double v) {
+            return upper ? double_to_key(v) <= key : double_to_key(v) < key;
+        });
+        return lo + (uint64_t)(in - block.begin());
+    }
+
+public:
+    // Opens path and path + ".xidx"; throws std::runtime_error if the sidecar is
+    // missing or does not describe the file
+    explicit XiSortedFile(const std::string &path) : n(0), stride(0), reads(0) {
+        stride = load_index(path, n, fences);
+        if(stride == 0) throw std::runtime_error("missing index " + path + XI_INDEX_SUFFIX);
+        file.open(path, std::ios::binary);
+        if(!file) throw std::runtime_error("cannot open sorted file " + path);
+    }
+
+    uint64_t size() const { return n; }
+    uint64_t block_reads() const { return reads; }      // data reads so far
+
+    uint64_t lower_bound(double x) { return bound(double_to_key(x), false); }
+    uint64_t upper_bound(double x) { return bound(double_to_key(x), true); }
+
+    // Elements v with lo <= v < hi in the total order
+    uint64_t count(double lo, double hi) {
+        const uint64_t a = lower_bound(lo), b = lower_bound(hi);
+        return (b > a) ? b - a : 0;
+    }
+
+    // The elements counted by count(lo, hi), in order
+    std::vector<double> range(double lo, double hi) {
+        const uint64_t a = lower_bound(lo), b = lower_bound(hi);
+        std::vector<double> out((std::size_t)((b > a) ? b - a : 0));
+        if(!out.empty()) read_at(a, out.data(), out.size());
+        return out;
+    }
+};
+
+// ─── external argsort ──────────────────────────────────────────────────────────
+// xi_argsort_file sorts (value, input index) pairs instead of bare values, so the
+// sorted order of one on-disk column can be applied to others. Run records pack the
+// value bits with the index in XI_ARG_IDX_COMPACT bytes while n < 2^40 (13-byte
+// records instead of 16); the permutation itself is written as plain uint64.
+
+static const int XI_ARG_IDX_COMPACT = 5;
+
+// Buffered reader over a run file of packed (value, index) records
+struct XiPairCursor {
+    XiInFile file;
+    xi_vector<unsigned char> buffer;
+    std::size_t pos;
+    bool eof;
+};
+
+static bool pair_ready(XiPairCursor &r, std::size_t recBytes, std::size_t bufRecs) {
+    if(r.pos < r.buffer.size()) {
+        return true;
+    }
+    if(r.eof) {
+        return false;
+    }
+    XiSpan span("refill", "io", "bytes", (long long)(bufRecs * recBytes));
+    r.buffer.resize(bufRecs * recBytes);
+    std::size_t got = xi_read(r.file, r.buffer.data(), bufRecs * recBytes, XI_FILE_RUN);
+    if(got % recBytes) throw std::runtime_error("truncated argsort run record");
+    r.buffer.resize(got);
+    r.pos = 0;
+    r.eof = (got == 0);
+    return !r.eof;
+}
+
+// Record layout: 8 bytes of value, then the low idxBytes bytes of the index
+// (little-endian, like the value files themselves)
+static inline void pair_put(unsigned char *rec, double v, uint64_t idx, int idxBytes) {
+    std::memcpy(rec, &v, sizeof v);
+    std::memcpy(rec + sizeof v, &idx, (std::size_t)idxBytes);
+}
+
+static inline void pair_get(const unsigned char *rec, double &v, uint64_t &idx, int idxBytes) {
+    std::memcpy(&v, rec, sizeof v);
+    idx = 0;
+    std::memcpy(&idx, rec + sizeof v, (std::size_t)idxBytes);
+}
+
+// k-way merge heap entry for xi_argsort_file: the index makes every entry distinct
+struct XiArgHeapItem {
+    uint64_t key;
+    uint64_t tie;
+    uint64_t idx;
+    std::size_t run_id;
+    bool operator>(const XiArgHeapItem &o) const {
+        if(key != o.key) return key > o.key;
+        if(tie != o.tie) return tie > o.tie;
+        return idx > o.idx;
+    }
+};
+
+// Permutation and (optional) value outputs of xi_argsort_file
+struct XiArgOutput {
+    XiOutFile permFile, valFile;
+    xi_vector<uint64_t> perm;
+    std::unique_ptr<XiRunWriter> values;
+    std::size_t cap;
+    XiArgOutput(const std::string &perm_path, const std::string &values_path, std::size_t bufElems)
+        : permFile(perm_path, std::ios::binary), cap(bufElems) {
+        if(!permFile) throw std::runtime_error("cannot open output file " + perm_path);
+        perm.reserve(cap);
+        if(!values_path.empty()) {
+            valFile.open(values_path, std::ios::binary);
+            if(!valFile) throw std::runtime_error("cannot open output file " + values_path);
+            values.reset(new XiRunWriter(valFile, bufElems, XI_FILE_OUTPUT));
+        }
+    }
+    void put(double v, uint64_t idx) {
+        perm.push_back(idx);
+        if(perm.size() == cap) {
+            flush_perm();
+        }
+        if(values) values->put(&v, 1);
+    }
+    void flush_perm() {
+        xi_write(permFile, perm.data(), perm.size() * sizeof(uint64_t), XI_FILE_OUTPUT);
+        perm.clear();
+    }
+    void close(const std::string &perm_path, const std::string &values_path) {
+        flush_perm();
+        permFile.close();
+        if(!permFile) throw std::runtime_error("I/O error while writing " + perm_path);
+        if(values) {
+            values->flush();
+            valFile.close();
+            if(!valFile) throw std::runtime_error("I/O error while writing " + values_path);
+        }
+    }
+};
+
+static void xi_argsort_file_impl(const std::string &in_path, const std::string &perm_path,
+                                 const std::string &values_path, const XiSortConfig &cfg) {
+    std::error_code ec;
+    const uint64_t total_bytes = std::filesystem::file_size(in_path, ec);
+    if(ec) throw std::runtime_error("cannot stat input file " + in_path);
+    if(total_bytes % sizeof(double)) throw std::runtime_error("input file size not multiple of 8 bytes");
+    const uint64_t total_elems = total_bytes / sizeof(double);
+    const int idxBytes = (total_elems < (1ULL << 40)) ? XI_ARG_IDX_COMPACT : (int)sizeof(uint64_t);
+    const std::size_t recBytes = sizeof(double) + (std::size_t)idxBytes;
+
+    // ── Phase 1: sorted runs of (value, index) records ─────────────────────
+    std::size_t max_elems_RAM = cfg.mem_limit / sizeof(double);
+    if(max_elems_RAM == 0) throw std::runtime_error("mem_limit too small (< 8 bytes)");
+    if(max_elems_RAM > total_elems) max_elems_RAM = (std::size_t)total_elems;
+
+    XiInFile fin(in_path, std::ios::binary);
+    if(!fin) throw std::runtime_error("cannot open input file " + in_path);
+
+    XiScratch scratch;
+    std::vector<std::string> run_paths;
+    xi_vector<double> buf(max_elems_RAM);
+    const XiCurve curve = curve_for_file(fin, total_elems, buf, cfg, in_path);
+    const std::size_t RUN_BUF = cfg.buffer_elems ? cfg.buffer_elems : 1;
+    // a single chunk is sorted straight into the outputs, without a run file
+    const bool oneRun = (total_elems <= max_elems_RAM);
+    scratch.add(perm_path);     // partial outputs are removed too
+    if(!values_path.empty()) scratch.add(values_path);
+    std::unique_ptr<XiArgOutput> out;
+    uint64_t first = 0;
+
+    auto t1 = std::chrono::steady_clock::now();
+    while(first < total_elems) {
+        cancel_point();
+        const std::size_t chunk = (total_elems - first < max_elems_RAM) ? (std::size_t)(total_elems - first)
+                                                                       : max_elems_RAM;
+        const long long run_id = (long long)run_paths.size();
+        {
+            XiSpan rspan("chunk_read", "io", "run", run_id);
+            if(xi_read(fin, buf.data(), chunk * sizeof(double), XI_FILE_INPUT) != chunk * sizeof(double))
+                throw std::runtime_error("I/O error while reading " + in_path);
+        }
+        XiArray<XiItem> arr(chunk), aux(chunk);
+        {
+            XiSpan sspan("run_sort", "cpu", "run", run_id);
+            const long long cnt = (long long)chunk;
+            #pragma omp parallel for simd if(cfg.parallel && curve.on && cnt >= (1LL << 16))
+            for(long long i = 0; i < cnt; ++i) {
+                arr.p[i].value = buf[i];
+                arr.p[i].key = xi_key(buf[i], curve);
+                arr.p[i].tie = tie_of(cfg, first + i);
+                arr.p[i].seq = first + i;
+            }
+            run_merge_sort(arr.p, aux.p, chunk, cfg.parallel, cfg);
+            cancel_point();
+            if(cfg.trace) {
+                cur_call().stats.phi_runs.push_back(phi_collect());
+            }
+        }
+        if(oneRun) {
+            XiSpan wspan("output_write", "io", "elems", (long long)chunk);
+            out.reset(new XiArgOutput(perm_path, values_path, RUN_BUF));
+            for(std::size_t i = 0; i < chunk; ++i) out->put(arr.p[i].value, arr.p[i].seq);
+        } else {
+            XiSpan wspan("run_write", "io", "run", run_id);
+            std::string run_path = scratch_path(cfg, "xisort_argrun", run_paths.size());
+            scratch.add(run_path);
+            XiOutFile fout(run_path, std::ios::binary);
+            xi_vector<unsigned char> rec(RUN_BUF * recBytes);
+            for(std::size_t i = 0; i < chunk; i += RUN_BUF) {
+                const std::size_t c = (chunk - i < RUN_BUF) ? chunk - i : RUN_BUF;
+                for(std::size_t j = 0; j < c; ++j) {
+                    pair_put(&rec[j * recBytes], arr.p[i + j].value, arr.p[i + j].seq, idxBytes);
+                }
+                xi_write(fout, rec.data(), c * recBytes, XI_FILE_RUN);
+            }
+            fout.close();
+            if(!fout) throw std::runtime_error("I/O error while writing " + run_path);
+            run_paths.push_back(run_path);
+        }
+        first += chunk;
+    }
+    fin.close();
+    xi_vector<double>().swap(buf);
+    auto t2 = std::chrono::steady_clock::now();
+    cur_call().stats.runs = oneRun ? (total_elems ? 1 : 0) : run_paths.size();
+    cur_call().stats.run_ms = ms_between(t1, t2);
+
+    // ── Phase 2: k-way merge on (key, tie, index) ─────────────────────────
+    if(!oneRun) {
+        XiSpan mspan("merge_round", "merge", "runs", (long long)run_paths.size());
+        std::vector<XiPairCursor> runs(run_paths.size());
+        std::priority_queue<XiArgHeapItem, std::vector<XiArgHeapItem>, std::greater<XiArgHeapItem>> heap;
+        auto push_head = [&](std::size_t i) {
+            XiPairCursor &r = runs[i];
+            if(!pair_ready(r, recBytes, RUN_BUF)) return;
+            double v;
+            uint64_t idx;
+            pair_get(&r.buffer[r.pos], v, idx, idxBytes);
+            heap.push({xi_key(v, curve), tie_of(cfg, idx), idx, i});
+        };
+        for(std::size_t i = 0; i < run_paths.size(); ++i) {
+            runs[i].file.open(run_paths[i], std::ios::binary);
+            runs[i].pos = 0;
+            runs[i].eof = false;
+            push_head(i);
+        }
+        out.reset(new XiArgOutput(perm_path, values_path, RUN_BUF));
+        int poll = XI_CANCEL_POLL;
+        while(!heap.empty()) {
+            if(--poll == 0) {
+                poll = XI_CANCEL_POLL;
+                cancel_point();
+            }
+            XiArgHeapItem it = heap.top(); heap.pop();
+            XiPairCursor &r = runs[it.run_id];
+            double v;
+            std::memcpy(&v, &r.buffer[r.pos], sizeof v);
+            out->put(v, it.idx);
+            r.pos += recBytes;
+            push_head(it.run_id);
+        }
+        cur_call().stats.merge_rounds = 1;
+    } else if(!out) {
+        out.reset(new XiArgOutput(perm_path, values_path, RUN_BUF));     // empty input
+    }
+    out->close(perm_path, values_path);
+    scratch.keep(perm_path);
+    scratch.keep(values_path);
+    cur_call().stats.merge_ms = ms_between(t2, std::chrono::steady_clock::now());
+}
+
+// External argsort: perm_path receives the input index of each rank as uint64, and
+// values_path (unless empty) the sorted values. Ties follow cfg.tie_break, with
+// XI_TIE_VALUE keeping input order. Throws std::runtime_error.
+void xi_argsort_file(const std::string &in_path, const std::string &perm_path,
+                     const std::string &values_path, const XiSortConfig &cfg) {
+    XiCall call;
+    curve_check(cfg);
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_argsort_file", "sort");
+    xi_argsort_file_impl(in_path, perm_path, values_path, cfg);
+    stats_end(cfg.trace);
+}
+
+// ─── variable-length records ───────────────────────────────────────────────────
+// xi_sort_records_file sorts a file of framed records by a double key inside each
+// record. Only (key, seq, offset, length) tuples are sorted; record bytes are copied
+// once per pass, from the chunk buffer (or a run cursor) into the next file. Equal
+// keys keep input order.
+
+enum XiFraming {
+    XI_FRAME_LEN32 = 0,     // uint32 little-endian payload length, then the payload
+    XI_FRAME_DELIM = 1      // payload, then the delimiter byte (e.g. text lines)
+};
+
+struct XiRecordFormat {
+    XiFraming framing;
+    char delim;             // XI_FRAME_DELIM terminator
+    std::size_t key_offset; // byte offset of the key inside the payload
+    bool key_text;          // key is decimal text (strtod) rather than 8 raw bytes
+    XiRecordFormat() : framing(XI_FRAME_LEN32), delim('\n'), key_offset(0), key_text(false) {}
+};
+
+// Sort tuple of one record in the chunk buffer
+struct XiRecItem {
+    uint64_t key;
+    uint64_t seq;
+    std::size_t off;
+    std::size_t len;
+};
+
+static inline bool item_le(const XiRecItem &a, const XiRecItem &b) {
+    return a.key < b.key || (a.key == b.key && a.seq <= b.seq);
+}
+
+// Length of the complete record at p[0, avail) including its framing, or 0 if the
+// record continues past avail
+static inline std::size_t rec_frame(const char *p, std::size_t avail, const XiRecordFormat &fmt) {
+    if(fmt.framing == XI_FRAME_DELIM) {
+        const void *d = std::memchr(p, fmt.delim, avail);
+        return d ? (std::size_t)((const char *)d - p) + 1 : 0;
+    }
+    if(avail < sizeof(uint32_t)) return 0;
+    uint32_t len;
+    std::memcpy(&len, p, sizeof len);
+    return (avail - sizeof len >= len) ? sizeof len + len : 0;
+}
+
+// Key of the framed record p[0, len) (NaN for unparsable text keys)
+static uint64_t rec_key(const char *p, std::size_t len, const XiRecordFormat &fmt) {
+    const char *payload = p;
+    std::size_t size = len - 1;
+    if(fmt.framing == XI_FRAME_LEN32) {
+        payload += sizeof(uint32_t);
+        size = len - sizeof(uint32_t);
+    }
+    double v;
+    if(fmt.key_text) {
+        char text[64] = {0};
+        if(fmt.key_offset < size) {
+            std::size_t n = size - fmt.key_offset;
+            std::memcpy(text, payload + fmt.key_offset, n < sizeof text - 1 ? n : sizeof text - 1);
+        }
+        char *end;
+        v = std::strtod(text, &end);
+        if(end == text) v = std::numeric_limits<double>::quiet_NaN();
+    } else {
+        if(fmt.key_offset > size || size - fmt.key_offset < sizeof v)
+            throw std::runtime_error("record shorter than its key");
+        std::memcpy(&v, payload + fmt.key_offset, sizeof v);
+    }
+    return double_to_key(v);
+}
+
+// Buffered reader over a run file of framed records; the current record is kept
+// whole in the buffer, which grows if a record is longer than it
+struct XiRecCursor {
+    XiInFile file;
+    xi_vector<char> buf;
+    std::size_t pos, have, len;
+    bool eof;
+};
+
+// Make the next whole record available at buf[pos, pos + len); false at end of run
+static bool rec_ready(XiRecCursor &r, const XiRecordFormat &fmt) {
+    for(;;) {
+        r.len = rec_frame(r.buf.data() + r.pos, r.have - r.pos, fmt);
+        if(r.len) return true;
+        if(r.eof) {
+            if(r.pos != r.have) throw std::runtime_error("truncated record in run file");
+            return false;
+        }
+        // keep the partial record, then refill behind it
+        std::memmove(r.buf.data(), r.buf.data() + r.pos, r.have - r.pos);
+        r.have -= r.pos;
+        r.pos = 0;
+        if(r.have == r.buf.size()) r.buf.resize(2 * r.buf.size());
+        XiSpan span("refill", "io", "bytes", (long long)(r.buf.size() - r.have));
+        std::size_t got = xi_read(r.file, r.buf.data() + r.have, r.buf.size() - r.have, XI_FILE_RUN);
+        r.have += got;
+        r.eof = (got == 0);
     }
 }
+
+static void xi_sort_records_file_impl(const std::string &in_path, const std::string &out_path,
+                                      const XiRecordFormat &fmt, const XiSortConfig &cfg) {
+    std::error_code ec;
+    const uint64_t total_bytes = std::filesystem::file_size(in_path, ec);
+    if(ec) throw std::runtime_error("cannot stat input file " + in_path);
+    // A run holds at most mem_limit bytes of records plus their two tuple arrays
+    const std::size_t budget = cfg.mem_limit;
+    const std::size_t perRec = 2 * sizeof(XiRecItem);
+    if(budget < 4096) throw std::runtime_error("mem_limit too small (< 4096 bytes)");
+    const std::size_t cap = (budget < total_bytes) ? budget : (std::size_t)total_bytes;
+
+    XiInFile fin(in_path, std::ios::binary);
+    if(!fin) throw std::runtime_error("cannot open input file " + in_path);
+
+    XiScratch scratch;
+    std::vector<std::string> run_paths;
+    const std::size_t OUT_BUF = (cfg.buffer_elems ? cfg.buffer_elems : 1) * sizeof(double);
+    xi_vector<char> buf(cap + 1);          // +1: a missing final delimiter is appended
+    xi_vector<XiRecItem> items;
+    std::size_t have = 0;
+    bool inEof = false;
+    // bytes read ahead per run, tuned to the mean record length so that the record
+    // bytes and the tuples of one run fill the budget together
+    std::size_t fill = (cap < budget / 2) ? cap : budget / 2;
+    uint64_t seq = 0;
+    bool direct = false;
+
+    auto t1 = std::chrono::steady_clock::now();
+    while(have || !inEof) {
+        cancel_point();
+        const long long run_id = (long long)run_paths.size();
+        std::size_t pos = 0;
+        items.clear();
+        {
+            XiSpan rspan("chunk_read", "io", "run", run_id);
+            for(;;) {
+                if(!inEof && have < fill) {
+                    std::size_t got = xi_read(fin, buf.data() + have, fill - have, XI_FILE_INPUT);
+                    have += got;
+                    inEof = (got == 0);
+                    if(inEof && fmt.framing == XI_FRAME_DELIM && have && buf[have - 1] != fmt.delim) {
+                        buf[have++] = fmt.delim;
+                    }
+                }
+                for(std::size_t len; (len = rec_frame(buf.data() + pos, have - pos, fmt)); pos += len) {
+                    if(pos + len + (items.size() + 1) * perRec > budget && !items.empty()) break;
+                    items.push_back(XiRecItem{rec_key(buf.data() + pos, len, fmt), seq++, pos, len});
+                }
+                if(!items.empty() || (inEof && pos == have)) break;
+                if(inEof) throw std::runtime_error("truncated record at end of " + in_path);
+                if(have == fill) {
+                    if(fill >= cap) throw std::runtime_error("record larger than mem_limit");
+                    fill = cap;
+                }
+            }
+        }
+        if(items.empty()) break;
+        const std::size_t N = items.size();
+        {
+            XiSpan sspan("run_sort", "cpu", "run", run_id);
+            XiArray<XiRecItem> aux(N);
+            run_merge_sort(items.data(), aux.p, N, cfg.parallel, cfg);
+            cancel_point();
+            if(cfg.trace) {
+                cur_call().stats.phi_runs.push_back(phi_collect());
+            }
+        }
+        // everything in one chunk: write the output directly
+        direct = run_paths.empty() && inEof && pos == have;
+        const std::string path = direct ? out_path
+                                      : scratch_path(cfg, "xisort_recrun", run_paths.size());
+        {
+            XiSpan wspan(direct ? "output_write" : "run_write", "io", "run", run_id);
+            scratch.add(path);
+            XiOutFile fout(path, std::ios::binary);
+            if(!fout) throw std::runtime_error("cannot open output file " + path);
+            XiBlockWriter<char> out(fout, OUT_BUF, direct ? XI_FILE_OUTPUT : XI_FILE_RUN);
+            for(const XiRecItem &it : items) out.put(buf.data() + it.off, it.len);
+            out.flush();
+            fout.close();
+            if(!fout) throw std::runtime_error("I/O error while writing " + path);
+        }
+        if(!direct) run_paths.push_back(path);
+        fill = (std::size_t)((double)budget * pos / (double)(pos + N * perRec));
+        if(fill < budget / 16) fill = budget / 16;
+        if(fill > cap) fill = cap;
+        // carry the unread part of the chunk (normally one partial record) forward
+        std::memmove(buf.data(), buf.data() + pos, have - pos);
+        have -= pos;
+        if(have > fill) fill = have;
+    }
+    fin.close();
+    xi_vector<char>().swap(buf);
+    xi_vector<XiRecItem>().swap(items);
+    auto t2 = std::chrono::steady_clock::now();
+    cur_call().stats.runs = direct ? 1 : run_paths.size();
+    cur_call().stats.run_ms = ms_between(t1, t2);
+
+    // ── Phase 2: k-way merge of the run files ─────────────────────────────
+    if(!direct) {
+        XiSpan mspan("merge_round", "merge", "runs", (long long)run_paths.size());
+        std::vector<XiRecCursor> runs(run_paths.size());
+        std::priority_queue<XiHeapItem, std::vector<XiHeapItem>, std::greater<XiHeapItem>> heap;
+        for(std::size_t i = 0; i < run_paths.size(); ++i) {
+            XiRecCursor &r = runs[i];
+            r.file.open(run_paths[i], std::ios::binary);
+            r.buf.resize(OUT_BUF);
+            r.pos = r.have = r.len = 0;
+            r.eof = false;
+            if(rec_ready(r, fmt)) heap.push({rec_key(r.buf.data(), r.len, fmt), i});
+        }
+        scratch.add(out_path);
+        XiOutFile fout(out_path, std::ios::binary);
+        if(!fout) throw std::runtime_error("cannot open output file " + out_path);
+        XiBlockWriter<char> out(fout, OUT_BUF, XI_FILE_OUTPUT);
+        int poll = XI_CANCEL_POLL;
+        while(!heap.empty()) {
+            if(--poll == 0) {
+                poll = XI_CANCEL_POLL;
+                cancel_point();
+            }
+            XiHeapItem it = heap.top(); heap.pop();
+            XiRecCursor &r = runs[it.run_id];
+            out.put(r.buf.data() + r.pos, r.len);
+            r.pos += r.len;
+            if(rec_ready(r, fmt)) heap.push({rec_key(r.buf.data() + r.pos, r.len, fmt), it.run_id});
+        }
+        out.flush();
+        fout.close();
+        if(!fout) throw std::runtime_error("I/O error while writing " + out_path);
+        cur_call().stats.merge_rounds = run_paths.empty() ? 0 : 1;
+    }
+    scratch.keep(out_path);
+    cur_call().stats.merge_ms = ms_between(t2, std::chrono::steady_clock::now());
+}
+
+// File-to-file sort of framed records by the double key each one carries (IEEE
+// total order, STRICT mode only). Output uses the input framing; a final delimited
+// record missing its delimiter gets one. Throws std::runtime_error.
+void xi_sort_records_file(const std::string &in_path, const std::string &out_path,
+                          const XiRecordFormat &fmt, const XiSortConfig &cfg) {
+    XiCall call;
+    if(cfg.mode != XI_MODE_STRICT) throw std::runtime_error("record sort supports STRICT mode only");
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_sort_records_file", "sort");
+    xi_sort_records_file_impl(in_path, out_path, fmt, cfg);
+    stats_end(cfg.trace);
+}
+
+// ─── group-by aggregation ───────────────────────────────────────────────────────
+// xi_group / xi_group_file reduce each distinct value (IEEE total-order equality, so
+// -0/+0 and NaN payloads stay apart) to one XiGroup, in sorted order. Aggregation is
+// fused into the sort: every chunk is grouped as it is written back, so duplicate-heavy
+// input spills one record per distinct value and run, and the k-way merge combines
+// equal keys as they meet instead of a second pass over sorted output.
+
+// One output group: 40-byte record, also the run-file format of xi_group_file
+struct XiGroup {
+    double value;
+    uint64_t count;
+    double sum;         // sum of the payload (of the values themselves if none)
+    uint64_t first;     // lowest input index holding the value
+    uint64_t last;      // highest input index holding the value
+};
+
+static inline void group_add(XiGroup &g, const XiGroup &o) {
+    g.count += o.count;
+    g.sum += o.sum;
+    if(o.first < g.first) g.first = o.first;
+    if(o.last > g.last) g.last = o.last;
+}
+
+// Merge the groups g[0, l) and g[h, h + r), each sorted, into g[0, ...) and return
+// the count; equal values are added up as they meet, the left one first. Only the
+// left half is copied out, to aux[0, l).
+static std::size_t group_merge(XiGroup *g, XiGroup *aux, std::size_t l, std::size_t h, std::size_t r,
+                               std::size_t n, bool trace) {
+    std::memcpy(aux, g, l * sizeof(XiGroup));
+    const std::size_t end = h + r;
+    std::size_t i = 0, j = h, k = 0;
+    std::size_t pollAt = cur_call().abortArmed ? XI_CANCEL_POLL : end;
+    double phiLocal = 0.0;
+    long long countLocal = 0;
+    int lastSource = 0; // 0 = none, 1 = left (or both), 2 = right
+    long long segLen = 0;
+    auto take = [&](int source, std::size_t len) {
+        if(source != lastSource) {
+            if(segLen > 0 && trace) {
+                phiLocal += 1.0 / (double)segLen;
+                ++countLocal;
+            }
+            segLen = 0;
+            lastSource = source;
+        }
+        segLen += (long long)len;
+    };
+    while(i < l && j < end) {
+        if(k >= pollAt) {
+            if(abort_requested()) {
+                return k;
+            }
+            pollAt = k + XI_CANCEL_POLL;
+        }
+        const uint64_t ka = double_to_key(aux[i].value), kb = double_to_key(g[j].value);
+        if(ka < kb) {
+            g[k++] = aux[i++];
+            take(1, 1);
+        } else if(kb < ka) {
+            g[k++] = g[j++];
+            take(2, 1);
+        } else {
+            XiGroup m = aux[i++];
+            group_add(m, g[j++]);
+            g[k++] = m;
+            take(1, 1);
+        }
+    }
+    // k <= j throughout, so the right remainder only ever moves down
+    if(i < l) {
+        take(1, l - i);
+        std::memcpy(g + k, aux + i, (l - i) * sizeof(XiGroup));
+        k += l - i;
+    }
+    if(j < end) {
+        take(2, end - j);
+        std::memmove(g + k, g + j, (end - j) * sizeof(XiGroup));
+        k += end - j;
+    }
+    if(segLen > 0 && trace) {
+        phiLocal += 1.0 / (double)segLen;
+        ++countLocal;
+    }
+    if(trace) {
+        phi_add(phi_bins()[phi_level(n)], phiLocal, countLocal, (long long)n);
+    }
+    return k;
+}
+
+// Merge sort of the single-element groups g[lo, lo + n) that collapses equal values
+// at every merge, so duplicate-heavy input shrinks level by level; returns the group
+// count, packed at g[lo]. Sibling ranges copy their left halves to disjoint parts of
+// aux, starting at aux[lo / 2], so aux needs room for N / 2 groups.
+static std::size_t group_sort_rec(XiGroup *g, XiGroup *aux, std::size_t lo, std::size_t n,
+                                  bool parallel, std::size_t taskThreshold, bool trace) {
+    if(n < 2) {
+        return n;
+    }
+    if(n > (std::size_t)XI_CANCEL_POLL && abort_requested()) {
+        return n;
+    }
+    const std::size_t h = n >> 1;
+    std::size_t l, r;
+    if(parallel && n >= taskThreshold) {
+        #pragma omp task shared(l)
+        {
+            XiSpan span("sort_task", "cpu", "elems", (long long)h);
+            l = group_sort_rec(g, aux, lo, h, parallel, taskThreshold, trace);
+        }
+        #pragma omp task shared(r)
+        {
+            XiSpan span("sort_task", "cpu", "elems", (long long)(n - h));
+            r = group_sort_rec(g, aux, lo + h, n - h, parallel, taskThreshold, trace);
+        }
+        #pragma omp taskwait
+    } else {
+        l = group_sort_rec(g, aux, lo, h, parallel, taskThreshold, trace);
+        r = group_sort_rec(g, aux, lo + h, n - h, parallel, taskThreshold, trace);
+    }
+    if(n > (std::size_t)XI_CANCEL_POLL && abort_requested()) {
+        return n;
+    }
+    return group_merge(g + lo, aux + lo / 2, l, h, r, n, trace);
+}
+
+// Group data[0, N) (input indices base...) into out, which has room for N groups and
+// doubles as the sort array; returns the group count. Memory beyond out is N / 2
+// groups of merge buffer.
+static std::size_t group_block(const double *data, const double *payload, std::size_t N, uint64_t base,
+                               const XiSortConfig &cfg, XiGroup *out) {
+    if(N == 0) return 0;
+    for(std::size_t i = 0; i < N; ++i) {
+        out[i] = XiGroup{data[i], 1, payload ? payload[i] : data[i], base + i, base + i};
+    }
+    XiArray<XiGroup> aux(N / 2 + 1);
+    const std::size_t taskThreshold = 1ULL << 15;
+    std::size_t groups = 0;
+    if(cfg.parallel) {
+        XiCallState *cs = &cur_call();
+        #pragma omp parallel
+        {
+            XiCallScope scope(cs);
+            #pragma omp single nowait
+            {
+                groups = group_sort_rec(out, aux.p, 0, N, true, taskThreshold, cfg.trace);
+            }
+        }
+    } else {
+        groups = group_sort_rec(out, aux.p, 0, N, false, taskThreshold, cfg.trace);
+    }
+    cancel_point();
+    return groups;
+}
+
+// In-memory group-by: out (room for n groups) receives one group per distinct value of
+// data in ascending order; payload may be null. Returns the group count. The sum of a
+// group adds the partial sums of adjacent input ranges, earlier range first. Needs
+// n / 2 XiGroups of scratch. STRICT mode only; throws for cfg.external.
+uint64_t xi_group(const double *data, const double *payload, uint64_t n, XiGroup *out, const XiSortConfig &cfg) {
+    XiCall call;
+    if(cfg.external) throw std::runtime_error("xi_group is in-memory only");
+    if(cfg.mode != XI_MODE_STRICT) throw std::runtime_error("group-by supports STRICT mode only");
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_group", "sort", "elems", (long long)n);
+    const uint64_t groups = group_block(data, payload, (std::size_t)n, 0, cfg, out);
+    if(cfg.trace) {
+        phi_collect();
+    }
+    stats_end(cfg.trace);
+    return groups;
+}
+
+static void xi_group_file_impl(const std::string &in_path, const std::string &payload_path,
+                               const std::string &out_path, const XiSortConfig &cfg) {
+    std::error_code ec;
+    const uint64_t total_bytes = std::filesystem::file_size(in_path, ec);
+    if(ec) throw std::runtime_error("cannot stat input file " + in_path);
+    if(total_bytes % sizeof(double)) throw std::runtime_error("input file size not multiple of 8 bytes");
+    const uint64_t total_elems = total_bytes / sizeof(double);
+    const bool hasPayload = !payload_path.empty();
+    if(hasPayload && std::filesystem::file_size(payload_path, ec) != total_bytes)
+        throw std::runtime_error("payload file " + payload_path + " does not match the input size");
+
+    // ── Phase 1: grouped runs ─────────────────────────────────────────────
+    // per element: the value (and payload) read, its XiGroup, half an XiGroup of merge buffer
+    const std::size_t elem_bytes = sizeof(double) * (hasPayload ? 2 : 1) + sizeof(XiGroup) + sizeof(XiGroup) / 2;
+    std::size_t max_elems_RAM = cfg.mem_limit / elem_bytes;
+    if(max_elems_RAM == 0) throw std::runtime_error("mem_limit too small for one element");
+    if(max_elems_RAM > total_elems) max_elems_RAM = (std::size_t)total_elems;
+
+    XiInFile fin(in_path, std::ios::binary), pin;
+    if(!fin) throw std::runtime_error("cannot open input file " + in_path);
+    if(hasPayload) {
+        pin.open(payload_path, std::ios::binary);
+        if(!pin) throw std::runtime_error("cannot open payload file " + payload_path);
+    }
+
+    XiScratch scratch;
+    std::vector<std::string> run_paths;
+    xi_vector<double> buf(max_elems_RAM), pbuf(hasPayload ? max_elems_RAM : 0);
+    xi_vector<XiGroup> groups(max_elems_RAM);
+    const std::size_t RUN_BUF = cfg.buffer_elems ? cfg.buffer_elems : 1;
+    // a single chunk is grouped straight into the output
+    const bool oneRun = (total_elems <= max_elems_RAM);
+    scratch.add(out_path);
+    XiOutFile fout(out_path, std::ios::binary);
+    if(!fout) throw std::runtime_error("cannot open output file " + out_path);
+    XiBlockWriter<XiGroup> out(fout, RUN_BUF, XI_FILE_OUTPUT);
+
+    auto t1 = std::chrono::steady_clock::now();
+    for(uint64_t first = 0; first < total_elems; ) {
+        cancel_point();
+        const std::size_t chunk = (total_elems - first < max_elems_RAM) ? (std::size_t)(total_elems - first)
+                                                                       : max_elems_RAM;
+        const long long run_id = (long long)run_paths.size();
+        {
+            XiSpan rspan("chunk_read", "io", "run", run_id);
+            if(xi_read(fin, buf.data(), chunk * sizeof(double), XI_FILE_INPUT) != chunk * sizeof(double))
+                throw std::runtime_error("I/O error while reading " + in_path);
+            if(hasPayload && xi_read(pin, pbuf.data(), chunk * sizeof(double), XI_FILE_INPUT) != chunk * sizeof(double))
+                throw std::runtime_error("I/O error while reading " + payload_path);
+        }
+        std::size_t ng;
+        {
+            XiSpan sspan("run_sort", "cpu", "run", run_id);
+            ng = group_block(buf.data(), hasPayload ? pbuf.data() : nullptr, chunk, first, cfg, groups.data());
+        }
+        if(cfg.trace) {
+            cur_call().stats.phi_runs.push_back(phi_collect());
+        }
+        if(oneRun) {
+            out.put(groups.data(), ng);
+        } else {
+            XiSpan wspan("run_write", "io", "run", run_id);
+            std::string run_path = scratch_path(cfg, "xisort_grouprun", run_paths.size());
+            scratch.add(run_path);
+            XiOutFile rout(run_path, std::ios::binary);
+            xi_write(rout, groups.data(), ng * sizeof(XiGroup), XI_FILE_RUN);
+            rout.close();
+            if(!rout) throw std::runtime_error("I/O error while writing " + run_path);
+            run_paths.push_back(run_path);
+        }
+        first += chunk;
+    }
+    fin.close();
+    pin.close();
+    xi_vector<double>().swap(buf);
+    xi_vector<double>().swap(pbuf);
+    xi_vector<XiGroup>().swap(groups);
+    auto t2 = std::chrono::steady_clock::now();
+    cur_call().stats.runs = oneRun ? (total_elems ? 1 : 0) : run_paths.size();
+    cur_call().stats.run_ms = ms_between(t1, t2);
+
+    // ── Phase 2: k-way merge, combining equal keys as they meet ───────────
+    if(!run_paths.empty()) {
+        XiSpan mspan("merge_round", "merge", "runs", (long long)run_paths.size());
+        std::vector<XiBlockCursor<XiGroup>> runs(run_paths.size());
+        std::priority_queue<XiHeapItem, std::vector<XiHeapItem>, std::greater<XiHeapItem>> heap;
+        for(std::size_t i = 0; i < run_paths.size(); ++i) {
+            XiBlockCursor<XiGroup> &r = runs[i];
+            r.file.open(run_paths[i], std::ios::binary);
+            r.idx = 0;
+            r.eof = false;
+            if(cursor_ready(r, RUN_BUF)) heap.push({double_to_key(r.buffer[0].value), i});
+        }
+        XiGroup cur = XiGroup();
+        uint64_t curKey = 0;
+        bool open = false;
+        int poll = XI_CANCEL_POLL;
+        while(!heap.empty()) {
+            if(--poll == 0) {
+                poll = XI_CANCEL_POLL;
+                cancel_point();
+            }
+            XiHeapItem it = heap.top(); heap.pop();
+            XiBlockCursor<XiGroup> &r = runs[it.run_id];
+            if(open && it.key == curKey) {
+                group_add(cur, r.buffer[r.idx]);
+            } else {
+                if(open) out.put(&cur, 1);
+                cur = r.buffer[r.idx];
+                curKey = it.key;
+                open = true;
+            }
+            ++r.idx;
+            if(cursor_ready(r, RUN_BUF)) heap.push({double_to_key(r.buffer[r.idx].value), it.run_id});
+        }
+        if(open) out.put(&cur, 1);
+        cur_call().stats.merge_rounds = 1;
+    }
+    out.flush();
+    fout.close();
+    if(!fout) throw std::runtime_error("I/O error while writing " + out_path);
+    scratch.keep(out_path);
+    cur_call().stats.merge_ms = ms_between(t2, std::chrono::steady_clock::now());
+}
+
+// External group-by: out_path receives one XiGroup record per distinct value of
+// in_path, in ascending order. payload_path (unless empty) is a file of doubles the
+// size of the input whose values are summed per group. Sums add per-run partial sums
+// in run order. STRICT mode only. Throws std::runtime_error.
+void xi_group_file(const std::string &in_path, const std::string &payload_path,
+                   const std::string &out_path, const XiSortConfig &cfg) {
+    XiCall call;
+    if(cfg.mode != XI_MODE_STRICT) throw std::runtime_error("group-by supports STRICT mode only");
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_group_file", "sort");
+    xi_group_file_impl(in_path, payload_path, out_path, cfg);
+    stats_end(cfg.trace);
+}
+
+// ─── top-k / bottom-k selection ─────────────────────────────────────────────────
+// xi_topk_file streams the input once and keeps, per slice of each block, the k best
+// (key, index) pairs seen so far: candidates collect in a 2k buffer that is cut back
+// to k by nth_element, after which the k-th key is a threshold that rejects almost
+// every later element with one compare. Memory is O(slices * k) plus one read block;
+// nothing is written to disk. Ties at the boundary go to the lower input index.
+
+// One selected element: its value and input index
+struct XiSelected {
+    double value;
+    uint64_t index;
+};
+
+static inline bool key_idx_less(const XiKeyIdx &a, const XiKeyIdx &b) {
+    return a.key < b.key || (a.key == b.key && a.idx < b.idx);
+}
+
+// Bounded candidate set of the k smallest (key, index) pairs offered so far. Indices
+// must be offered in increasing order: a later element equal to the threshold loses.
+struct XiTopSel {
+    std::size_t k;
+    uint64_t thresh;
+    bool bounded;
+    xi_vector<XiKeyIdx> cand;
+    explicit XiTopSel(std::size_t kk) : k(kk), thresh(UINT64_MAX), bounded(false) {
+        cand.reserve(2 * k);
+    }
+    void offer(uint64_t key, uint64_t idx) {
+        if(bounded && key >= thresh) return;
+        cand.push_back(XiKeyIdx{key, idx});
+        if(cand.size() == 2 * k) cut();
+    }
+    void cut() {
+        if(cand.size() <= k) return;
+        std::nth_element(cand.begin(), cand.begin() + (k - 1), cand.end(), key_idx_less);
+        cand.resize(k);
+        thresh = cand[k - 1].key;
+        bounded = true;
+    }
+};
+
+// Slices of a block that select independently (one per OpenMP thread)
+static int topk_slices(const XiSortConfig &cfg) {
+#ifdef _OPENMP
+    return cfg.parallel ? omp_get_max_threads() : 1;
+#else
+    (void)cfg;
+    return 1;
+#endif
+}
+
+// Offer block[0, cnt) (input indices first...) to the slice selectors, one thread per
+// slice; `flip` turns largest-k into smallest-k on the complemented key
+static void topk_offer(std::vector<XiTopSel> &sel, const double *block, std::size_t cnt, uint64_t first,
+                       uint64_t flip) {
+    const long long S = (long long)sel.size();
+    XiCallState *cs = &cur_call();      // candidate buffers are charged to this call
+    #pragma omp parallel if(S > 1)
+    {
+        XiCallScope scope(cs);
+        #pragma omp for schedule(static, 1)
+        for(long long t = 0; t < S; ++t) {
+            XiTopSel &ts = sel[t];
+            const std::size_t lo = cnt * (std::size_t)t / (std::size_t)S, hi = cnt * (std::size_t)(t + 1) / (std::size_t)S;
+            for(std::size_t i = lo; i < hi; ++i) {
+                ts.offer(double_to_key(block[i]) ^ flip, first + i);
+            }
+        }
+    }
+}
+
+// Merge the slice selections into the final k, in ascending total order
+static std::vector<XiSelected> topk_finish(std::vector<XiTopSel> &sel, std::size_t k, uint64_t flip) {
+    xi_vector<XiKeyIdx> all;
+    for(XiTopSel &ts : sel) {
+        ts.cut();
+        all.insert(all.end(), ts.cand.begin(), ts.cand.end());
+        xi_vector<XiKeyIdx>().swap(ts.cand);
+    }
+    if(all.size() > k) {
+        std::nth_element(all.begin(), all.begin() + (k - 1), all.end(), key_idx_less);
+        all.resize(k);
+    }
+    std::vector<XiSelected> out(all.size());
+    for(std::size_t i = 0; i < all.size(); ++i) {
+        out[i] = XiSelected{key_to_double(all[i].key ^ flip), all[i].idx};
+    }
+    std::sort(out.begin(), out.end(), [](const XiSelected &a, const XiSelected &b) {
+        const uint64_t ka = double_to_key(a.value), kb = double_to_key(b.value);
+        return ka < kb || (ka == kb && a.index < b.index);
+    });
+    return out;
+}
+
+static std::size_t topk_check(uint64_t k, uint64_t n, int slices, const XiSortConfig &cfg) {
+    const uint64_t kk = (k < n) ? k : n;
+    if(kk && 2 * kk * sizeof(XiKeyIdx) * (uint64_t)slices > cfg.mem_limit)
+        throw std::runtime_error("k too large for mem_limit (needs 32 * k bytes per thread)");
+    return (std::size_t)kk;
+}
+
+// The k largest (or smallest) elements of data[0, n), ascending in IEEE total order
+// (equal values by input index). Ties at the cut keep the lowest input indices.
+std::vector<XiSelected> xi_topk(const double *data, uint64_t n, uint64_t k, bool largest,
+                                const XiSortConfig &cfg) {
+    XiCall call;
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_topk", "select", "elems", (long long)n);
+    const int slices = topk_slices(cfg);
+    const std::size_t kk = topk_check(k, n, slices, cfg);
+    std::vector<XiSelected> out;
+    if(kk) {
+        const uint64_t flip = largest ? UINT64_MAX : 0;
+        std::vector<XiTopSel> sel(slices, XiTopSel(kk));
+        const std::size_t BLOCK = 1 << 20;
+        for(uint64_t first = 0; first < n; first += BLOCK) {
+            cancel_point();
+            const std::size_t cnt = (n - first < BLOCK) ? (std::size_t)(n - first) : BLOCK;
+            topk_offer(sel, data + first, cnt, first, flip);
+        }
+        out = topk_finish(sel, kk, flip);
+    }
+    stats_end(cfg.trace);
+    return out;
+}
+
+static std::vector<XiSelected> xi_topk_file_impl(const std::string &in_path, uint64_t k, bool largest,
+                                                 const XiSortConfig &cfg) {
+    std::error_code ec;
+    const uint64_t total_bytes = std::filesystem::file_size(in_path, ec);
+    if(ec) throw std::runtime_error("cannot stat input file " + in_path);
+    if(total_bytes % sizeof(double)) throw std::runtime_error("input file size not multiple of 8 bytes");
+    const uint64_t total_elems = total_bytes / sizeof(double);
+    const int slices = topk_slices(cfg);
+    const std::size_t kk = topk_check(k, total_elems, slices, cfg);
+    if(kk == 0) return std::vector<XiSelected>();
+
+    XiInFile fin(in_path, std::ios::binary);
+    if(!fin) throw std::runtime_error("cannot open input file " + in_path);
+    const uint64_t flip = largest ? UINT64_MAX : 0;
+    std::vector<XiTopSel> sel(slices, XiTopSel(kk));
+    const std::size_t BLOCK = (total_elems < (1ULL << 20)) ? (std::size_t)total_elems : (1 << 20);
+    xi_vector<double> block(BLOCK);
+    auto t1 = std::chrono::steady_clock::now();
+    for(uint64_t first = 0; first < total_elems; ) {
+        cancel_point();
+        const std::size_t cnt = (total_elems - first < BLOCK) ? (std::size_t)(total_elems - first) : BLOCK;
+        {
+            XiSpan rspan("chunk_read", "io", "elems", (long long)cnt);
+            if(xi_read(fin, block.data(), cnt * sizeof(double), XI_FILE_INPUT) != cnt * sizeof(double))
+                throw std::runtime_error("I/O error while reading " + in_path);
+        }
+        XiSpan sspan("select", "cpu", "elems", (long long)cnt);
+        topk_offer(sel, block.data(), cnt, first, flip);
+        first += cnt;
+    }
+    cur_call().stats.run_ms = ms_between(t1, std::chrono::steady_clock::now());
+    return topk_finish(sel, kk, flip);
+}
+
+// Top-k (largest) or bottom-k of an on-disk column in one sequential read, with
+// memory proportional to k; result as for xi_topk. Throws std::runtime_error.
+std::vector<XiSelected> xi_topk_file(const std::string &in_path, uint64_t k, bool largest,
+                                     const XiSortConfig &cfg) {
+    XiCall call;
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_topk_file", "select");
+    std::vector<XiSelected> out = xi_topk_file_impl(in_path, k, largest, cfg);
+    stats_end(cfg.trace);
+    return out;
+}
+
+// ─── exact quantiles by key-histogram narrowing ─────────────────────────────────
+// xi_select_ranks_file finds the values of given sorted ranks without sorting. Pass 1
+// counts the top 16 bits of every double_to_key into a histogram; prefix sums place
+// each target rank in one bucket. Once the elements of all target buckets fit in
+// mem_limit, one more pass gathers and sorts them to resolve the ranks; otherwise
+// a pass histograms the next 12 bits inside those buckets and narrows again. The
+// per-thread histograms are kept within mem_limit by taking fewer bits per round
+// and, past that, a batch of buckets per pass. Each pass also records the min and
+// max key of every bucket it scans, so a bucket of one repeated value resolves its
+// ranks there. Typical data needs two sequential reads and no writes.
+
+// A rank being narrowed: its key prefix of `bits` bits, the count of elements whose
+// key lies below that prefix's range, and its slot in the result
+struct XiRankTarget {
+    uint64_t rank;
+    uint64_t prefix;
+    uint64_t below;
+    std::size_t out;
+};
+
+static void xi_select_ranks_file_impl(const std::string &in_path, const std::vector<uint64_t> &ranks,
+                                      std::vector<double> &out, const XiSortConfig &cfg) {
+    std::error_code ec;
+    const uint64_t total_bytes = std::filesystem::file_size(in_path, ec);
+    if(ec) throw std::runtime_error("cannot stat input file " + in_path);
+    if(total_bytes % sizeof(double)) throw std::runtime_error("input file size not multiple of 8 bytes");
+    const uint64_t total_elems = total_bytes / sizeof(double);
+    for(uint64_t r : ranks) {
+        if(r >= total_elems) throw std::runtime_error("rank out of range");
+    }
+    out.assign(ranks.size(), 0.0);
+    if(ranks.empty()) return;
+
+    XiInFile fin(in_path, std::ios::binary);
+    if(!fin) throw std::runtime_error("cannot open input file " + in_path);
+    const std::size_t BLOCK = (total_elems < (1ULL << 20)) ? (std::size_t)total_elems : (1 << 20);
+    xi_vector<double> block(BLOCK);
+    const long long S = topk_slices(cfg);
+    // One sequential pass; fn(slice, keys...) sees every element once, on a thread
+    // that charges its allocations to this call
+    XiCallState *cs = &cur_call();
+    auto pass = [&](const std::function<void(long long, const double *, std::size_t)> &fn) {
+        fin.clear();
+        fin.seekg(0);
+        for(uint64_t first = 0; first < total_elems; ) {
+            cancel_point();
+            const std::size_t cnt = (total_elems - first < BLOCK) ? (std::size_t)(total_elems - first) : BLOCK;
+            {
+                XiSpan rspan("chunk_read", "io", "elems", (long long)cnt);
+                if(xi_read(fin, block.data(), cnt * sizeof(double), XI_FILE_INPUT) != cnt * sizeof(double))
+                    throw std::runtime_error("I/O error while reading " + in_path);
+            }
+            #pragma omp parallel if(S > 1)
+            {
+                XiCallScope scope(cs);
+                #pragma omp for schedule(static, 1)
+                for(long long t = 0; t < S; ++t) {
+                    const std::size_t lo = cnt * (std::size_t)t / (std::size_t)S;
+                    const std::size_t hi = cnt * (std::size_t)(t + 1) / (std::size_t)S;
+                    fn(t, block.data() + lo, hi - lo);
+                }
+            }
+            first += cnt;
+        }
+        ++cur_call().stats.merge_rounds;
+    };
+
+    std::vector<XiRankTarget> tg(ranks.size());
+    for(std::size_t i = 0; i < ranks.size(); ++i) tg[i] = XiRankTarget{ranks[i], 0, 0, i};
+    const std::size_t budget = cfg.mem_limit / sizeof(uint64_t);
+    int bits = 0;
+    uint64_t candidates = total_elems;      // elements inside the distinct target prefixes
+    auto t1 = std::chrono::steady_clock::now();
+    while(!tg.empty() && bits < 64) {
+        // distinct prefixes still holding a target, and their element counts
+        std::vector<uint64_t> pre;
+        for(const XiRankTarget &t : tg) pre.push_back(t.prefix);
+        std::sort(pre.begin(), pre.end());
+        pre.erase(std::unique(pre.begin(), pre.end()), pre.end());
+        const int shift = 64 - bits;
+        // index of the key's prefix within pre[pb, pe), or -1
+        auto slot = [&](uint64_t key, std::size_t pb, std::size_t pe) -> long long {
+            if(bits == 0) return 0;
+            auto it = std::lower_bound(pre.begin() + pb, pre.begin() + pe, key >> shift);
+            return (it != pre.begin() + pe && *it == (key >> shift)) ? (long long)(it - pre.begin() - pb) : -1;
+        };
+        if(candidates <= budget) {
+            // ── gather the candidates and resolve every rank in memory ──
+            XiSpan span("gather", "select", "elems", (long long)candidates);
+            std::vector<xi_vector<uint64_t>> part(S);
+            pass([&](long long t, const double *x, std::size_t n) {
+                for(std::size_t i = 0; i < n; ++i) {
+                    const uint64_t key = double_to_key(x[i]);
+                    if(slot(key, 0, pre.size()) >= 0) part[t].push_back(key);
+                }
+            });
+            xi_vector<uint64_t> keys;
+            keys.reserve((std::size_t)candidates);
+            for(auto &p : part) {
+                keys.insert(keys.end(), p.begin(), p.end());
+                xi_vector<uint64_t>().swap(p);
+            }
+            std::sort(keys.begin(), keys.end());
+            // a target's prefix range starts at the first gathered key it covers;
+            // `below` counts the elements under that range
+            for(const XiRankTarget &t : tg) {
+                auto lo = (bits == 0) ? keys.begin()
+                        : std::lower_bound(keys.begin(), keys.end(), t.prefix << shift);
+                out[t.out] = key_to_double(*(lo + (std::ptrdiff_t)(t.rank - t.below)));
+            }
+            cur_call().stats.run_ms = ms_between(t1, std::chrono::steady_clock::now());
+            return;
+        }
+        // ── narrow: histogram the next bits inside each target prefix ──
+        // S histograms of prefixes x 2^step cells must fit the budget: take fewer
+        // bits first, then histogram the prefixes a batch per pass
+        int step = std::min((bits == 0) ? 16 : 12, 64 - bits);
+        while(step > 4 && (((uint64_t)S * pre.size()) << step) > budget) --step;
+        const std::size_t bins = (std::size_t)1 << step;
+        const int sub = 64 - bits - step;
+        const std::size_t batch = std::max<std::size_t>(1, std::min<std::size_t>(pre.size(), budget / ((std::size_t)S * bins)));
+        candidates = 0;
+        std::vector<uint64_t> seen;
+        std::vector<XiRankTarget> live;
+        for(std::size_t pb = 0; pb < pre.size(); pb += batch) {
+            const std::size_t pe = std::min(pre.size(), pb + batch);
+            const std::size_t cells = (pe - pb) * bins;
+            XiSpan span("histogram", "select", "bits", bits + step);
+            std::vector<xi_vector<uint64_t>> hist(S, xi_vector<uint64_t>(cells, 0));
+            std::vector<xi_vector<uint64_t>> mn(S, xi_vector<uint64_t>(pe - pb, UINT64_MAX));
+            std::vector<xi_vector<uint64_t>> mx(S, xi_vector<uint64_t>(pe - pb, 0));
+            pass([&](long long t, const double *x, std::size_t n) {
+                uint64_t *h = hist[t].data(), *lo = mn[t].data(), *hi = mx[t].data();
+                for(std::size_t i = 0; i < n; ++i) {
+                    const uint64_t key = double_to_key(x[i]);
+                    const long long p = slot(key, pb, pe);
+                    if(p < 0) continue;
+                    ++h[(std::size_t)p * bins + ((key >> sub) & (bins - 1))];
+                    lo[p] = (key < lo[p]) ? key : lo[p];
+                    hi[p] = (key > hi[p]) ? key : hi[p];
+                }
+            });
+            for(long long t = 1; t < S; ++t) {
+                for(std::size_t j = 0; j < cells; ++j) hist[0][j] += hist[t][j];
+                for(std::size_t j = 0; j < pe - pb; ++j) {
+                    mn[0][j] = std::min(mn[0][j], mn[t][j]);
+                    mx[0][j] = std::max(mx[0][j], mx[t][j]);
+                }
+            }
+            for(XiRankTarget t : tg) {
+                if(t.prefix < pre[pb] || t.prefix > pre[pe - 1]) continue;
+                const std::size_t p = (std::size_t)(std::lower_bound(pre.begin() + pb, pre.begin() + pe, t.prefix)
+                                                    - pre.begin() - pb);
+                if(mn[0][p] == mx[0][p]) {
+                    out[t.out] = key_to_double(mn[0][p]);   // the prefix holds one key
+                    continue;
+                }
+                const uint64_t *h = hist[0].data() + p * bins;
+                std::size_t b = 0;
+                while(t.below + h[b] <= t.rank) t.below += h[b++];
+                t.prefix = (t.prefix << step) | b;
+                if(std::find(seen.begin(), seen.end(), t.prefix) == seen.end()) {
+                    seen.push_back(t.prefix);
+                    candidates += h[b];
+                }
+                live.push_back(t);
+            }
+        }
+        tg.swap(live);
+        bits += step;
+    }
+    // 64 bits of prefix: the key itself
+    for(const XiRankTarget &t : tg) out[t.out] = key_to_double(t.prefix);
+    cur_call().stats.run_ms = ms_between(t1, std::chrono::steady_clock::now());
+}
+
+// Values of the given ranks (0-based, in the IEEE total order) of an on-disk column,
+// exact, in two or more sequential reads and no writes. xi_sort_stats().merge_rounds
+// is the number of passes. Throws std::runtime_error.
+std::vector<double> xi_select_ranks_file(const std::string &in_path, const std::vector<uint64_t> &ranks,
+                                         const XiSortConfig &cfg) {
+    XiCall call;
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_select_ranks_file", "select");
+    std::vector<double> out;
+    xi_select_ranks_file_impl(in_path, ranks, out, cfg);
+    stats_end(cfg.trace);
+    return out;
+}
+
+// Exact quantiles q in [0, 1] (the "lower" definition: the element of rank
+// floor(q * (n - 1))). Throws std::runtime_error.
+std::vector<double> xi_quantiles_file(const std::string &in_path, const std::vector<double> &qs,
+                                      const XiSortConfig &cfg) {
+    std::error_code ec;
+    const uint64_t n = std::filesystem::file_size(in_path, ec) / sizeof(double);
+    if(ec) throw std::runtime_error("cannot stat input file " + in_path);
+    std::vector<uint64_t> ranks;
+    for(double q : qs) {
+        if(!(q >= 0.0 && q <= 1.0)) throw std::runtime_error("quantile outside [0, 1]");
+        ranks.push_back(n ? (uint64_t)std::floor(q * (double)(n - 1)) : 0);
+    }
+    return xi_select_ranks_file(in_path, ranks, cfg);
+}
+
+// ─── sorted-file set operations ─────────────────────────────────────────────────
+// xi_set_op_files and xi_merge_join_files stream files already sorted in the IEEE
+// total order (xi_sort_file output) and compare keys, so -0/+0 and NaN payloads are
+// distinct values. A cursor that has to catch up with a larger key binary-searches its
+// buffered block; when the file has an .xidx sidecar it also seeks past every block the
+// fences rule out instead of reading it. Blocks that are read are checked for order.
+
+enum XiSetOp {
+    XI_SET_INTERSECT,    // distinct values present in every input
+    XI_SET_UNION,        // distinct values present in any input
+    XI_SET_UNION_ALL,    // every element of every input (a merge of the sorted files)
+    XI_SET_DIFFERENCE    // distinct values of the first input absent from all others
+};
+
+// One sorted input: a block buffer starting at element `base`, plus the sidecar fences
+struct XiSortedCursor {
+    XiInFile file;
+    std::string path;
+    xi_vector<double> buffer;
+    std::size_t idx;
+    uint64_t base;
+    uint64_t n;
+    uint64_t stride;                 // 0 without a sidecar
+    std::vector<uint64_t> fences;
+    uint64_t lastKey;                // largest key read so far (order check)
+};
+
+static void sorted_open(XiSortedCursor &c, const std::string &path) {
+    std::error_code ec;
+    const uint64_t bytes = std::filesystem::file_size(path, ec);
+    if(ec) throw std::runtime_error("cannot stat input file " + path);
+    if(bytes % sizeof(double)) throw std::runtime_error("input file size not multiple of 8 bytes");
+    c.path = path;
+    c.n = bytes / sizeof(double);
+    c.idx = 0;
+    c.base = 0;
+    c.lastKey = 0;
+    uint64_t elems = 0;
+    c.stride = load_index(path, elems, c.fences);
+    c.file.open(path, std::ios::binary);
+    if(!c.file) throw std::runtime_error("cannot open input file " + path);
+}
+
+// Make the current element available, reading the next block once the buffer is spent;
+// false at the end of the file
+static bool sorted_ready(XiSortedCursor &c, std::size_t bufElems) {
+    if(c.idx < c.buffer.size()) {
+        return true;
+    }
+    c.base += c.buffer.size();
+    c.buffer.clear();
+    c.idx = 0;
+    if(c.base >= c.n) {
+        return false;
+    }
+    cancel_point();
+    const std::size_t cnt = (c.n - c.base < bufElems) ? (std::size_t)(c.n - c.base) : bufElems;
+    XiSpan span("refill", "io", "bytes", (long long)(cnt * sizeof(double)));
+    c.buffer.resize(cnt);
+    if(xi_read(c.file, c.buffer.data(), cnt * sizeof(double), XI_FILE_INPUT) != cnt * sizeof(double))
+        throw std::runtime_error("I/O error while reading " + c.path);
+    for(double v : c.buffer) {
+        const uint64_t k = double_to_key(v);
+        if(k < c.lastKey) throw std::runtime_error(c.path + " is not sorted");
+        c.lastKey = k;
+    }
+    return true;
+}
+
+static inline uint64_t sorted_key(const XiSortedCursor &c) { return double_to_key(c.buffer[c.idx]); }
+static inline uint64_t sorted_pos(const XiSortedCursor &c) { return c.base + c.idx; }
+
+// Advance c to its first element whose key is >= key (upper: > key); false if there is
+// none. Whole blocks below the key are skipped through the fences when c has them.
+static bool sorted_seek(XiSortedCursor &c, uint64_t key, bool upper, std::size_t bufElems) {
+    auto below = [&](double v) { return upper ? double_to_key(v) <= key : double_to_key(v) < key; };
+    while(sorted_ready(c, bufElems)) {
+        if(!below(c.buffer.back())) {
+            c.idx = (std::size_t)(std::partition_point(c.buffer.begin() + c.idx, c.buffer.end(), below)
+                                  - c.buffer.begin());
+            return true;
+        }
+        uint64_t next = c.base + c.buffer.size();
+        if(c.stride) {
+            // fence j-1 is below the key, so is everything before it
+            auto it = upper ? std::upper_bound(c.fences.begin(), c.fences.end(), key)
+                            : std::lower_bound(c.fences.begin(), c.fences.end(), key);
+            const uint64_t j = (uint64_t)(it - c.fences.begin());
+            if(j > 0 && (j - 1) * c.stride > next) {
+                next = (j - 1) * c.stride;
+                c.file.clear();
+                c.file.seekg((std::streamoff)(next * sizeof(double)));
+            }
+        }
+        c.buffer.clear();
+        c.idx = 0;
+        c.base = next;
+    }
+    return false;
+}
+
+// Position every cursor on the smallest key >= target that all of them hold; false
+// once one runs out
+static bool sorted_intersect(std::vector<XiSortedCursor> &in, uint64_t &target, std::size_t bufElems) {
+    for(std::size_t i = 0, agree = 0; agree < in.size(); i = (i + 1) % in.size()) {
+        if(!sorted_seek(in[i], target, false, bufElems)) return false;
+        const uint64_t k = sorted_key(in[i]);
+        if(k == target) {
+            ++agree;
+        } else {
+            target = k;
+            agree = 1;
+        }
+    }
+    return true;
+}
+
+static uint64_t xi_set_op_files_impl(const std::vector<std::string> &inputs, const std::string &out_path,
+                                     XiSetOp op, const XiSortConfig &cfg) {
+    if(inputs.empty()) throw std::runtime_error("set operation without inputs");
+    const std::size_t BUF = cfg.buffer_elems ? cfg.buffer_elems : 1;
+    std::vector<XiSortedCursor> in(inputs.size());
+    for(std::size_t i = 0; i < inputs.size(); ++i) sorted_open(in[i], inputs[i]);
+
+    XiScratch scratch;
+    scratch.add(out_path);
+    std::error_code ec;
+    std::filesystem::remove(out_path + XI_INDEX_SUFFIX, ec);
+    XiOutFile fout(out_path, std::ios::binary);
+    if(!fout) throw std::runtime_error("cannot open output file " + out_path);
+    XiRunWriter out(fout, BUF, XI_FILE_OUTPUT);
+    uint64_t written = 0;
+    auto t1 = std::chrono::steady_clock::now();
+    if(op == XI_SET_UNION_ALL) {
+        // copy from the smallest cursor every buffered element up to the next smallest key
+        for(;;) {
+            std::size_t m = SIZE_MAX;
+            uint64_t second = UINT64_MAX;
+            for(std::size_t i = 0; i < in.size(); ++i) {
+                if(!sorted_ready(in[i], BUF)) continue;
+                const uint64_t k = sorted_key(in[i]);
+                if(m == SIZE_MAX || k < sorted_key(in[m])) {
+                    if(m != SIZE_MAX) second = sorted_key(in[m]);
+                    m = i;
+                } else if(k < second) {
+                    second = k;
+                }
+            }
+            if(m == SIZE_MAX) break;
+            XiSortedCursor &c = in[m];
+            const std::size_t end = (std::size_t)(std::partition_point(c.buffer.begin() + c.idx, c.buffer.end(),
+                [&](double v) { return double_to_key(v) <= second; }) - c.buffer.begin());
+            out.put(c.buffer.data() + c.idx, end - c.idx);
+            written += end - c.idx;
+            c.idx = end;
+        }
+    } else if(op == XI_SET_UNION) {
+        for(;;) {
+            std::size_t m = SIZE_MAX;
+            for(std::size_t i = 0; i < in.size(); ++i) {
+                if(sorted_ready(in[i], BUF) && (m == SIZE_MAX || sorted_key(in[i]) < sorted_key(in[m]))) m = i;
+            }
+            if(m == SIZE_MAX) break;
+            const uint64_t key = sorted_key(in[m]);
+            out.put(&in[m].buffer[in[m].idx], 1);
+            ++written;
+            for(XiSortedCursor &c : in) sorted_seek(c, key, true, BUF);
+        }
+    } else if(op == XI_SET_INTERSECT) {
+        uint64_t target = 0;
+        while(sorted_intersect(in, target, BUF)) {
+            out.put(&in[0].buffer[in[0].idx], 1);
+            ++written;
+            if(target == UINT64_MAX) break;
+            ++target;
+        }
+    } else {
+        while(sorted_ready(in[0], BUF)) {
+            const uint64_t key = sorted_key(in[0]);
+            bool found = false;
+            for(std::size_t i = 1; i < in.size() && !found; ++i) {
+                found = sorted_seek(in[i], key, false, BUF) && sorted_key(in[i]) == key;
+            }
+            if(!found) {
+                out.put(&in[0].buffer[in[0].idx], 1);
+                ++written;
+            }
+            sorted_seek(in[0], key, true, BUF);
+        }
+    }
+    out.flush();
+    fout.close();
+    if(!fout) throw std::runtime_error("I/O error while writing " + out_path);
+    scratch.keep(out_path);
+    cur_call().stats.merge_rounds = 1;
+    cur_call().stats.merge_ms = ms_between(t1, std::chrono::steady_clock::now());
+    return written;
+}
+
+// Set operation `op` over files sorted in the IEEE total order; out_path receives the
+// result as doubles, ascending. Returns the number of elements written. Throws
+// std::runtime_error, also for an input found out of order.
+uint64_t xi_set_op_files(const std::vector<std::string> &inputs, const std::string &out_path, XiSetOp op,
+                         const XiSortConfig &cfg) {
+    XiCall call;
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_set_op_files", "merge");
+    const uint64_t written = xi_set_op_files_impl(inputs, out_path, op, cfg);
+    stats_end(cfg.trace);
+    return written;
+}
+
+static uint64_t xi_merge_join_files_impl(const std::string &left_path, const std::string &right_path,
+                                         const std::string &pairs_path, const XiSortConfig &cfg) {
+    const std::size_t BUF = cfg.buffer_elems ? cfg.buffer_elems : 1;
+    std::vector<XiSortedCursor> in(2);
+    sorted_open(in[0], left_path);
+    sorted_open(in[1], right_path);
+
+    XiScratch scratch;
+    scratch.add(pairs_path);
+    XiOutFile fout(pairs_path, std::ios::binary);
+    if(!fout) throw std::runtime_error("cannot open output file " + pairs_path);
+    XiBlockWriter<uint64_t> out(fout, 2 * BUF, XI_FILE_OUTPUT);
+    uint64_t pairs = 0;
+    int poll = XI_CANCEL_POLL;
+    auto t1 = std::chrono::steady_clock::now();
+    uint64_t target = 0;
+    while(sorted_intersect(in, target, BUF)) {
+        // both equal-key stretches, each found by a bounded seek past the key
+        const uint64_t l0 = sorted_pos(in[0]), r0 = sorted_pos(in[1]);
+        sorted_seek(in[0], target, true, BUF);
+        sorted_seek(in[1], target, true, BUF);
+        const uint64_t l1 = sorted_pos(in[0]), r1 = sorted_pos(in[1]);
+        for(uint64_t l = l0; l < l1; ++l) {
+            for(uint64_t r = r0; r < r1; ++r) {
+                const uint64_t pair[2] = {l, r};
+                out.put(pair, 2);
+                if(--poll == 0) {
+                    poll = XI_CANCEL_POLL;
+                    cancel_point();
+                }
+            }
+        }
+        pairs += (l1 - l0) * (r1 - r0);
+        if(target == UINT64_MAX) break;
+        ++target;
+    }
+    out.flush();
+    fout.close();
+    if(!fout) throw std::runtime_error("I/O error while writing " + pairs_path);
+    scratch.keep(pairs_path);
+    cur_call().stats.merge_rounds = 1;
+    cur_call().stats.merge_ms = ms_between(t1, std::chrono::steady_clock::now());
+    return pairs;
+}
+
+// Equi-join of two files sorted in the IEEE total order: pairs_path receives one
+// (left position, right position) uint64 pair per pair of equal elements, ordered by
+// value, then left, then right position. Positions index the sorted files; an
+// xi_argsort_file permutation maps them back to input rows. Returns the pair count.
+// Throws std::runtime_error.
+uint64_t xi_merge_join_files(const std::string &left_path, const std::string &right_path,
+                             const std::string &pairs_path, const XiSortConfig &cfg) {
+    XiCall call;
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_merge_join_files", "merge");
+    const uint64_t pairs = xi_merge_join_files_impl(left_path, right_path, pairs_path, cfg);
+    stats_end(cfg.trace);
+    return pairs;
+}
+
+// ─── bounded-disorder reorder ───────────────────────────────────────────────────
+// XiReorderBuffer sorts a stream in which every value lies at most `window` positions
+// from its sorted place. A min-heap of keys holds `window` values and releases its
+// minimum for each further push, so a value leaves at most `window` pushes after it
+// arrives. A value below one already released (the bound was exceeded) is late: it
+// goes to a spill file, which xi_reorder_file sorts externally and merges back in.
+
+class XiReorderBuffer {
+    xi_vector<uint64_t> heap;       // min-heap of keys
+    std::size_t window;
+    uint64_t lastKey;               // key of the last value released
+    bool released;
+    uint64_t lateCount;
+    std::string spillPath;
+    XiOutFile spill;
+    xi_vector<double> spillBuf;
+
+    static const std::size_t SPILL_BLOCK = 4096;
+
+    void release(std::vector<double> &out) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<uint64_t>());
+        lastKey = heap.back();
+        released = true;
+        out.push_back(key_to_double(lastKey));
+        heap.pop_back();
+    }
+    void flush_spill() {
+        if(spillBuf.empty()) return;
+        if(!spill.is_open()) {
+            spill.open(spillPath, std::ios::binary);
+            if(!spill) throw std::runtime_error("cannot open spill file " + spillPath);
+        }
+        xi_write(spill, spillBuf.data(), spillBuf.size() * sizeof(double), XI_FILE_RUN);
+        spillBuf.clear();
+    }
+
+public:
+    // Late values are appended to spill_path; with no path a late value throws
+    explicit XiReorderBuffer(std::size_t window_, const std::string &spill_path = std::string())
+        : window(window_), lastKey(0), released(false), lateCount(0), spillPath(spill_path) {
+        heap.reserve(window + 1);
+    }
+
+    // Push one value; values that became final are appended to out, in order
+    void push(double x, std::vector<double> &out) {
+        const uint64_t k = double_to_key(x);
+        if(released && k < lastKey) {
+            if(spillPath.empty()) throw std::runtime_error("reorder window exceeded");
+            ++lateCount;
+            spillBuf.push_back(x);
+            if(spillBuf.size() == SPILL_BLOCK) flush_spill();
+            return;
+        }
+        heap.push_back(k);
+        std::push_heap(heap.begin(), heap.end(), std::greater<uint64_t>());
+        if(heap.size() > window) release(out);
+    }
+    void push(const double *p, std::size_t n, std::vector<double> &out) {
+        for(std::size_t i = 0; i < n; ++i) push(p[i], out);
+    }
+
+    // End of stream: release every held value and close the spill file
+    void finish(std::vector<double> &out) {
+        while(!heap.empty()) release(out);
+        flush_spill();
+        if(spill.is_open()) {
+            spill.close();
+            if(!spill) throw std::runtime_error("I/O error while writing " + spillPath);
+        }
+    }
+
+    std::size_t held() const { return heap.size(); }
+    uint64_t late() const { return lateCount; }     // values sent to the spill file
+};
+
+static uint64_t xi_reorder_file_impl(const std::string &in_path, const std::string &out_path,
+                                     std::size_t window, const XiSortConfig &cfg) {
+    std::error_code ec;
+    const uint64_t total_bytes = std::filesystem::file_size(in_path, ec);
+    if(ec) throw std::runtime_error("cannot stat input file " + in_path);
+    if(total_bytes % sizeof(double)) throw std::runtime_error("input file size not multiple of 8 bytes");
+    if(window >= cfg.mem_limit / sizeof(uint64_t)) throw std::runtime_error("reorder window does not fit in mem_limit");
+    const uint64_t total_elems = total_bytes / sizeof(double);
+    const std::size_t BUF = cfg.buffer_elems ? cfg.buffer_elems : 1;
+
+    XiInFile fin(in_path, std::ios::binary);
+    if(!fin) throw std::runtime_error("cannot open input file " + in_path);
+    XiScratch scratch;
+    const std::string spill_path = scratch_path(cfg, "xisort_lagrun", 0);
+    scratch.add(spill_path);
+    scratch.add(out_path);
+    std::filesystem::remove(out_path + XI_INDEX_SUFFIX, ec);
+    XiReorderBuffer rb(window, spill_path);
+    double stream_ms;
+    {
+        XiOutFile fout(out_path, std::ios::binary);
+        if(!fout) throw std::runtime_error("cannot open output file " + out_path);
+        XiRunWriter out(fout, BUF, XI_FILE_OUTPUT);
+        xi_vector<double> buf(BUF);
+        std::vector<double> ready;
+        auto t1 = std::chrono::steady_clock::now();
+        for(uint64_t first = 0; first < total_elems; ) {
+            cancel_point();
+            const std::size_t cnt = (total_elems - first < BUF) ? (std::size_t)(total_elems - first) : BUF;
+            if(xi_read(fin, buf.data(), cnt * sizeof(double), XI_FILE_INPUT) != cnt * sizeof(double))
+                throw std::runtime_error("I/O error while reading " + in_path);
+            ready.clear();
+            rb.push(buf.data(), cnt, ready);
+            out.put(ready.data(), ready.size());
+            first += cnt;
+        }
+        ready.clear();
+        rb.finish(ready);
+        out.put(ready.data(), ready.size());
+        out.flush();
+        fout.close();
+        if(!fout) throw std::runtime_error("I/O error while writing " + out_path);
+        stream_ms = ms_between(t1, std::chrono::steady_clock::now());
+    }
+    if(rb.late()) {
+        // out_path holds the in-order part; sort the late values and merge them in
+        auto t2 = std::chrono::steady_clock::now();
+        const std::string main_path = scratch_path(cfg, "xisort_lagmain", 0);
+        const std::string late_path = scratch_path(cfg, "xisort_lagrun", 1);
+        scratch.add(main_path);
+        scratch.add(late_path);
+        std::filesystem::rename(out_path, main_path);
+        XiSortConfig late_cfg = cfg;
+        late_cfg.index_stride = 0;
+        xi_sort_file_impl(spill_path, late_path, late_cfg);
+        xi_set_op_files_impl({main_path, late_path}, out_path, XI_SET_UNION_ALL, cfg);
+        cur_call().stats.merge_ms = ms_between(t2, std::chrono::steady_clock::now());
+    }
+    cur_call().stats.run_ms = stream_ms;     // the late-value sort above reports its own phases
+    scratch.keep(out_path);
+    return rb.late();
+}
+
+// Sort a nearly sorted file in one streaming pass: values at most `window` positions
+// from their sorted place cost a heap of window keys (mem_limit must hold it). Values
+// further out are spilled, sorted with the external path and merged back, so the output
+// is always fully sorted. Returns the number of spilled (late) values. STRICT mode
+// only. Throws std::runtime_error.
+uint64_t xi_reorder_file(const std::string &in_path, const std::string &out_path, std::size_t window,
+                         const XiSortConfig &cfg) {
+    XiCall call;
+    if(cfg.mode != XI_MODE_STRICT) throw std::runtime_error("reorder supports STRICT mode only");
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_reorder_file", "sort");
+    const uint64_t late = xi_reorder_file_impl(in_path, out_path, window, cfg);
+    stats_end(cfg.trace);
+    return late;
+}
+
+// ─── asynchronous file sort ───────────────────────────────────────────────────
+// xi_sort_file_async queues xi_sort_file on one shared background thread (CPU work
+// still uses the OpenMP pool when cfg.parallel is set) and returns at once. Tasks run
+// one at a time in submission order; a task cancelled while queued never starts, and
+// cfg.timeout_ms counts from the moment its sort starts. The task can be polled,
+// waited on, given completion callbacks (e.g. one that posts to an event loop) or,
+// under C++20, co_awaited. Callbacks run on the background thread, so they must not
+// wait for a task queued after their own.
+
+// The background thread and its FIFO; started by the first task and never stopped
+// (heap-allocated so it outlives static destruction)
+class XiTaskQueue {
+    std::mutex m;
+    std::condition_variable cv;
+    std::queue<std::function<void()>> jobs;
+    bool started = false;
+
+    void run() {
+        for(;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                cv.wait(lk, [this] { return !jobs.empty(); });
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+            job();
+        }
+    }
+
+public:
+    static XiTaskQueue &get() {
+        static XiTaskQueue *q = new XiTaskQueue();
+        return *q;
+    }
+    void post(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            jobs.push(std::move(job));
+            if(!started) {
+                started = true;
+                std::thread([this] { run(); }).detach();
+            }
+        }
+        cv.notify_one();
+    }
+};
+
+class XiSortTask {
+    struct State {
+        std::atomic<bool> cancel{false};
+        std::mutex m;
+        std::condition_variable cv;
+        bool finished = false;      // result stored, continuation taken
+        bool done = false;          // continuation returned: waiters may go
+        std::thread::id runner;
+        std::exception_ptr error;
+        XiSortStats stats = XiSortStats();
+        std::function<void()> then;
+    };
+    std::shared_ptr<State> st;
+    friend XiSortTask xi_sort_file_async(const std::string &, const std::string &, const XiSortConfig &);
+
+    State &state() const {
+        if(!st) throw std::runtime_error("XiSortTask has no sort");
+        return *st;
+    }
+    // The continuation itself may call get(): on the sorting thread the result counts
+    // as available once it is stored. Caller holds st->m.
+    bool settled() const {
+        return st->done || (st->finished && st->runner == std::this_thread::get_id());
+    }
+    // Stores the result, runs the continuation, then wakes waiters, so get() never
+    // returns before a callback registered earlier has run
+    void finish(std::exception_ptr err, const XiSortStats &stats) {
+        std::function<void()> f;
+        {
+            std::lock_guard<std::mutex> lk(st->m);
+            st->error = err;
+            st->stats = stats;
+            st->runner = std::this_thread::get_id();
+            st->finished = true;
+            f.swap(st->then);
+        }
+        if(f) f();
+        {
+            std::lock_guard<std::mutex> lk(st->m);
+            st->done = true;
+        }
+        st->cv.notify_all();
+    }
+    void stop() {
+        if(st && !ready()) {
+            cancel();
+            wait();
+        }
+    }
+    // Appends f to the continuation. Caller holds st->m.
+    void chain(std::function<void()> f) {
+        if(!st->then) {
+            st->then = std::move(f);
+            return;
+        }
+        std::function<void()> first = std::move(st->then);
+        st->then = [first, f] {
+            first();
+            f();
+        };
+    }
+
+public:
+    XiSortTask() {}
+    XiSortTask(XiSortTask &&) = default;
+    // An unfinished task is cancelled and waited for, so no sort outlives its handle
+    XiSortTask &operator=(XiSortTask &&o) {
+        if(this != &o) {
+            stop();
+            st = std::move(o.st);
+        }
+        return *this;
+    }
+    ~XiSortTask() { stop(); }
+
+    // false for a default-constructed or moved-from task
+    bool valid() const { return (bool)st; }
+    void cancel() {
+        if(st) st->cancel.store(true, std::memory_order_relaxed);
+    }
+    bool ready() const {
+        if(!st) return false;
+        std::lock_guard<std::mutex> lk(st->m);
+        return settled();
+    }
+    void wait() const {
+        std::unique_lock<std::mutex> lk(state().m);
+        st->cv.wait(lk, [this] { return settled(); });
+    }
+    template <class Rep, class Period>
+    bool wait_for(const std::chrono::duration<Rep, Period> &d) const {
+        std::unique_lock<std::mutex> lk(state().m);
+        return st->cv.wait_for(lk, d, [this] { return settled(); });
+    }
+    // Waits, then rethrows the sort's exception (XiCancelled after cancel()) or
+    // returns its statistics
+    XiSortStats get() const {
+        wait();
+        if(st->error) std::rethrow_exception(st->error);
+        return st->stats;
+    }
+    // Runs f on the sorting thread when the sort ends, before waiters are released, or
+    // right away if it has. Callbacks run in the order they were added.
+    void then(std::function<void()> f) {
+        {
+            std::lock_guard<std::mutex> lk(state().m);
+            if(!st->finished) {
+                chain(std::move(f));
+                return;
+            }
+        }
+        f();
+    }
+#ifdef XISORT_COROUTINES
+    // co_await task: resumes the coroutine on the sorting thread (after any earlier
+    // then() callback), yields get(); a task that has already finished does not suspend
+    bool await_ready() const { return ready(); }
+    bool await_suspend(std::coroutine_handle<> h) {
+        std::lock_guard<std::mutex> lk(state().m);
+        if(st->finished) return false;
+        chain([h] { h.resume(); });
+        return true;
+    }
+    XiSortStats await_resume() const { return get(); }
+#endif
+};
+
+// Starts xi_sort_file(in_path, out_path, cfg) in the background. cfg.cancel is
+// replaced by the task's own flag (XiSortTask::cancel).
+XiSortTask xi_sort_file_async(const std::string &in_path, const std::string &out_path, const XiSortConfig &cfg) {
+    XiSortTask task;
+    task.st = std::make_shared<XiSortTask::State>();
+    XiSortConfig run_cfg = cfg;
+    run_cfg.cancel = &task.st->cancel;
+    std::shared_ptr<XiSortTask::State> st = task.st;
+    XiTaskQueue::get().post([st, in_path, out_path, run_cfg]() {
+        XiSortTask self;
+        self.st = st;
+        std::exception_ptr err;
+        XiSortStats stats = XiSortStats();
+        try {
+            if(st->cancel.load(std::memory_order_relaxed)) throw XiCancelled();
+            xi_sort_file(in_path, out_path, run_cfg);
+            stats = xi_sort_stats();
+        } catch(...) {
+            err = std::current_exception();
+        }
+        self.finish(err, stats);
+        self.st.reset();
+    });
+    return task;
+}
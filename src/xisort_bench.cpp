@@ -0,0 +1,917 @@
+// xisort_bench.cpp  — Comparative benchmark harness for XiSort v36.5
+// AUTHOR: Faruk Alpay  •  ORCID: 0009-0009-2207-6528
+// -----------------------------------------------------------------------------
+// Runs identical inputs through every xi_sort engine and through the standard
+// library baselines (std::sort / std::stable_sort keyed by double_to_key, and
+// std::sort(std::execution::par_unseq) when a parallel STL backend is linked).
+// Every engine's output is compared bit-for-bit against the stable reference,
+// so a speedup is only reported for an engine that produced the exact order.
+//
+// Suites (--suite=):
+//   compare   engines vs. standard-library baselines at one size (default)
+//   scaling   thread sweep 1..nproc per engine and size: strong and weak
+//             scaling efficiency next to a STREAM-style bandwidth roofline
+//   external  file-to-file tier (256 MB .. 8 GB) with a tiny mem_limit so
+//             many runs are merged; optional throttled-disk emulation
+//   gate      fixed subset whose median throughput is compared against a
+//             committed per-machine-class baseline; exits non-zero on a
+//             regression beyond the noise-aware threshold
+//
+// Build:
+//   cmake --build build --target xisort_bench
+//   make bench                       (PSTL=1 links TBB for par_unseq)
+// Run:
+//   ./xisort_bench [--suite=compare|scaling|external|gate] [--n=<elems>] [--sizes=a,b,..]
+//                  [--threads=a,b,..] [--reps=<k>] [--dist=a,b,..]
+//                  [--engines=a,b,..] [--json=<report.json>]
+//                  [--bytes=256M,1G,..] [--mem-limit=<bytes>] [--scratch=<dir>]
+//                  [--throttle-mbps=<x>] [--throttle-latency-us=<x>]
+//                  [--baseline-dir=<dir>] [--machine-class=<name>]
+//                  [--threshold=<frac>] [--update-baseline]
+// -----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if defined(XISORT_HAVE_PSTL) && __has_include(<execution>)
+#include <execution>
+#define XISORT_BENCH_PAR_UNSEQ 1
+#if __has_include(<tbb/global_control.h>)
+#include <tbb/global_control.h>
+#define XISORT_BENCH_TBB_CONTROL 1
+#endif
+#endif
+
+#include "xisort.cpp"   // core sorter + XiSortConfig + double_to_key
+#include "xisort_gen.cpp"   // reproducible input distributions
+
+using Clock = std::chrono::steady_clock;
+
+// ─── error & timing helpers ──────────────────────────────────────────────────
+static void die(const std::string &msg) {
+    std::cerr << "[xisort_bench] " << msg << "\n";
+    std::exit(EXIT_FAILURE);
+}
+static inline double ms_since(const Clock::time_point &t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+static std::vector<std::string> split_list(const std::string &s) {
+    std::vector<std::string> out;
+    std::size_t start = 0;
+    while (start <= s.size()) {
+        std::size_t comma = s.find(',', start);
+        if (comma == std::string::npos) comma = s.size();
+        if (comma > start) out.push_back(s.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return out;
+}
+static double median(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    std::size_t m = v.size() / 2;
+    return (v.size() % 2) ? v[m] : 0.5 * (v[m - 1] + v[m]);
+}
+static std::vector<std::size_t> parse_sizes(const std::string &s) {
+    std::vector<std::size_t> out;
+    for (const auto &tok : split_list(s)) out.push_back(std::stoull(tok));
+    return out;
+}
+// "256M" / "8G" / "4096" → bytes
+static std::uint64_t parse_bytes(const std::string &tok) {
+    std::size_t pos = 0;
+    std::uint64_t v = std::stoull(tok, &pos);
+    if (pos < tok.size()) {
+        switch (tok[pos]) {
+            case 'K': case 'k': v <<= 10; break;
+            case 'M': case 'm': v <<= 20; break;
+            case 'G': case 'g': v <<= 30; break;
+            default: die("bad size " + tok);
+        }
+    }
+    return v;
+}
+static int hardware_threads() {
+#ifdef _OPENMP
+    return omp_get_num_procs();
+#else
+    return 1;
+#endif
+}
+
+// ─── input distributions ─────────────────────────────────────────────────────
+static bool make_input(const std::string &dist, std::size_t n, std::vector<double> &v) {
+    XiGenDist d;
+    if (!xi_gen_parse(dist, d)) return false;
+    v.resize(n);
+    xi_gen_fill(d, 0x5EEDULL ^ n, v);
+    return true;
+}
+
+// ─── engines ─────────────────────────────────────────────────────────────────
+struct Engine {
+    std::string name;
+    std::function<void(std::vector<double>&)> run;
+    bool threaded;      // responds to the worker-thread count
+};
+
+static inline bool key_less(double a, double b) {
+    return double_to_key(a) < double_to_key(b);
+}
+
+static std::vector<Engine> all_engines(std::size_t n, const std::string &scratch) {
+    std::vector<Engine> e;
+    e.push_back({"xi_sort/serial", [](std::vector<double> &v) {
+        XiSortConfig cfg; cfg.parallel = false;
+        xi_sort(v.data(), v.size(), cfg);
+    }, false});
+    e.push_back({"xi_sort/no-gallop", [](std::vector<double> &v) {
+        XiSortConfig cfg; cfg.parallel = false; cfg.gallop = false;
+        xi_sort(v.data(), v.size(), cfg);
+    }, false});
+    e.push_back({"xi_sort/key-only", [](std::vector<double> &v) {
+        XiSortConfig cfg; cfg.parallel = false; cfg.tie_break = XI_TIE_VALUE;
+        xi_sort(v.data(), v.size(), cfg);
+    }, false});
+    e.push_back({"xi_sort/parallel", [](std::vector<double> &v) {
+        XiSortConfig cfg; cfg.parallel = true;
+        xi_sort(v.data(), v.size(), cfg);
+    }, true});
+    // eight runs on disk, then the pairwise file merge
+    const std::size_t ext_limit = ((n + 7) / 8) * sizeof(double);
+    e.push_back({"xi_sort/external", [ext_limit, scratch](std::vector<double> &v) {
+        XiSortConfig cfg; cfg.external = true; cfg.mem_limit = ext_limit; cfg.scratch_dir = scratch;
+        xi_sort(v.data(), v.size(), cfg);
+    }, false});
+    e.push_back({"std::sort", [](std::vector<double> &v) {
+        std::sort(v.begin(), v.end(), key_less);
+    }, false});
+    e.push_back({"std::stable_sort", [](std::vector<double> &v) {
+        std::stable_sort(v.begin(), v.end(), key_less);
+    }, false});
+#ifdef XISORT_BENCH_PAR_UNSEQ
+    e.push_back({"std::sort/par_unseq", [](std::vector<double> &v) {
+        std::sort(std::execution::par_unseq, v.begin(), v.end(), key_less);
+    }, true});
+#endif
+    return e;
+}
+
+// ─── thread control ──────────────────────────────────────────────────────────
+// OpenMP drives xi_sort; TBB (when linked) drives par_unseq.
+struct ThreadScope {
+#ifdef XISORT_BENCH_TBB_CONTROL
+    tbb::global_control tbb_ctl;
+#endif
+    explicit ThreadScope(int p)
+#ifdef XISORT_BENCH_TBB_CONTROL
+        : tbb_ctl(tbb::global_control::max_allowed_parallelism, static_cast<std::size_t>(p))
+#endif
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(p);
+#endif
+        (void)p;
+    }
+};
+
+// ─── options & report ────────────────────────────────────────────────────────
+struct Options {
+    std::string suite = "compare";
+    std::size_t n = 10'000'000;
+    std::vector<std::size_t> sizes = {1'000'000, 4'000'000};
+    std::vector<int> threads;                 // empty = 1,2,4,..,nproc
+    int reps = 3;
+    std::vector<std::string> dists = {"uniform", "normal", "dups", "sorted", "reverse", "ieee"};
+    bool dists_given = false;
+    std::vector<std::string> engines;         // empty = all
+    std::string json_path;
+    bool reps_given = false;
+    // external tier
+    std::vector<std::uint64_t> bytes = {256ULL << 20, 1ULL << 30};
+    std::size_t mem_limit = 16ULL << 20;
+    std::string scratch = ".";
+    double throttle_mbps = 0.0;
+    double throttle_latency_us = 0.0;
+    // regression gate
+    std::string baseline_dir = "bench/baselines";
+    std::string machine_class;                // empty = $XISORT_MACHINE_CLASS or <arch>-<nproc>c
+    double threshold = 0.10;                  // minimum tolerated drop in throughput
+    bool update_baseline = false;
+};
+
+struct Result {
+    std::string dist;
+    std::string engine;
+    std::size_t n;
+    double median_ms;
+    double mb_per_s;
+    double speedup;     // vs std::sort on the same input
+    bool identical;
+};
+
+static void write_json(const std::string &path, const std::vector<Result> &res) {
+    std::ofstream out(path);
+    if (!out) die("cannot open JSON report " + path);
+    out << "{\n  \"suite\": \"compare\",\n  \"results\": [\n";
+    for (std::size_t i = 0; i < res.size(); ++i) {
+        const Result &r = res[i];
+        out << "    {\"dist\": \"" << r.dist << "\", \"engine\": \"" << r.engine
+            << "\", \"n\": " << r.n << ", \"median_ms\": " << r.median_ms
+            << ", \"mb_per_s\": " << r.mb_per_s << ", \"speedup\": " << r.speedup
+            << ", \"identical\": " << (r.identical ? "true" : "false") << "}"
+            << (i + 1 < res.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+static std::vector<Engine> select_engines(const Options &o, std::size_t n, bool threaded_only) {
+    std::vector<Engine> engines;
+    for (auto &e : all_engines(n, o.scratch)) {
+        if (threaded_only && !e.threaded && e.name != "xi_sort/serial") continue;
+        if (o.engines.empty() || std::find(o.engines.begin(), o.engines.end(), e.name) != o.engines.end())
+            engines.push_back(e);
+    }
+    if (engines.empty()) die("no engine selected");
+    return engines;
+}
+
+// times one engine on `input`; returns the median and checks the output bits
+static double time_engine(const Engine &e, const std::vector<double> &input,
+                          const std::vector<double> &reference, int reps,
+                          std::vector<double> &work, bool &identical) {
+    std::vector<double> times;
+    identical = true;
+    for (int r = 0; r < reps; ++r) {
+        work = input;
+        auto t0 = Clock::now();
+        e.run(work);
+        times.push_back(ms_since(t0));
+        // bitwise comparison: ±0 and NaN payloads must land exactly
+        if (std::memcmp(work.data(), reference.data(), input.size() * sizeof(double)) != 0)
+            identical = false;
+    }
+    return median(times);
+}
+
+// ─── suite: compare ──────────────────────────────────────────────────────────
+static bool run_compare(const Options &o)
+{
+    const std::size_t n = o.n;
+    std::vector<Engine> engines = select_engines(o, n, false);
+
+    std::cout << "===== XiSort comparative benchmark =====\n"
+              << "n = " << n << " doubles (" << (n * sizeof(double)) / 1.0e6
+              << " MB), reps = " << o.reps << "\n";
+#ifndef XISORT_BENCH_PAR_UNSEQ
+    std::cout << "(std::sort/par_unseq unavailable: build with a parallel STL backend)\n";
+#endif
+
+    std::vector<Result> results;
+    bool all_identical = true;
+    std::vector<double> input, reference, work;
+
+    for (const auto &dist : o.dists) {
+        if (!make_input(dist, n, input)) die("unknown distribution " + dist);
+        reference = input;
+        std::stable_sort(reference.begin(), reference.end(), key_less);
+
+        std::cout << "\n[" << dist << "]\n"
+                  << std::left << std::setw(22) << "engine"
+                  << std::right << std::setw(12) << "median ms"
+                  << std::setw(12) << "MB/s"
+                  << std::setw(10) << "speedup"
+                  << "  output\n";
+
+        std::size_t first = results.size();
+        double std_sort_ms = 0.0;
+        for (const auto &e : engines) {
+            bool identical = true;
+            double med = time_engine(e, input, reference, o.reps, work, identical);
+            if (e.name == "std::sort") std_sort_ms = med;
+            results.push_back({dist, e.name, n, med,
+                               (n * sizeof(double)) / 1.0e6 / (med / 1000.0), 0.0, identical});
+            all_identical = all_identical && identical;
+        }
+        for (std::size_t i = first; i < results.size(); ++i) {
+            Result &r = results[i];
+            r.speedup = (std_sort_ms > 0.0 && r.median_ms > 0.0) ? std_sort_ms / r.median_ms : 0.0;
+            std::cout << std::left << std::setw(22) << r.engine << std::right
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(12) << r.median_ms
+                      << std::setw(12) << r.mb_per_s
+                      << std::setw(9) << r.speedup << "x"
+                      << "  " << (r.identical ? "identical" : "MISMATCH") << "\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+    if (!o.json_path.empty()) write_json(o.json_path, results);
+
+    std::cout << "\nspeedup is std::sort median / engine median on the same input\n";
+    return all_identical;
+}
+
+// ─── suite: scaling ──────────────────────────────────────────────────────────
+// STREAM-style kernels over arrays far larger than the last-level cache;
+// the best of `reps` trials is kept, as in McCalpin's STREAM.
+struct Bandwidth {
+    double copy_gbs;
+    double triad_gbs;
+};
+
+static Bandwidth measure_stream(std::size_t elems, int reps) {
+    std::vector<double> a(elems), b(elems), c(elems);
+    const long long N = static_cast<long long>(elems);
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < N; ++i) { a[i] = 1.0; b[i] = 2.0; c[i] = 0.0; }
+
+    double best_copy = 1e300, best_triad = 1e300;
+    for (int r = 0; r < reps; ++r) {
+        auto t0 = Clock::now();
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < N; ++i) c[i] = a[i];
+        best_copy = std::min(best_copy, ms_since(t0));
+
+        t0 = Clock::now();
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < N; ++i) a[i] = b[i] + 3.0 * c[i];
+        best_triad = std::min(best_triad, ms_since(t0));
+    }
+    const double bytes = static_cast<double>(elems) * sizeof(double);
+    return {2.0 * bytes / 1.0e6 / best_copy, 3.0 * bytes / 1.0e6 / best_triad};
+}
+
+// Minimum DRAM traffic of the in-memory xi_sort pipeline: pack (read 8 B,
+// write 32 B XiItem), per merge level copy-to-aux + merge (4 × 32 B), unpack
+// (read 32 B, write 8 B).  Engines that move less data beat this bound.
+static double xi_sort_bytes(std::size_t n) {
+    double levels = std::ceil(std::log2(static_cast<double>(std::max<std::size_t>(n, 2))));
+    return static_cast<double>(n) * (40.0 + 4.0 * sizeof(XiItem) * levels + 40.0);
+}
+
+struct ScalePoint {
+    std::string engine;
+    std::size_t n;
+    int threads;
+    double strong_ms;
+    double strong_eff;
+    std::size_t weak_n;
+    double weak_ms;
+    double weak_eff;
+    double achieved_gbs;
+    double roofline_frac;     // achieved / STREAM triad at this thread count
+};
+
+static bool run_scaling(const Options &o)
+{
+    const int nproc = hardware_threads();
+    std::vector<int> threads = o.threads;
+    if (threads.empty()) {
+        for (int p = 1; p < nproc; p *= 2) threads.push_back(p);
+        threads.push_back(nproc);
+    }
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+    if (threads.front() != 1) threads.insert(threads.begin(), 1);   // efficiencies need T(1)
+
+    const std::string dist = o.dists_given ? o.dists.front() : "uniform";
+    std::size_t max_n = *std::max_element(o.sizes.begin(), o.sizes.end());
+    std::size_t stream_elems = std::max<std::size_t>(1ULL << 25, max_n);   // ≥ 256 MB per array
+
+    std::cout << "===== XiSort thread-scaling benchmark =====\n"
+              << "nproc = " << nproc << ", dist = " << dist << ", reps = " << o.reps << "\n";
+
+    std::cout << "\n[roofline] STREAM-style bandwidth, " << stream_elems
+              << " doubles per array\n"
+              << std::setw(8) << "threads" << std::setw(14) << "copy GB/s"
+              << std::setw(14) << "triad GB/s" << "\n";
+    std::vector<Bandwidth> bw;
+    for (int p : threads) {
+        ThreadScope scope(p);
+        bw.push_back(measure_stream(stream_elems, std::max(o.reps, 3)));
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(8) << p << std::setw(14) << bw.back().copy_gbs
+                  << std::setw(14) << bw.back().triad_gbs << "\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    std::vector<ScalePoint> points;
+    bool all_identical = true;
+    std::vector<double> input, reference, work;
+
+    for (std::size_t n : o.sizes) {
+        for (const auto &e : select_engines(o, n, true)) {
+            std::cout << "\n[" << e.name << "] n = " << n
+                      << " (weak scaling: n × threads)\n"
+                      << std::setw(8) << "threads"
+                      << std::setw(12) << "strong ms" << std::setw(10) << "eff"
+                      << std::setw(12) << "weak ms" << std::setw(10) << "eff"
+                      << std::setw(10) << "GB/s" << std::setw(12) << "% triad" << "\n";
+            double t1_strong = 0.0, t1_weak = 0.0;
+            for (std::size_t ti = 0; ti < threads.size(); ++ti) {
+                const int p = threads[ti];
+                ThreadScope scope(p);
+                bool identical = true;
+
+                make_input(dist, n, input);
+                reference = input;
+                std::stable_sort(reference.begin(), reference.end(), key_less);
+                double strong = time_engine(e, input, reference, o.reps, work, identical);
+                all_identical = all_identical && identical;
+
+                const std::size_t weak_n = n * static_cast<std::size_t>(p);
+                double weak = strong;
+                if (p > 1) {
+                    make_input(dist, weak_n, input);
+                    reference = input;
+                    std::stable_sort(reference.begin(), reference.end(), key_less);
+                    weak = time_engine(e, input, reference, o.reps, work, identical);
+                    all_identical = all_identical && identical;
+                }
+                if (p == 1) { t1_strong = strong; t1_weak = weak; }
+
+                ScalePoint sp;
+                sp.engine = e.name; sp.n = n; sp.threads = p;
+                sp.strong_ms = strong;
+                sp.strong_eff = t1_strong / (p * strong);
+                sp.weak_n = weak_n;
+                sp.weak_ms = weak;
+                sp.weak_eff = t1_weak / weak;
+                sp.achieved_gbs = xi_sort_bytes(n) / 1.0e6 / strong;
+                sp.roofline_frac = sp.achieved_gbs / bw[ti].triad_gbs;
+                points.push_back(sp);
+
+                std::cout << std::fixed << std::setprecision(2)
+                          << std::setw(8) << p
+                          << std::setw(12) << sp.strong_ms << std::setw(10) << sp.strong_eff
+                          << std::setw(12) << sp.weak_ms << std::setw(10) << sp.weak_eff
+                          << std::setw(10) << sp.achieved_gbs
+                          << std::setw(11) << 100.0 * sp.roofline_frac << "%"
+                          << (identical ? "" : "  MISMATCH") << "\n";
+                std::cout.unsetf(std::ios::fixed);
+            }
+        }
+    }
+
+    std::cout << "\nstrong eff = T(1) / (p · T(p)) at fixed n; weak eff = T(1, n) / T(p, p·n)\n"
+                 "GB/s = xi_sort minimum DRAM traffic / strong time (same model for every\n"
+                 "engine, so it is a normalised throughput); % triad is that against STREAM\n"
+                 "triad at the same thread count — near 100 % means bandwidth-saturated\n";
+
+    if (!o.json_path.empty()) {
+        std::ofstream out(o.json_path);
+        if (!out) die("cannot open JSON report " + o.json_path);
+        out << "{\n  \"suite\": \"scaling\",\n  \"nproc\": " << nproc
+            << ",\n  \"stream\": [\n";
+        for (std::size_t i = 0; i < threads.size(); ++i)
+            out << "    {\"threads\": " << threads[i] << ", \"copy_gbs\": " << bw[i].copy_gbs
+                << ", \"triad_gbs\": " << bw[i].triad_gbs << "}"
+                << (i + 1 < threads.size() ? ",\n" : "\n");
+        out << "  ],\n  \"results\": [\n";
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            const ScalePoint &p = points[i];
+            out << "    {\"engine\": \"" << p.engine << "\", \"n\": " << p.n
+                << ", \"threads\": " << p.threads << ", \"strong_ms\": " << p.strong_ms
+                << ", \"strong_eff\": " << p.strong_eff << ", \"weak_n\": " << p.weak_n
+                << ", \"weak_ms\": " << p.weak_ms << ", \"weak_eff\": " << p.weak_eff
+                << ", \"achieved_gbs\": " << p.achieved_gbs
+                << ", \"roofline_frac\": " << p.roofline_frac << "}"
+                << (i + 1 < points.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+    }
+    return all_identical;
+}
+
+// ─── suite: external ─────────────────────────────────────────────────────────
+static inline std::uint64_t mix64(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Order-independent fingerprint of a file of doubles: count + sum of hashed bits.
+// Equal fingerprints for input and output (plus sortedness) ⇒ same multiset.
+struct FileCheck {
+    std::uint64_t count = 0;
+    std::uint64_t hash = 0;
+    bool sorted = true;
+};
+
+static FileCheck scan_file(const std::string &path, bool check_order) {
+    FileCheck fc;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) die("cannot open " + path);
+    std::vector<double> buf(1 << 16);
+    std::uint64_t prev = 0;
+    bool first = true;
+    while (true) {
+        in.read(reinterpret_cast<char*>(buf.data()), buf.size() * sizeof(double));
+        std::size_t got = static_cast<std::size_t>(in.gcount()) / sizeof(double);
+        for (std::size_t i = 0; i < got; ++i) {
+            std::uint64_t k = double_to_key(buf[i]);
+            fc.hash += mix64(k);
+            if (check_order && !first && k < prev) fc.sorted = false;
+            prev = k; first = false;
+        }
+        fc.count += got;
+        if (got < buf.size()) break;
+    }
+    return fc;
+}
+
+static void write_input_file(const std::string &path, std::uint64_t bytes) {
+    try {
+        xi_gen_file(path, XI_GEN_UNIFORM, 777, bytes / sizeof(double));
+    } catch (const std::exception &e) {
+        die(e.what());
+    }
+}
+
+struct ExtResult {
+    std::string engine;
+    std::uint64_t bytes;
+    double median_ms;
+    double mb_per_s;
+    XiSortStats stats;      // of the median repetition's run
+    bool ok;
+};
+
+static bool run_external(const Options &o)
+{
+    const int reps = o.reps_given ? o.reps : 1;
+    xi_set_io_throttle(o.throttle_mbps, o.throttle_latency_us);
+
+    std::cout << "===== XiSort external-sort benchmark =====\n"
+              << "mem_limit = " << o.mem_limit << " B, buffer_elems = 4096, reps = " << reps
+              << "\nthrottle: "
+              << (o.throttle_mbps > 0.0 || o.throttle_latency_us > 0.0
+                      ? std::to_string(o.throttle_mbps) + " MB/s, " +
+                            std::to_string(o.throttle_latency_us) + " us/op"
+                      : std::string("off (native storage)"))
+              << "\n";
+
+    std::vector<ExtResult> results;
+    bool all_ok = true;
+    for (std::uint64_t bytes : o.bytes) {
+        bytes -= bytes % sizeof(double);
+        const std::string in_path  = o.scratch + "/xisort_bench_in_" + std::to_string(bytes) + ".bin";
+        const std::string out_path = o.scratch + "/xisort_bench_out.bin";
+        if (!std::filesystem::exists(in_path) || std::filesystem::file_size(in_path) != bytes) {
+            std::cout << "\n  generating " << in_path << " …\n";
+            write_input_file(in_path, bytes);
+        }
+        const FileCheck ref = scan_file(in_path, false);
+
+        std::cout << "\n[" << bytes / (1 << 20) << " MiB]\n"
+                  << std::left << std::setw(20) << "engine" << std::right
+                  << std::setw(11) << "total ms" << std::setw(9) << "MB/s"
+                  << std::setw(7) << "runs" << std::setw(8) << "rounds"
+                  << std::setw(11) << "phase-1 ms" << std::setw(11) << "phase-2 ms"
+                  << std::setw(8) << "I/O x" << std::setw(11) << "I/O wait"
+                  << "  output\n";
+
+        for (const std::string engine : {"xi_sort_file", "xi_sort/external"}) {
+            if (!o.engines.empty() &&
+                std::find(o.engines.begin(), o.engines.end(), engine) == o.engines.end())
+                continue;
+            // the pairwise engine sorts a RAM-resident array; skip it beyond 1 GiB
+            if (engine == "xi_sort/external" && bytes > (1ULL << 30)) continue;
+
+            std::vector<double> times;
+            std::vector<XiSortStats> stats;
+            bool ok = true;
+            for (int r = 0; r < reps; ++r) {
+                XiSortConfig cfg;
+                cfg.parallel = true;
+                cfg.mem_limit = o.mem_limit;
+                cfg.buffer_elems = 4096;
+                cfg.scratch_dir = o.scratch;
+                auto t0 = Clock::now();
+                if (engine == "xi_sort_file") {
+                    xi_sort_file(in_path, out_path, cfg);
+                } else {
+                    cfg.external = true;
+                    std::vector<double> data(bytes / sizeof(double));
+                    std::ifstream in(in_path, std::ios::binary);
+                    xi_read(in, data.data(), bytes, XI_FILE_INPUT);
+                    xi_sort(data.data(), data.size(), cfg);   // stats cover the sort only
+                    std::ofstream out(out_path, std::ios::binary);
+                    xi_write(out, data.data(), bytes, XI_FILE_OUTPUT);
+                }
+                times.push_back(ms_since(t0));
+                stats.push_back(xi_sort_stats());
+                FileCheck got = scan_file(out_path, true);
+                ok = ok && got.sorted && got.count == ref.count && got.hash == ref.hash;
+            }
+            std::size_t mid = std::distance(times.begin(),
+                std::find(times.begin(), times.end(), median(times)));
+            if (mid >= stats.size()) mid = 0;   // even reps: median is an average
+            ExtResult res{engine, bytes, median(times), 0.0, stats[mid], ok};
+            res.mb_per_s = bytes / 1.0e6 / (res.median_ms / 1000.0);
+            results.push_back(res);
+            all_ok = all_ok && ok;
+
+            const XiSortStats &st = res.stats;
+            double amplification = (st.bytes_read + st.bytes_written) / static_cast<double>(bytes);
+            std::cout << std::left << std::setw(20) << engine << std::right
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(11) << res.median_ms << std::setw(9) << res.mb_per_s
+                      << std::setw(7) << st.runs << std::setw(8) << st.merge_rounds
+                      << std::setw(11) << st.run_ms << std::setw(11) << st.merge_ms
+                      << std::setw(8) << amplification << std::setw(11) << st.io_wait_ms
+                      << "  " << (ok ? "verified" : "BAD") << "\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+        std::filesystem::remove(out_path);
+    }
+    xi_set_io_throttle(0.0, 0.0);
+
+    std::cout << "\nI/O x = (bytes read + written) / input bytes as seen by the sorter;\n"
+                 "output is verified for order, element count and a multiset fingerprint\n";
+
+    if (!o.json_path.empty()) {
+        std::ofstream out(o.json_path);
+        if (!out) die("cannot open JSON report " + o.json_path);
+        out << "{\n  \"suite\": \"external\",\n  \"mem_limit\": " << o.mem_limit
+            << ",\n  \"throttle_mbps\": " << o.throttle_mbps
+            << ",\n  \"throttle_latency_us\": " << o.throttle_latency_us
+            << ",\n  \"results\": [\n";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const ExtResult &r = results[i];
+            out << "    {\"engine\": \"" << r.engine << "\", \"bytes\": " << r.bytes
+                << ", \"median_ms\": " << r.median_ms << ", \"mb_per_s\": " << r.mb_per_s
+                << ", \"runs\": " << r.stats.runs << ", \"merge_rounds\": " << r.stats.merge_rounds
+                << ", \"run_ms\": " << r.stats.run_ms << ", \"merge_ms\": " << r.stats.merge_ms
+                << ", \"bytes_read\": " << r.stats.bytes_read
+                << ", \"bytes_written\": " << r.stats.bytes_written
+                << ", \"io_wait_ms\": " << r.stats.io_wait_ms
+                << ", \"verified\": " << (r.ok ? "true" : "false") << "}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+    }
+    return all_ok;
+}
+
+// ─── suite: gate ─────────────────────────────────────────────────────────────
+// Baselines live in <baseline-dir>/<machine-class>.json, one object per case:
+//   {"case": "...", "median_mb_s": x, "mad_mb_s": y, "reps": k}
+// A case fails when its median throughput drops by more than
+//   max(threshold, 3 · (MAD_base / median_base + MAD_now / median_now))
+// i.e. the allowance widens with the noise observed on either side.
+struct GateCase {
+    std::string name;
+    double median_mb_s;
+    double mad_mb_s;
+    int reps;
+};
+
+static std::string default_machine_class() {
+    if (const char *env = std::getenv("XISORT_MACHINE_CLASS")) {
+        if (*env) return env;
+    }
+#if defined(__x86_64__) || defined(_M_X64)
+    const char *arch = "x86_64";
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    const char *arch = "aarch64";
+#else
+    const char *arch = "generic";
+#endif
+    return std::string(arch) + "-" + std::to_string(hardware_threads()) + "c";
+}
+
+static double median_abs_dev(const std::vector<double> &v) {
+    double m = median(v);
+    std::vector<double> dev;
+    for (double x : v) dev.push_back(std::fabs(x - m));
+    return median(dev);
+}
+
+// Reads the flat array of case objects written by write_baseline()
+static bool read_baseline(const std::string &path, std::vector<GateCase> &out) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    auto field = [](const std::string &obj, const std::string &name) -> std::string {
+        std::size_t k = obj.find("\"" + name + "\"");
+        if (k == std::string::npos) return "";
+        std::size_t c = obj.find(':', k);
+        if (c == std::string::npos) return "";
+        std::size_t b = obj.find_first_not_of(" \t\n\r", c + 1);
+        if (b == std::string::npos) return "";
+        if (obj[b] == '"') {
+            std::size_t e = obj.find('"', b + 1);
+            return e == std::string::npos ? "" : obj.substr(b + 1, e - b - 1);
+        }
+        std::size_t e = obj.find_first_of(",}\n", b);
+        return obj.substr(b, e == std::string::npos ? std::string::npos : e - b);
+    };
+    std::size_t pos = text.find('[');
+    while (pos != std::string::npos) {
+        std::size_t open = text.find('{', pos);
+        if (open == std::string::npos) break;
+        std::size_t close = text.find('}', open);
+        if (close == std::string::npos) return false;
+        std::string obj = text.substr(open, close - open + 1);
+        GateCase c;
+        c.name = field(obj, "case");
+        std::string med = field(obj, "median_mb_s"), mad = field(obj, "mad_mb_s"), reps = field(obj, "reps");
+        if (c.name.empty() || med.empty()) return false;
+        c.median_mb_s = std::stod(med);
+        c.mad_mb_s = mad.empty() ? 0.0 : std::stod(mad);
+        c.reps = reps.empty() ? 0 : std::stoi(reps);
+        out.push_back(c);
+        pos = close + 1;
+    }
+    return true;
+}
+
+static void write_baseline(const std::string &path, const std::string &cls,
+                           const std::vector<GateCase> &cases) {
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    if (!dir.empty()) std::filesystem::create_directories(dir);
+    std::ofstream out(path);
+    if (!out) die("cannot write baseline " + path);
+    out << "{\n  \"machine_class\": \"" << cls << "\",\n  \"cases\": [\n";
+    for (std::size_t i = 0; i < cases.size(); ++i) {
+        const GateCase &c = cases[i];
+        out << "    {\"case\": \"" << c.name << "\", \"median_mb_s\": " << c.median_mb_s
+            << ", \"mad_mb_s\": " << c.mad_mb_s << ", \"reps\": " << c.reps << "}"
+            << (i + 1 < cases.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+// Returns whether every output was correct; `regressed` reports throughput separately
+static bool run_gate(const Options &o, bool &regressed)
+{
+    const int reps = o.reps_given ? o.reps : 7;
+    const std::string cls = o.machine_class.empty() ? default_machine_class() : o.machine_class;
+    const std::string path = o.baseline_dir + "/" + cls + ".json";
+    const std::size_t n = 2'000'000;
+
+    std::cout << "===== XiSort performance gate =====\n"
+              << "machine class = " << cls << ", baseline = " << path
+              << ", reps = " << reps << "\n";
+
+    // fixed subset: in-memory engines on four shapes, plus one external case
+    std::vector<GateCase> now;
+    bool outputs_ok = true;
+    std::vector<double> input, reference, work;
+    const std::vector<std::pair<std::string, std::string>> mem_cases = {
+        {"uniform", "xi_sort/serial"}, {"uniform", "xi_sort/parallel"},
+        {"dups", "xi_sort/serial"}, {"sorted", "xi_sort/serial"}, {"ieee", "xi_sort/serial"}
+    };
+    std::vector<Engine> engines = all_engines(n, o.scratch);
+    for (const auto &mc : mem_cases) {
+        make_input(mc.first, n, input);
+        reference = input;
+        std::stable_sort(reference.begin(), reference.end(), key_less);
+        const Engine *eng = nullptr;
+        for (const auto &e : engines) if (e.name == mc.second) eng = &e;
+        std::vector<double> mbs;
+        for (int r = 0; r < reps; ++r) {
+            bool identical = true;
+            double ms = time_engine(*eng, input, reference, 1, work, identical);
+            outputs_ok = outputs_ok && identical;
+            mbs.push_back(n * sizeof(double) / 1.0e6 / (ms / 1000.0));
+        }
+        now.push_back({mc.first + "/" + mc.second + "/n=" + std::to_string(n),
+                       median(mbs), median_abs_dev(mbs), reps});
+    }
+    {
+        const std::uint64_t bytes = 32ULL << 20;
+        const std::string in_path  = o.scratch + "/xisort_gate_in.bin";
+        const std::string out_path = o.scratch + "/xisort_gate_out.bin";
+        write_input_file(in_path, bytes);
+        const FileCheck ref = scan_file(in_path, false);
+        std::vector<double> mbs;
+        for (int r = 0; r < reps; ++r) {
+            XiSortConfig cfg; cfg.parallel = true; cfg.mem_limit = 2ULL << 20; cfg.buffer_elems = 4096;
+            cfg.scratch_dir = o.scratch;
+            auto t0 = Clock::now();
+            xi_sort_file(in_path, out_path, cfg);
+            mbs.push_back(bytes / 1.0e6 / (ms_since(t0) / 1000.0));
+            FileCheck got = scan_file(out_path, true);
+            outputs_ok = outputs_ok && got.sorted && got.count == ref.count && got.hash == ref.hash;
+        }
+        std::filesystem::remove(in_path);
+        std::filesystem::remove(out_path);
+        now.push_back({"external/xi_sort_file/32M/mem=2M", median(mbs), median_abs_dev(mbs), reps});
+    }
+
+    if (o.update_baseline) {
+        write_baseline(path, cls, now);
+        std::cout << "baseline written: " << path << " (" << now.size() << " cases)\n";
+        return outputs_ok;
+    }
+
+    std::vector<GateCase> base;
+    if (!read_baseline(path, base))
+        die("no readable baseline " + path + " (record one with --update-baseline)");
+
+    std::cout << "\n" << std::left << std::setw(42) << "case" << std::right
+              << std::setw(11) << "base MB/s" << std::setw(11) << "now MB/s"
+              << std::setw(9) << "delta" << std::setw(9) << "allowed" << "  verdict\n";
+    regressed = false;
+    for (const auto &c : now) {
+        const GateCase *b = nullptr;
+        for (const auto &x : base) if (x.name == c.name) b = &x;
+        std::cout << std::left << std::setw(42) << c.name << std::right
+                  << std::fixed << std::setprecision(1);
+        if (!b) {
+            std::cout << std::setw(11) << "-" << std::setw(11) << c.median_mb_s
+                      << std::setw(9) << "-" << std::setw(9) << "-" << "  new (not in baseline)\n";
+            std::cout.unsetf(std::ios::fixed);
+            continue;
+        }
+        double noise = 0.0;
+        if (b->median_mb_s > 0.0) noise += b->mad_mb_s / b->median_mb_s;
+        if (c.median_mb_s > 0.0) noise += c.mad_mb_s / c.median_mb_s;
+        double allowed = std::max(o.threshold, 3.0 * noise);
+        double delta = (b->median_mb_s > 0.0) ? c.median_mb_s / b->median_mb_s - 1.0 : 0.0;
+        bool bad = delta < -allowed;
+        regressed = regressed || bad;
+        std::cout << std::setw(11) << b->median_mb_s << std::setw(11) << c.median_mb_s
+                  << std::setw(8) << 100.0 * delta << "%" << std::setw(8) << 100.0 * allowed << "%"
+                  << "  " << (bad ? "REGRESSION" : (delta > allowed ? "faster" : "ok")) << "\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+    for (const auto &b : base) {
+        bool seen = false;
+        for (const auto &c : now) seen = seen || c.name == b.name;
+        if (!seen) std::cout << std::left << std::setw(42) << b.name << "  (baseline only, skipped)\n";
+    }
+    if (!outputs_ok) std::cout << "output mismatch in at least one case\n";
+    std::cout << (regressed ? "\nperformance gate: FAIL\n" : "\nperformance gate: PASS\n");
+    return outputs_ok;
+}
+
+// ─── main ────────────────────────────────────────────────────────────────────
+int main(int argc, char **argv)
+{
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg.rfind("--suite=", 0) == 0) o.suite = arg.substr(8);
+        else if (arg.rfind("--n=", 0) == 0) o.n = std::stoull(arg.substr(4));
+        else if (arg.rfind("--sizes=", 0) == 0) o.sizes = parse_sizes(arg.substr(8));
+        else if (arg.rfind("--threads=", 0) == 0) {
+            o.threads.clear();
+            for (auto t : parse_sizes(arg.substr(10))) o.threads.push_back(static_cast<int>(t));
+        }
+        else if (arg.rfind("--reps=", 0) == 0) { o.reps = std::stoi(arg.substr(7)); o.reps_given = true; }
+        else if (arg.rfind("--dist=", 0) == 0) { o.dists = split_list(arg.substr(7)); o.dists_given = true; }
+        else if (arg.rfind("--engines=", 0) == 0) o.engines = split_list(arg.substr(10));
+        else if (arg.rfind("--json=", 0) == 0) o.json_path = arg.substr(7);
+        else if (arg.rfind("--bytes=", 0) == 0) {
+            o.bytes.clear();
+            for (const auto &tok : split_list(arg.substr(8))) o.bytes.push_back(parse_bytes(tok));
+        }
+        else if (arg.rfind("--mem-limit=", 0) == 0) o.mem_limit = parse_bytes(arg.substr(12));
+        else if (arg.rfind("--scratch=", 0) == 0) o.scratch = arg.substr(10);
+        else if (arg.rfind("--throttle-mbps=", 0) == 0) o.throttle_mbps = std::stod(arg.substr(16));
+        else if (arg.rfind("--throttle-latency-us=", 0) == 0)
+            o.throttle_latency_us = std::stod(arg.substr(22));
+        else if (arg.rfind("--baseline-dir=", 0) == 0) o.baseline_dir = arg.substr(15);
+        else if (arg.rfind("--machine-class=", 0) == 0) o.machine_class = arg.substr(16);
+        else if (arg.rfind("--threshold=", 0) == 0) o.threshold = std::stod(arg.substr(12));
+        else if (arg == "--update-baseline") o.update_baseline = true;
+        else die("unknown option " + arg);
+    }
+    if (o.n == 0) die("--n must be positive");
+    if (o.reps < 1) die("--reps must be >= 1");
+    if (o.sizes.empty() || std::find(o.sizes.begin(), o.sizes.end(), 0u) != o.sizes.end())
+        die("--sizes must be positive");
+    for (int t : o.threads) if (t < 1) die("--threads must be positive");
+    for (auto b : o.bytes) if (b < sizeof(double)) die("--bytes must be at least 8");
+    if (o.mem_limit < sizeof(double)) die("--mem-limit must be at least 8 bytes");
+    if (o.dists.empty()) die("--dist is empty");
+
+    bool ok, regressed = false;
+    if (o.suite == "compare") ok = run_compare(o);
+    else if (o.suite == "scaling") ok = run_scaling(o);
+    else if (o.suite == "external") ok = run_external(o);
+    else if (o.suite == "gate") ok = run_gate(o, regressed);
+    else die("unknown suite " + o.suite);
+
+    if (!ok) std::cout << "status: FAIL (output mismatch)\n";
+    if (regressed) std::cout << "status: FAIL (performance regression)\n";
+    if (ok && !regressed) std::cout << "status: OK\n";
+    return (ok && !regressed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
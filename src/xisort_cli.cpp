@@ -4,30 +4,29 @@
 // Build (GCC 14 with OpenMP):
 //   g++-14 -std=c++17 -O3 -fopenmp xisort_cli.cpp -o xisort
 // -----------------------------------------------------------------------------
-// This file purposefully AVOIDS <algorithm>; we replace std::min with a tiny
-// helper `xmin()` defined below so that the only standard headers pulled in are
-// the absolute minimum needed for a portable CLI.
-// -----------------------------------------------------------------------------
 
+#include <atomic>
 #include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <numeric>
-#include <queue>
 #include <string>
 #include <vector>
 
 #include "xisort.cpp"   // core sorter + XiSortConfig + double_to_key
+#include "xisort_dist.cpp"   // distributed coordinator / worker (POSIX)
+#ifdef XISORT_HAVE_DIST
+#include <sys/wait.h>
+#endif
 
 using Clock = std::chrono::steady_clock;
 
-// ─── tiny helper ─────────────────────────────────────────
-template <typename T>
-static inline T xmin(T a, T b) noexcept { return (a < b ? a : b); }
-
 // ─── error & timing helpers ──────────────────────────────────────────────────
 static void die(const std::string &msg) {
     std::cerr << "[xisort] " << msg << "\n";
@@ -37,129 +36,385 @@ static inline double ms_since(const Clock::time_point &t0) {
     return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
 }
 
-// ─── external merge‑sort primitives ──────────────────────────────────────────
-struct Run {
-    std::ifstream file;
-    std::vector<double> buffer;
-    std::size_t idx{0};
-    bool eof{false};
-};
-struct HeapItem {
-    double value;
-    std::size_t run_id;
-    bool operator>(const HeapItem &o) const {
-        return double_to_key(value) > double_to_key(o.value);
+// ─── Φ(χ) / stats report ─────────────────────────────────────────────────────
+static void print_phi_bin(const char *label, std::size_t idx, const XiPhiBin &b) {
+    double mean = b.segments ? static_cast<double>(b.elements) / b.segments : 0.0;
+    std::fprintf(stderr, "[xisort]   %-6s %3zu  %14lld elems  %12lld segs  mean-seg %10.2f  Φ %14.4f\n",
+                 label, idx, b.elements, b.segments, mean, b.phi);
+}
+
+static void print_trace_report(const XiSortStats &st) {
+    std::cerr << "[xisort] Φ(χ) total " << st.phi << " over " << st.curv_segments << " segments\n";
+    for (std::size_t l = 0; l < st.phi_levels.size(); ++l)
+        if (st.phi_levels[l].segments) print_phi_bin("level", l, st.phi_levels[l]);
+    const std::size_t RUNS_SHOWN = 16;
+    for (std::size_t r = 0; r < st.phi_runs.size() && r < RUNS_SHOWN; ++r)
+        print_phi_bin("run", r, st.phi_runs[r]);
+    if (st.phi_runs.size() > RUNS_SHOWN)
+        std::cerr << "[xisort]   … " << st.phi_runs.size() - RUNS_SHOWN << " more runs (see --report)\n";
+    for (std::size_t k = 0; k < st.phi_rounds.size(); ++k)
+        print_phi_bin("round", k, st.phi_rounds[k]);
+}
+
+static void print_resource_report(const XiSortStats &st) {
+    std::fprintf(stderr, "[xisort] sorter memory peak %.1f MiB, %llu allocations\n",
+                 st.mem_peak_bytes / 1048576.0, static_cast<unsigned long long>(st.mem_allocs));
+    for (int c = 0; c < XI_FILE_CLASSES; ++c) {
+        const XiLatHist *dirs[2] = {&st.io[c].read, &st.io[c].write};
+        for (int d = 0; d < 2; ++d) {
+            const XiLatHist &h = *dirs[d];
+            if (!h.ops) continue;
+            std::fprintf(stderr, "[xisort] I/O %-6s %-5s %10llu ops %12.1f MiB  p50 %9.3f ms  p99 %9.3f ms  max %9.3f ms\n",
+                         xi_file_class_name(c), d ? "write" : "read",
+                         static_cast<unsigned long long>(h.ops), h.bytes / 1048576.0,
+                         xi_lat_quantile_ms(h, 0.50), xi_lat_quantile_ms(h, 0.99), h.max_ms);
+        }
+    }
+}
+
+static void write_lat_hist(std::ofstream &out, const char *name, const XiLatHist &h) {
+    int last = XI_LAT_BUCKETS;
+    while (last > 0 && !h.bucket[last - 1]) --last;
+    out << "\"" << name << "\": {\"ops\": " << h.ops << ", \"bytes\": " << h.bytes
+        << ", \"total_ms\": " << h.total_ms << ", \"max_ms\": " << h.max_ms
+        << ", \"p50_ms\": " << xi_lat_quantile_ms(h, 0.50)
+        << ", \"p99_ms\": " << xi_lat_quantile_ms(h, 0.99) << ", \"log2_ns_buckets\": [";
+    for (int b = 0; b < last; ++b) out << (b ? ", " : "") << h.bucket[b];
+    out << "]}";
+}
+
+static void write_io_classes(std::ofstream &out, const XiSortStats &st) {
+    out << "  \"io\": {";
+    for (int c = 0; c < XI_FILE_CLASSES; ++c) {
+        out << (c ? ",\n" : "\n") << "    \"" << xi_file_class_name(c) << "\": {";
+        write_lat_hist(out, "read", st.io[c].read);   out << ", ";
+        write_lat_hist(out, "write", st.io[c].write); out << "}";
     }
-};
+    out << "\n  }";
+}
+
+static void write_phi_bins(std::ofstream &out, const char *name, const std::vector<XiPhiBin> &bins) {
+    out << "  \"" << name << "\": [";
+    for (std::size_t i = 0; i < bins.size(); ++i)
+        out << (i ? ", " : "") << "{\"phi\": " << bins[i].phi << ", \"segments\": "
+            << bins[i].segments << ", \"elements\": " << bins[i].elements << "}";
+    out << "]";
+}
+
+static void write_json_report(const std::string &path, const XiSortStats &st, double total_s) {
+    std::ofstream out(path);
+    if (!out) die("cannot open report file " + path);
+    out << "{\n  \"total_s\": " << total_s
+        << ",\n  \"runs\": " << st.runs << ",\n  \"merge_rounds\": " << st.merge_rounds
+        << ",\n  \"run_ms\": " << st.run_ms << ",\n  \"merge_ms\": " << st.merge_ms
+        << ",\n  \"bytes_read\": " << st.bytes_read << ",\n  \"bytes_written\": " << st.bytes_written
+        << ",\n  \"io_wait_ms\": " << st.io_wait_ms
+        << ",\n  \"tail_elems\": " << st.tail_elems
+        << ",\n  \"mem_peak_bytes\": " << st.mem_peak_bytes << ",\n  \"mem_live_bytes\": " << st.mem_live_bytes
+        << ",\n  \"mem_allocs\": " << st.mem_allocs << ",\n  \"mem_frees\": " << st.mem_frees
+        << ",\n  \"phi\": " << st.phi << ",\n  \"curv_segments\": " << st.curv_segments << ",\n";
+    write_phi_bins(out, "phi_levels", st.phi_levels);  out << ",\n";
+    write_phi_bins(out, "phi_runs", st.phi_runs);      out << ",\n";
+    write_phi_bins(out, "phi_rounds", st.phi_rounds);  out << ",\n";
+    write_io_classes(out, st);                         out << "\n}\n";
+}
+
+// ─── SIGINT / SIGTERM: cancel the sort so it removes its scratch files ─────────
+static std::atomic<bool> g_cancel(false);
+
+extern "C" void on_stop_signal(int sig) {
+    g_cancel.store(true);
+    std::signal(sig, SIG_DFL);      // a second signal kills outright
+}
 
+// ─── external merge‑sort (phases run by xi_sort_file in the core) ─────────────
 static void external_sort(const std::string &in_path,
                           const std::string &out_path,
-                          std::size_t mem_limit_bytes,
-                          bool parallel)
+                          const std::string &perm_path,
+                          const XiRecordFormat *records,
+                          XiSortConfig cfg)
+{
+    std::error_code ec;
+    const std::uint64_t total_bytes = std::filesystem::file_size(in_path, ec);
+    if (ec) die("cannot open input file");
+    if (!records && total_bytes % sizeof(double)) die("input file size not multiple of 8 bytes");
+    if (!total_bytes) die("input file is empty");
+    if (cfg.mem_limit < sizeof(double)) die("mem‑limit too small (< 8 bytes)");
+
+    cfg.buffer_elems = 4096;   // doubles kept from each run in RAM
+    try {
+        if (records) xi_sort_records_file(in_path, out_path, *records, cfg);
+        else if (perm_path.empty()) xi_sort_file(in_path, out_path, cfg);
+        else xi_argsort_file(in_path, perm_path, out_path, cfg);
+    } catch (const std::exception &e) {
+        die(e.what());
+    }
+    XiSortStats st = xi_sort_stats();
+    std::cerr << "[xisort] phase‑1 produced " << st.runs
+              << " runs in " << st.run_ms/1000.0 << " s\n";
+    std::cerr << "[xisort] phase‑2 merged in " << st.merge_ms/1000.0 << " s\n";
+    if (st.tail_elems)
+        std::cerr << "[xisort] " << st.tail_elems << " NaN/inf values written around the merge\n";
+    if (st.io_wait_ms > 0.0)
+        std::cerr << "[xisort] throttled I/O wait " << st.io_wait_ms/1000.0 << " s\n";
+}
+
+// ─── group-by: one XiGroup record per distinct value ──────────────────────────
+static void group_by(const std::string &in_path,
+                     const std::string &payload_path,
+                     const std::string &out_path,
+                     const XiSortConfig &cfg)
 {
-    const std::size_t ALIGN = 8; // sizeof(double)
-    const std::uint64_t total_bytes = std::filesystem::file_size(in_path);
-    if (total_bytes % ALIGN) die("input file size not multiple of 8 bytes");
-    const std::uint64_t total_elems = total_bytes / ALIGN;
-    if (!total_elems) die("input file is empty");
-
-    // ── Phase 1: split into sorted runs ────────────────────────────────────
-    const std::size_t max_elems_RAM = mem_limit_bytes / sizeof(double);
-    if (!max_elems_RAM) die("mem‑limit too small (< 8 bytes)");
-
-    std::ifstream fin(in_path, std::ios::binary);
-    if (!fin) die("cannot open input file");
-
-    std::vector<std::string> run_paths;
-    std::vector<double> buf(max_elems_RAM);
-    std::uint64_t remaining = total_elems;
-    std::size_t   run_idx   = 0;
-
-    auto t1 = Clock::now();
-    while (remaining) {
-        std::size_t chunk = xmin<std::uint64_t>(remaining, max_elems_RAM);
-        fin.read(reinterpret_cast<char*>(buf.data()), chunk * sizeof(double));
-        if (fin.gcount() != static_cast<std::streamsize>(chunk*sizeof(double)))
-            die("I/O error while reading");
-
-        XiSortConfig cfg; cfg.parallel = parallel; cfg.trace = false;
-        xi_sort(buf.data(), chunk, cfg);
-
-        std::string run_path = "xisort_run_" + std::to_string(run_idx++) + ".bin";
-        std::ofstream fout(run_path, std::ios::binary);
-        fout.write(reinterpret_cast<char*>(buf.data()), chunk*sizeof(double));
-        fout.close();
-        run_paths.push_back(run_path);
-        remaining -= chunk;
-    }
-    fin.close();
-    std::cerr << "[xisort] phase‑1 produced " << run_paths.size()
-              << " runs in " << ms_since(t1)/1000.0 << " s\n";
-
-    // ── Phase 2: k‑way merge ──────────────────────────────────────────────
-    auto t2 = Clock::now();
-    const std::size_t RUN_BUF = 4096; // doubles kept from each run in RAM
-
-    std::vector<Run> runs(run_paths.size());
-    for (std::size_t i = 0; i < run_paths.size(); ++i) {
-        runs[i].file.open(run_paths[i], std::ios::binary);
-        runs[i].buffer.resize(RUN_BUF);
-        runs[i].file.read(reinterpret_cast<char*>(runs[i].buffer.data()), RUN_BUF*sizeof(double));
-        std::size_t got = runs[i].file.gcount() / sizeof(double);
-        runs[i].buffer.resize(got);
-        runs[i].eof = (got == 0);
-    }
-
-    std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<>> heap;
-    for (std::size_t i = 0; i < runs.size(); ++i)
-        if (!runs[i].eof) heap.push({runs[i].buffer[0], i});
+    try {
+        xi_group_file(in_path, payload_path, out_path, cfg);
+    } catch (const std::exception &e) {
+        die(e.what());
+    }
+    XiSortStats st = xi_sort_stats();
+    std::cerr << "[xisort] " << std::filesystem::file_size(out_path) / sizeof(XiGroup)
+              << " groups from " << st.runs << " grouped runs in "
+              << (st.run_ms + st.merge_ms)/1000.0 << " s\n";
+}
 
+// ─── top-k / bottom-k: one read, k values (and their indices) out ─────────────
+static void select_k(const std::string &in_path,
+                     const std::string &out_path,
+                     const std::string &perm_path,
+                     std::uint64_t k, bool largest,
+                     const XiSortConfig &cfg)
+{
+    std::vector<XiSelected> sel;
+    try {
+        sel = xi_topk_file(in_path, k, largest, cfg);
+    } catch (const std::exception &e) {
+        die(e.what());
+    }
+    std::vector<double> vals(sel.size());
+    std::vector<std::uint64_t> idx(sel.size());
+    for (std::size_t i = 0; i < sel.size(); ++i) { vals[i] = sel[i].value; idx[i] = sel[i].index; }
     std::ofstream fout(out_path, std::ios::binary);
-    if (!fout) die("cannot open output file");
-
-    std::vector<double> out_buf(RUN_BUF);
-    std::size_t out_idx = 0;
-
-    while (!heap.empty()) {
-        HeapItem it = heap.top(); heap.pop();
-        out_buf[out_idx++] = it.value;
-        Run &r = runs[it.run_id];
-        if (++r.idx == r.buffer.size()) {
-            r.file.read(reinterpret_cast<char*>(r.buffer.data()), RUN_BUF*sizeof(double));
-            std::size_t got = r.file.gcount() / sizeof(double);
-            r.buffer.resize(got);
-            r.idx = 0;
-            r.eof = (got == 0);
+    fout.write(reinterpret_cast<const char*>(vals.data()), (std::streamsize)(vals.size() * sizeof(double)));
+    if (!fout) die("I/O error while writing " + out_path);
+    if (!perm_path.empty()) {
+        std::ofstream pout(perm_path, std::ios::binary);
+        pout.write(reinterpret_cast<const char*>(idx.data()), (std::streamsize)(idx.size() * sizeof(std::uint64_t)));
+        if (!pout) die("I/O error while writing " + perm_path);
+    }
+    std::cerr << "[xisort] " << (largest ? "top-" : "bottom-") << sel.size() << " selected in "
+              << xi_sort_stats().run_ms/1000.0 << " s\n";
+}
+
+// ─── exact quantiles: histogram passes, nothing written ───────────────────────
+static void quantiles(const std::string &in_path,
+                      const std::string &list,
+                      const XiSortConfig &cfg)
+{
+    std::vector<double> qs;
+    for (std::size_t at = 0; at <= list.size(); ) {
+        std::size_t comma = list.find(',', at);
+        if (comma == std::string::npos) comma = list.size();
+        try {
+            qs.push_back(std::stod(list.substr(at, comma - at)));
+        } catch (const std::exception &) {
+            die("bad quantile list " + list);
+        }
+        at = comma + 1;
+    }
+    std::vector<double> vals;
+    try {
+        vals = xi_quantiles_file(in_path, qs, cfg);
+    } catch (const std::exception &e) {
+        die(e.what());
+    }
+    for (std::size_t i = 0; i < qs.size(); ++i) std::printf("%g\t%.17g\n", qs[i], vals[i]);
+    std::fflush(stdout);
+    XiSortStats st = xi_sort_stats();
+    std::cerr << "[xisort] " << qs.size() << " quantiles in " << st.merge_rounds
+              << " passes, " << st.run_ms/1000.0 << " s\n";
+}
+
+// ─── set operations over sorted files ─────────────────────────────────────────
+static void set_op(const std::string &op,
+                   const std::vector<std::string> &inputs,
+                   const std::string &out_path,
+                   const XiSortConfig &cfg)
+{
+    std::uint64_t written = 0;
+    try {
+        if (op == "join") {
+            if (inputs.size() != 2) die("--set=join needs exactly two inputs");
+            written = xi_merge_join_files(inputs[0], inputs[1], out_path, cfg);
+        } else {
+            XiSetOp kind;
+            if (op == "intersect") kind = XI_SET_INTERSECT;
+            else if (op == "union") kind = XI_SET_UNION;
+            else if (op == "union-all") kind = XI_SET_UNION_ALL;
+            else if (op == "difference") kind = XI_SET_DIFFERENCE;
+            else die("unknown set operation " + op);
+            written = xi_set_op_files(inputs, out_path, kind, cfg);
         }
-        if (!r.eof) heap.push({r.buffer[r.idx], it.run_id});
-        if (out_idx == out_buf.size()) {
-            fout.write(reinterpret_cast<char*>(out_buf.data()), out_idx*sizeof(double));
-            out_idx = 0;
+    } catch (const std::exception &e) {
+        die(e.what());
+    }
+    XiSortStats st = xi_sort_stats();
+    std::cerr << "[xisort] " << op << ": " << written << (op == "join" ? " pairs" : " values")
+              << ", read " << st.io[XI_FILE_INPUT].read.bytes / 1.0e6 << " MB in "
+              << st.merge_ms/1000.0 << " s\n";
+}
+
+// ─── bounded-disorder reorder of a nearly sorted file ─────────────────────────
+static void reorder(const std::string &in_path,
+                    const std::string &out_path,
+                    std::size_t window,
+                    const XiSortConfig &cfg)
+{
+    std::uint64_t late = 0;
+    try {
+        late = xi_reorder_file(in_path, out_path, window, cfg);
+    } catch (const std::exception &e) {
+        die(e.what());
+    }
+    XiSortStats st = xi_sort_stats();
+    std::cerr << "[xisort] reordered with a " << window << "-value window in " << st.run_ms/1000.0 << " s\n";
+    if (late)
+        std::cerr << "[xisort] " << late << " values beyond the window merged back in "
+                  << st.merge_ms/1000.0 << " s\n";
+}
+
+// ─── distributed sort: coordinator (optionally spawning local workers) ────────
+#ifdef XISORT_HAVE_DIST
+static void dist_sort(const std::string &listen_addr,
+                      std::size_t workers, bool spawn,
+                      const std::string &in_path,
+                      const std::string &out_path,
+                      const char *self,
+                      const XiSortConfig &cfg)
+{
+    std::vector<XiDistShard> shards;
+    std::vector<pid_t> children;
+    try {
+        XiDistCoordinator coord(listen_addr);
+        if (spawn) {
+            const std::string worker_arg = "--dist-worker=" + coord.address();
+            const std::string mem_arg = "--mem-limit=" + std::to_string(cfg.mem_limit);
+            for (std::size_t i = 0; i < workers; ++i) {
+                const pid_t pid = fork();
+                if (pid < 0) die("fork failed");
+                if (pid == 0) {
+                    char *args[] = {const_cast<char*>(self), const_cast<char*>(worker_arg.c_str()),
+                                    const_cast<char*>(mem_arg.c_str()), nullptr};
+                    execvp(self, args);
+                    _exit(127);
+                }
+                children.push_back(pid);
+            }
         }
+        std::cerr << "[xisort] coordinator on " << coord.address() << ", " << workers << " workers\n";
+        shards = coord.sort(workers, in_path, out_path, cfg);
+    } catch (const std::exception &e) {
+        for (pid_t pid : children) waitpid(pid, nullptr, 0);
+        die(e.what());
+    }
+    bool workers_ok = true;
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        workers_ok = workers_ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
     }
-    if (out_idx)
-        fout.write(reinterpret_cast<char*>(out_buf.data()), out_idx*sizeof(double));
-    fout.close();
-    std::cerr << "[xisort] phase‑2 merged in " << ms_since(t2)/1000.0 << " s\n";
+    if (!workers_ok) die("a local worker failed");
+    XiSortStats st = xi_sort_stats();
+    for (const XiDistShard &s : shards)
+        std::cerr << "[xisort] shard " << s.path << ": " << s.elems << " values\n";
+    std::cerr << "[xisort] slices sorted and sampled in " << st.run_ms/1000.0
+              << " s, exchanged and merged in " << st.merge_ms/1000.0 << " s\n";
+}
 
-    for (const auto &p : run_paths) std::filesystem::remove(p);
+static void dist_work(const std::string &coord_addr, const XiSortConfig &cfg)
+{
+    try {
+        xi_dist_worker(coord_addr, cfg);
+    } catch (const std::exception &e) {
+        die(e.what());
+    }
+}
+#else
+static void dist_sort(const std::string &, std::size_t, bool, const std::string &,
+                      const std::string &, const char *, const XiSortConfig &)
+{
+    die("distributed mode needs POSIX sockets");
+}
+static void dist_work(const std::string &, const XiSortConfig &)
+{
+    die("distributed mode needs POSIX sockets");
 }
+#endif
 
 // ─── main ────────────────────────────────────────────────────────────────────
 int main(int argc, char **argv)
 {
-    if (argc < 3) {
+    const bool worker_only = argc == 2 && std::string(argv[1]).rfind("--dist-worker=", 0) == 0;
+    if (argc < 3 && !worker_only) {
         std::cerr << "Usage: ./xisort [options] <input.bin> <output.bin>\n"
                      "Options:\n"
                      "  --external            external merge‑sort mode\n"
                      "  --parallel            enable OpenMP parallelism\n"
                      "  --mem-limit=<bytes>   RAM budget (external mode)\n"
-                     "  --trace               verbose trace\n";
+                     "  --trace               verbose trace (Φ(χ) profile per level/run/round)\n"
+                     "  --report=<file.json>  write run statistics as JSON\n"
+                     "  --trace-events=<file.json>  write Chrome/Perfetto trace of sort phases\n"
+                     "  --mode=<strict|curved>  order by value, or by the curved metric   [strict]\n"
+                     "  --epsilon=<x>         curved metric amplitude, pi*x < 1        [0.01]\n"
+                     "  --tie-break=<policy>  index | value | random | shuffle   [index]\n"
+                     "  --seed=<u64>          seed of the random/shuffle tie-break\n"
+                     "  --timeout=<s>         abort (and clean up) after s seconds\n"
+                     "  --index[=<stride>]    write a sparse index sidecar <output>.xidx with\n"
+                     "                        one fence per stride elements   [4096]; implies --external\n"
+                     "  --argsort=<perm.bin>  also write the sorting permutation (uint64 input\n"
+                     "                        indices); implies --external\n"
+                     "  --records=<len32|lines>  sort framed records (uint32 length prefix,\n"
+                     "                        or newline-delimited); implies --external\n"
+                     "  --delim=<byte>        record delimiter for --records=lines   [\\n]\n"
+                     "  --key-offset=<bytes>  key position inside each record payload   [0]\n"
+                     "  --key-text            key is decimal text, not 8 raw bytes\n"
+                     "  --group-by            write one 40-byte group per distinct value\n"
+                     "                        (value, count, sum, first, last index)\n"
+                     "  --payload=<file.bin>  doubles summed per group (default: the values)\n"
+                     "  --quantiles=<q,...>   print exact quantiles (0..1, lower rank) without\n"
+                     "                        sorting; takes only <input.bin>\n"
+                     "  --top=<k> | --bottom=<k>  write the k largest / smallest values in\n"
+                     "                        ascending order (indices via --argsort)\n"
+                     "  --reorder=<window>    sort a nearly sorted input in one streaming pass;\n"
+                     "                        values further than window positions out are\n"
+                     "                        spilled, sorted and merged back\n"
+                     "  --set=<op>            intersect | union | union-all | difference | join\n"
+                     "                        over sorted files: <in1> <in2> [...] <output>;\n"
+                     "                        join writes (left, right) uint64 position pairs\n"
+                     "  --dist-workers=<n>    distributed sort: coordinate n workers; writes\n"
+                     "                        shards <output>.0 ... <output>.<n-1>\n"
+                     "  --dist-listen=<addr>  coordinator address, unix:<path> or <host>:<port>\n"
+                     "                        (give a reachable host for remote workers)\n"
+                     "                        [unix:xisort_dist.sock]\n"
+                     "  --dist-local          also spawn the n workers as local processes\n"
+                     "  --dist-worker=<addr>  run as a worker of the coordinator at addr\n"
+                     "                        (takes no paths)\n"
+                     "  --throttle-mbps=<x>   emulate a disk of x MB/s\n"
+                     "  --throttle-latency-us=<x>  per-I/O latency of the emulated disk\n";
         return EXIT_FAILURE;
     }
 
     bool external = false, parallel = false, trace = false;
     std::size_t mem_limit = 1ULL<<30; // 1 GiB default
+    double throttle_mbps = 0.0, throttle_latency_us = 0.0;
+    std::string report_path, events_path, perm_path;
+    XiSortConfig cfg;
+    XiRecordFormat rec_fmt;
+    bool records = false, group = false, largest = false;
+    std::uint64_t select = 0, reorder_window = 0;
+    bool reordering = false;
+    std::size_t dist_workers = 0;
+    bool dist_local = false;
+    std::string dist_listen_addr = "unix:xisort_dist.sock", dist_worker_addr;
+    std::string payload_path, quantile_list, set_name;
     std::vector<std::string> pos;
 
     for (int i = 1; i < argc; ++i) {
@@ -169,34 +424,190 @@ int main(int argc, char **argv)
         else if (arg == "--trace") trace = true;
         else if (arg.rfind("--mem-limit=", 0) == 0)
             mem_limit = std::stoull(arg.substr(12));
+        else if (arg.rfind("--report=", 0) == 0)
+            report_path = arg.substr(9);
+        else if (arg.rfind("--trace-events=", 0) == 0)
+            events_path = arg.substr(15);
+        else if (arg == "--mode=strict") cfg.mode = XI_MODE_STRICT;
+        else if (arg == "--mode=curved") cfg.mode = XI_MODE_CURVED;
+        else if (arg.rfind("--mode=", 0) == 0) die("unknown mode " + arg.substr(7));
+        else if (arg.rfind("--epsilon=", 0) == 0)
+            cfg.epsilon = std::stod(arg.substr(10));
+        else if (arg.rfind("--tie-break=", 0) == 0) {
+            if (!xi_tie_break_parse(arg.substr(12), cfg.tie_break))
+                die("unknown tie-break " + arg.substr(12));
+        }
+        else if (arg.rfind("--seed=", 0) == 0)
+            cfg.seed = std::stoull(arg.substr(7));
+        else if (arg == "--index") cfg.index_stride = 4096;
+        else if (arg.rfind("--index=", 0) == 0)
+            cfg.index_stride = std::stoull(arg.substr(8));
+        else if (arg.rfind("--argsort=", 0) == 0)
+            perm_path = arg.substr(10);
+        else if (arg == "--records=len32") { records = true; rec_fmt.framing = XI_FRAME_LEN32; }
+        else if (arg == "--records=lines") { records = true; rec_fmt.framing = XI_FRAME_DELIM; }
+        else if (arg.rfind("--records=", 0) == 0) die("unknown record framing " + arg.substr(10));
+        else if (arg.rfind("--delim=", 0) == 0) {
+            const std::string d = arg.substr(8);
+            if (d.size() == 1) rec_fmt.delim = d[0];
+            else if (d == "\\n") rec_fmt.delim = '\n';
+            else if (d == "\\t") rec_fmt.delim = '\t';
+            else if (d == "\\0") rec_fmt.delim = '\0';
+            else die("delimiter must be one byte (or \\n, \\t, \\0)");
+        }
+        else if (arg.rfind("--key-offset=", 0) == 0)
+            rec_fmt.key_offset = std::stoull(arg.substr(13));
+        else if (arg == "--key-text") rec_fmt.key_text = true;
+        else if (arg == "--group-by") group = true;
+        else if (arg.rfind("--quantiles=", 0) == 0)
+            quantile_list = arg.substr(12);
+        else if (arg.rfind("--reorder=", 0) == 0) {
+            reorder_window = std::stoull(arg.substr(10));
+            reordering = true;
+        }
+        else if (arg.rfind("--dist-workers=", 0) == 0)
+            dist_workers = std::stoull(arg.substr(15));
+        else if (arg.rfind("--dist-listen=", 0) == 0)
+            dist_listen_addr = arg.substr(14);
+        else if (arg == "--dist-local") dist_local = true;
+        else if (arg.rfind("--dist-worker=", 0) == 0)
+            dist_worker_addr = arg.substr(14);
+        else if (arg.rfind("--set=", 0) == 0)
+            set_name = arg.substr(6);
+        else if (arg.rfind("--top=", 0) == 0) { select = std::stoull(arg.substr(6)); largest = true; }
+        else if (arg.rfind("--bottom=", 0) == 0) { select = std::stoull(arg.substr(9)); largest = false; }
+        else if (arg.rfind("--payload=", 0) == 0)
+            payload_path = arg.substr(10);
+        else if (arg.rfind("--timeout=", 0) == 0)
+            cfg.timeout_ms = std::stod(arg.substr(10)) * 1000.0;
+        else if (arg.rfind("--throttle-mbps=", 0) == 0)
+            throttle_mbps = std::stod(arg.substr(16));
+        else if (arg.rfind("--throttle-latency-us=", 0) == 0)
+            throttle_latency_us = std::stod(arg.substr(22));
         else pos.push_back(arg);
     }
+    if (!dist_worker_addr.empty()) {
+        if (!pos.empty()) die("--dist-worker takes no paths");
+        cfg.mem_limit = mem_limit;
+        cfg.parallel = parallel;
+        cfg.buffer_elems = 4096;
+        cfg.cancel = &g_cancel;
+        std::signal(SIGINT, on_stop_signal);
+        std::signal(SIGTERM, on_stop_signal);
+        auto t0 = Clock::now();
+        dist_work(dist_worker_addr, cfg);
+        // one write, as several local workers share the terminal
+        std::cerr << ("[xisort] worker done in " + std::to_string(ms_since(t0)/1000.0) + " s\n");
+        return EXIT_SUCCESS;
+    }
+    if (dist_local && !dist_workers) die("--dist-local needs --dist-workers=<n>");
+    if (!quantile_list.empty() && pos.size() == 1) pos.push_back("");
+    std::vector<std::string> set_inputs;
+    if (!set_name.empty()) {
+        if (pos.size() < 3) die("--set needs at least two inputs and an output");
+        set_inputs.assign(pos.begin(), pos.end() - 1);
+        pos.erase(pos.begin() + 1, pos.end() - 1);
+    }
     if (pos.size() != 2) die("need <input> and <output> paths");
 
     const std::string in_path = pos[0];
     const std::string out_path = pos[1];
 
+    xi_set_io_throttle(throttle_mbps, throttle_latency_us);
     auto t_start = Clock::now();
 
-    if (external)
-        external_sort(in_path, out_path, mem_limit, parallel);
-    else {
+    cfg.parallel = parallel; cfg.trace = trace;
+    cfg.events = !events_path.empty();
+    cfg.cancel = &g_cancel;
+    std::signal(SIGINT, on_stop_signal);
+    std::signal(SIGTERM, on_stop_signal);
+    XiSortStats st;
+    if (records && !perm_path.empty()) die("--argsort does not apply to --records");
+    if (group && (records || !perm_path.empty())) die("--group-by does not combine with --records or --argsort");
+    if (!payload_path.empty() && !group) die("--payload needs --group-by");
+    if (select && (group || records)) die("--top/--bottom do not combine with --group-by or --records");
+    if (cfg.index_stride && (records || group || select || !perm_path.empty() || !quantile_list.empty()))
+        die("--index applies to plain value sorts only");
+    if (!set_name.empty() && (external || records || group || select || cfg.index_stride
+                              || !perm_path.empty() || !quantile_list.empty()))
+        die("--set does not combine with other modes");
+    if (dist_workers && (reordering || !set_name.empty() || records || group || select || cfg.index_stride
+                         || !perm_path.empty() || !quantile_list.empty()))
+        die("--dist-workers does not combine with other modes");
+    if (reordering && (!set_name.empty() || records || group || select || cfg.index_stride
+                       || !perm_path.empty() || !quantile_list.empty()))
+        die("--reorder does not combine with other modes");
+    if (dist_workers) {
+        cfg.mem_limit = mem_limit;
+        dist_sort(dist_listen_addr, dist_workers, dist_local, in_path, out_path, argv[0], cfg);
+        st = xi_sort_stats();
+    } else if (!set_name.empty()) {
+        cfg.mem_limit = mem_limit;
+        cfg.buffer_elems = 4096;
+        set_op(set_name, set_inputs, out_path, cfg);
+        st = xi_sort_stats();
+    } else if (reordering) {
+        cfg.mem_limit = mem_limit;
+        cfg.buffer_elems = 4096;
+        reorder(in_path, out_path, (std::size_t)reorder_window, cfg);
+        st = xi_sort_stats();
+    } else if (!quantile_list.empty()) {
+        cfg.mem_limit = mem_limit;
+        quantiles(in_path, quantile_list, cfg);
+        st = xi_sort_stats();
+    } else if (select) {
+        cfg.mem_limit = mem_limit;
+        select_k(in_path, out_path, perm_path, select, largest, cfg);
+        st = xi_sort_stats();
+    } else if (group) {
+        cfg.mem_limit = mem_limit;
+        cfg.buffer_elems = 4096;
+        group_by(in_path, payload_path, out_path, cfg);
+        st = xi_sort_stats();
+    } else if (external || records || !perm_path.empty() || cfg.index_stride) {
+        cfg.mem_limit = mem_limit;
+        external_sort(in_path, out_path, perm_path, records ? &rec_fmt : nullptr, cfg);
+        st = xi_sort_stats();
+    } else {
         std::uint64_t bytes = std::filesystem::file_size(in_path);
         if (bytes % 8) die("input file size not multiple of 8 bytes");
         std::size_t n = bytes / 8;
         std::vector<double> data(n);
         {
             std::ifstream fin(in_path, std::ios::binary);
-            fin.read(reinterpret_cast<char*>(data.data()), bytes);
+            if (xi_read(fin, data.data(), bytes, XI_FILE_INPUT) != bytes) die("I/O error while reading");
+        }
+        // xi_sort resets the I/O counters: keep the input read, add the output write
+        const XiIoClassStats in_io = xi_io_class_stats(XI_FILE_INPUT);
+        try {
+            xi_sort(data.data(), n, cfg);
+        } catch (const std::exception &e) {
+            die(e.what());
         }
-        XiSortConfig cfg; cfg.parallel = parallel; cfg.trace = trace;
-        xi_sort(data.data(), n, cfg);
         {
             std::ofstream fout(out_path, std::ios::binary);
-            fout.write(reinterpret_cast<char*>(data.data()), bytes);
+            xi_write(fout, data.data(), bytes, XI_FILE_OUTPUT);
         }
+        st = xi_sort_stats();
+        st.io[XI_FILE_INPUT] = in_io;
+        st.io[XI_FILE_OUTPUT] = xi_io_class_stats(XI_FILE_OUTPUT);
+        st.bytes_read += in_io.read.bytes;
+        st.bytes_written += st.io[XI_FILE_OUTPUT].write.bytes;
     }
 
-    std::cerr << "[xisort] total " << ms_since(t_start)/1000.0 << " s" << std::endl;
+    const double total_s = ms_since(t_start)/1000.0;
+    if (trace) {
+        print_trace_report(st);
+        print_resource_report(st);
+    }
+    if (!report_path.empty()) write_json_report(report_path, st, total_s);
+    if (!events_path.empty()) {
+        try {
+            xi_write_trace_events(events_path);
+        } catch (const std::exception &e) {
+            die(e.what());
+        }
+    }
+    std::cerr << "[xisort] total " << total_s << " s" << std::endl;
     return EXIT_SUCCESS;
 }
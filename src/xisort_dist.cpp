@@ -0,0 +1,706 @@
+// xisort_dist.cpp  — Distributed external sort: one coordinator, N worker processes
+// AUTHOR: Faruk Alpay  •  ORCID: 0009-0009-2207-6528
+// -----------------------------------------------------------------------------
+// Sample sort by regular sampling over TCP or Unix-domain sockets. The coordinator
+// gives every worker a contiguous slice of the input; each worker then
+//   1. sorts its slice with the external sort, writing an .xidx sidecar whose
+//      fences double as regular samples of the slice,
+//   2. sends those samples; the coordinator sorts all of them and broadcasts
+//      N - 1 splitter keys together with the workers' data addresses,
+//   3. cuts its sorted slice at the splitters (XiSortedFile bounds, one block
+//      read each) and streams range j to worker j, while receiving one sorted
+//      stream from every peer,
+//   4. merges what it received (xi_set_op_files, union-all) into shard j.
+// Shard j holds the keys between splitters j-1 and j, so the shards in order are
+// the sorted input; every element crosses the network at most once. Input and shard
+// paths must be visible to all workers (one host, or a shared mount). Each worker
+// keeps its scratch files in a private directory under its working directory.
+// Like xisort_gen.cpp this file is #included by the front-ends, after xisort.cpp.
+// The coordinator and each worker are public calls with their own call state, so
+// they may share a process (each worker on its own thread) as well as run apart.
+//
+// Addresses: "unix:<path>" or "<host>:<port>" (TCP; port 0 picks a free port).
+// Workers listen for peer data on the interface that reaches the coordinator (TCP)
+// or on "<coordinator path>.<pid>_<call>" (Unix). Values travel in host byte order, like
+// the files themselves. POSIX only: elsewhere the file is empty and
+// XISORT_HAVE_DIST stays undefined.
+// -----------------------------------------------------------------------------
+
+#if defined(__unix__) || defined(__APPLE__)
+#define XISORT_HAVE_DIST 1
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <exception>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const std::size_t XI_DIST_BLOCK = 1 << 16;        // doubles per data send / recv
+static const uint64_t XI_DIST_OVERSAMPLE = 64;           // samples per worker and shard
+static const double XI_DIST_CONNECT_MS = 30000.0;         // workers may start first
+
+// Output shard j of a distributed sort
+struct XiDistShard {
+    std::string path;
+    uint64_t elems;
+};
+
+// ─── sockets ─────────────────────────────────────────────────────────────────
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0      // macOS: SO_NOSIGPIPE is set per socket instead
+#endif
+
+static std::runtime_error dist_error(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// New descriptor: close-on-exec (spawned local workers must not inherit it), and
+// no SIGPIPE when a peer has gone
+static int dist_own(int fd) {
+    if(fd >= 0) {
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof one);
+#endif
+    }
+    return fd;
+}
+
+// Owned socket descriptor; a listening Unix socket also removes its path
+struct XiSocket {
+    int fd;
+    std::string unlinkPath;
+    explicit XiSocket(int f = -1) : fd(f) {}
+    XiSocket(XiSocket &&o) noexcept : fd(o.fd), unlinkPath(std::move(o.unlinkPath)) {
+        o.fd = -1;
+        o.unlinkPath.clear();
+    }
+    XiSocket &operator=(XiSocket &&o) noexcept {
+        if(this != &o) {
+            close();
+            fd = o.fd;
+            unlinkPath = std::move(o.unlinkPath);
+            o.fd = -1;
+            o.unlinkPath.clear();
+        }
+        return *this;
+    }
+    XiSocket(const XiSocket &) = delete;
+    XiSocket &operator=(const XiSocket &) = delete;
+    ~XiSocket() { close(); }
+    void close() {
+        if(fd >= 0) ::close(fd);
+        fd = -1;
+        if(!unlinkPath.empty()) ::unlink(unlinkPath.c_str());
+        unlinkPath.clear();
+    }
+};
+
+struct XiDistAddr {
+    bool local;          // Unix-domain
+    std::string host;    // or the socket path
+    std::string port;
+};
+
+static XiDistAddr dist_parse(const std::string &addr) {
+    if(addr.rfind("unix:", 0) == 0) return XiDistAddr{true, addr.substr(5), std::string()};
+    const std::size_t colon = addr.rfind(':');
+    if(colon == std::string::npos || colon + 1 == addr.size())
+        throw std::runtime_error("bad address " + addr + " (unix:<path> or <host>:<port>)");
+    std::string host = addr.substr(0, colon);
+    if(host.size() >= 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+    return XiDistAddr{false, host, addr.substr(colon + 1)};
+}
+
+static sockaddr_un dist_unix_addr(const std::string &path) {
+    sockaddr_un sa;
+    std::memset(&sa, 0, sizeof sa);
+    sa.sun_family = AF_UNIX;
+    if(path.empty() || path.size() >= sizeof sa.sun_path) throw std::runtime_error("bad socket path " + path);
+    std::memcpy(sa.sun_path, path.c_str(), path.size() + 1);
+    return sa;
+}
+
+// "host:port" of a bound or connected TCP socket (local side)
+static std::string dist_sock_name(int fd, uint16_t *port) {
+    sockaddr_storage ss;
+    socklen_t len = sizeof ss;
+    if(::getsockname(fd, (sockaddr *)&ss, &len) < 0) throw dist_error("getsockname");
+    char ip[INET6_ADDRSTRLEN] = {0};
+    if(ss.ss_family == AF_INET6) {
+        const sockaddr_in6 *a = (const sockaddr_in6 *)&ss;
+        ::inet_ntop(AF_INET6, &a->sin6_addr, ip, sizeof ip);
+        *port = ntohs(a->sin6_port);
+        return std::string("[") + ip + "]";
+    }
+    const sockaddr_in *a = (const sockaddr_in *)&ss;
+    ::inet_ntop(AF_INET, &a->sin_addr, ip, sizeof ip);
+    *port = ntohs(a->sin_port);
+    return ip;
+}
+
+// Listen on addr; `bound` receives the address peers should dial (the real port
+// when addr asked for port 0)
+static XiSocket dist_listen(const std::string &addr, std::string &bound) {
+    const XiDistAddr a = dist_parse(addr);
+    if(a.local) {
+        const sockaddr_un sa = dist_unix_addr(a.host);
+        XiSocket s(dist_own(::socket(AF_UNIX, SOCK_STREAM, 0)));
+        if(s.fd < 0) throw dist_error("socket");
+        ::unlink(a.host.c_str());
+        if(::bind(s.fd, (const sockaddr *)&sa, sizeof sa) < 0) throw dist_error("cannot bind " + addr);
+        s.unlinkPath = a.host;
+        if(::listen(s.fd, SOMAXCONN) < 0) throw dist_error("cannot listen on " + addr);
+        bound = addr;
+        return s;
+    }
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo *res = nullptr;
+    const bool any = a.host.empty() || a.host == "*";
+    if(::getaddrinfo(any ? nullptr : a.host.c_str(), a.port.c_str(), &hints, &res) != 0 || !res)
+        throw std::runtime_error("cannot resolve " + addr);
+    XiSocket s(dist_own(::socket(res->ai_family, res->ai_socktype, res->ai_protocol)));
+    int one = 1;
+    const bool ok = s.fd >= 0 && ::setsockopt(s.fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one) == 0
+                 && ::bind(s.fd, res->ai_addr, res->ai_addrlen) == 0 && ::listen(s.fd, SOMAXCONN) == 0;
+    ::freeaddrinfo(res);
+    if(!ok) throw dist_error("cannot listen on " + addr);
+    uint16_t port = 0;
+    const std::string host = dist_sock_name(s.fd, &port);
+    bound = (any ? std::string("127.0.0.1") : host) + ":" + std::to_string(port);
+    return s;
+}
+
+// Block until fd is readable (or, for POLLOUT, writable), polling the cancellation
+// flag, the deadline and the call's abortFd: a worker's coordinator connection during
+// the data exchange, when the coordinator sends nothing, so readable means it has gone
+static void dist_wait(int fd, short events = POLLIN) {
+    const int abortFd = cur_call().abortFd;
+    pollfd p[2];
+    p[0].fd = fd;
+    p[1].fd = abortFd;
+    p[0].events = events;
+    p[1].events = POLLIN;
+    const nfds_t n = (abortFd >= 0 && abortFd != fd) ? 2 : 1;
+    for(;;) {
+        cancel_point();
+        p[0].revents = p[1].revents = 0;
+        const int r = ::poll(p, n, 100);
+        if(r < 0 && errno != EINTR) throw dist_error("poll");
+        if(r <= 0) continue;
+        if(n == 2 && p[1].revents) throw std::runtime_error("distributed sort aborted by the coordinator");
+        if(p[0].revents) return;
+    }
+}
+
+static XiSocket dist_accept(const XiSocket &listener) {
+    for(;;) {
+        dist_wait(listener.fd);
+        XiSocket s(dist_own(::accept(listener.fd, nullptr, nullptr)));
+        if(s.fd >= 0) return s;
+        if(errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) throw dist_error("accept");
+    }
+}
+
+static XiSocket dist_try_connect(const XiDistAddr &a) {
+    if(a.local) {
+        const sockaddr_un sa = dist_unix_addr(a.host);
+        XiSocket s(dist_own(::socket(AF_UNIX, SOCK_STREAM, 0)));
+        if(s.fd >= 0 && ::connect(s.fd, (const sockaddr *)&sa, sizeof sa) == 0) return s;
+        return XiSocket();
+    }
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    if(::getaddrinfo(a.host.c_str(), a.port.c_str(), &hints, &res) != 0 || !res) return XiSocket();
+    XiSocket s;
+    for(addrinfo *r = res; r; r = r->ai_next) {
+        s = XiSocket(dist_own(::socket(r->ai_family, r->ai_socktype, r->ai_protocol)));
+        if(s.fd >= 0 && ::connect(s.fd, r->ai_addr, r->ai_addrlen) == 0) break;
+        s.close();
+    }
+    ::freeaddrinfo(res);
+    if(s.fd >= 0) {
+        int one = 1;
+        ::setsockopt(s.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    }
+    return s;
+}
+
+// Connect to addr, retrying for up to timeout_ms while nobody listens yet
+static XiSocket dist_connect(const std::string &addr, double timeout_ms) {
+    const XiDistAddr a = dist_parse(addr);
+    const auto until = std::chrono::steady_clock::now()
+                     + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                           std::chrono::duration<double, std::milli>(timeout_ms));
+    for(;;) {
+        cancel_point();
+        if(cur_call().abortFd >= 0) {
+            pollfd p = {cur_call().abortFd, POLLIN, 0};
+            if(::poll(&p, 1, 0) > 0) throw std::runtime_error("distributed sort aborted by the coordinator");
+        }
+        XiSocket s = dist_try_connect(a);
+        if(s.fd >= 0) return s;
+        if(std::chrono::steady_clock::now() >= until) throw dist_error("cannot connect to " + addr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+// Non-blocking sends between waits, so a peer that stops reading cannot hold the
+// sender past an abort
+static void dist_send(const XiSocket &s, const void *p, std::size_t n) {
+    const char *c = (const char *)p;
+    while(n) {
+        dist_wait(s.fd, POLLOUT);
+        const ssize_t w = ::send(s.fd, c, n, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(w < 0) {
+            if(errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+            throw dist_error("send");
+        }
+        c += w;
+        n -= (std::size_t)w;
+    }
+}
+
+static void dist_recv(const XiSocket &s, void *p, std::size_t n) {
+    char *c = (char *)p;
+    while(n) {
+        dist_wait(s.fd);
+        const ssize_t r = ::recv(s.fd, c, n, 0);
+        if(r == 0) throw std::runtime_error("connection closed by peer");
+        if(r < 0) {
+            if(errno == EINTR || errno == EAGAIN) continue;
+            throw dist_error("recv");
+        }
+        c += r;
+        n -= (std::size_t)r;
+    }
+}
+
+// ─── control messages ────────────────────────────────────────────────────────
+// A 16-byte header {type, body bytes}, then the body: uint64 fields and
+// length-prefixed strings, read back in the order they were put
+enum XiDistType {
+    XI_DIST_HELLO = 1,   // worker → coordinator: data address
+    XI_DIST_JOB,         // coordinator → worker: id, workers, slice, input, shard path
+    XI_DIST_SAMPLES,     // worker → coordinator: sample keys of the sorted slice
+    XI_DIST_SPLIT,       // coordinator → worker: splitter keys, data addresses
+    XI_DIST_DONE,        // worker → coordinator: shard element count
+    XI_DIST_FAIL         // either way: error text
+};
+
+struct XiDistMsg {
+    uint64_t type;
+    std::vector<char> body;
+    std::size_t at;
+    explicit XiDistMsg(uint64_t t = 0) : type(t), at(0) {}
+    void put_u64(uint64_t v) {
+        const char *p = (const char *)&v;
+        body.insert(body.end(), p, p + sizeof v);
+    }
+    void put_str(const std::string &s) {
+        put_u64(s.size());
+        body.insert(body.end(), s.begin(), s.end());
+    }
+    uint64_t get_u64() {
+        uint64_t v;
+        if(body.size() - at < sizeof v) throw std::runtime_error("truncated control message");
+        std::memcpy(&v, body.data() + at, sizeof v);
+        at += sizeof v;
+        return v;
+    }
+    std::string get_str() {
+        const uint64_t n = get_u64();
+        if(body.size() - at < n) throw std::runtime_error("truncated control message");
+        std::string s(body.data() + at, (std::size_t)n);
+        at += (std::size_t)n;
+        return s;
+    }
+};
+
+static void dist_send_msg(const XiSocket &s, const XiDistMsg &m) {
+    const uint64_t head[2] = {m.type, m.body.size()};
+    dist_send(s, head, sizeof head);
+    dist_send(s, m.body.data(), m.body.size());
+}
+
+// Next message, which must be of type `expect`; a FAIL message is rethrown
+static XiDistMsg dist_recv_msg(const XiSocket &s, uint64_t expect) {
+    uint64_t head[2];
+    dist_recv(s, head, sizeof head);
+    if(head[1] > (1ULL << 32)) throw std::runtime_error("oversized control message");
+    XiDistMsg m(head[0]);
+    m.body.resize((std::size_t)head[1]);
+    dist_recv(s, m.body.data(), m.body.size());
+    if(m.type == XI_DIST_FAIL) throw std::runtime_error(m.get_str());
+    if(m.type != expect) throw std::runtime_error("unexpected control message");
+    return m;
+}
+
+// ─── worker ──────────────────────────────────────────────────────────────────
+// Private scratch directory under the working directory (several workers may share
+// one); the slice, its runs and the received parts live there. The process working
+// directory itself is never changed.
+struct XiDistWorkdir {
+    std::filesystem::path dir;
+    explicit XiDistWorkdir(const std::string &name) : dir(std::filesystem::absolute(name)) {
+        std::filesystem::create_directories(dir);
+    }
+    ~XiDistWorkdir() {
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+    std::string file(const std::string &name) const { return (dir / name).string(); }
+    std::string part(uint64_t source) const { return file("part_" + std::to_string(source) + ".bin"); }
+};
+
+// Accept one data stream per peer and write each to the work directory's part file;
+// every connection is read as soon as it is accepted, as its sender may be blocked on it.
+// Runs on its own thread, for the worker call `cs`.
+static void dist_receive_parts(XiCallState *cs, const XiSocket &listener, uint64_t peers,
+                               const XiDistWorkdir &work, std::exception_ptr &failure) {
+    XiCallScope scope(cs);
+    std::vector<XiSocket> conns((std::size_t)peers);
+    std::vector<std::exception_ptr> errors((std::size_t)peers);
+    std::vector<std::thread> readers;
+    auto read_part = [cs, &conns, &errors, &work](std::size_t i) {
+        XiCallScope scope(cs);
+        try {
+            const XiSocket &c = conns[i];
+            uint64_t head[2];             // source worker, element count
+            dist_recv(c, head, sizeof head);
+            const std::string part = work.part(head[0]);
+            XiOutFile out(part, std::ios::binary);
+            if(!out) throw std::runtime_error("cannot open " + part);
+            xi_vector<double> buf(XI_DIST_BLOCK);
+            XiSpan span("dist_recv", "io", "elems", (long long)head[1]);
+            for(uint64_t left = head[1]; left; ) {
+                const std::size_t cnt = (left < XI_DIST_BLOCK) ? (std::size_t)left : XI_DIST_BLOCK;
+                dist_recv(c, buf.data(), cnt * sizeof(double));
+                xi_write(out, buf.data(), cnt * sizeof(double), XI_FILE_RUN);
+                left -= cnt;
+            }
+            out.close();
+            if(!out) throw std::runtime_error("I/O error while writing " + part);
+        } catch(...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    try {
+        for(std::size_t i = 0; i < conns.size(); ++i) {
+            conns[i] = dist_accept(listener);
+            readers.emplace_back(read_part, i);
+        }
+    } catch(...) {
+        failure = std::current_exception();
+    }
+    for(std::thread &t : readers) t.join();
+    for(const std::exception_ptr &e : errors) {
+        if(e && !failure) failure = e;
+    }
+}
+
+// Elements [lo, hi) of the sorted slice, to one peer or to the local part file
+static void dist_send_range(XiInFile &slice, uint64_t lo, uint64_t hi, const XiSocket *peer,
+                            const std::string &part, uint64_t self) {
+    slice.clear();
+    slice.seekg((std::streamoff)(lo * sizeof(double)));
+    XiOutFile out;
+    if(peer) {
+        const uint64_t head[2] = {self, hi - lo};
+        dist_send(*peer, head, sizeof head);
+    } else {
+        out.open(part, std::ios::binary);
+        if(!out) throw std::runtime_error("cannot open " + part);
+    }
+    xi_vector<double> buf(XI_DIST_BLOCK);
+    XiSpan span("dist_send", "io", "elems", (long long)(hi - lo));
+    for(uint64_t at = lo; at < hi; ) {
+        const std::size_t cnt = (hi - at < XI_DIST_BLOCK) ? (std::size_t)(hi - at) : XI_DIST_BLOCK;
+        if(xi_read(slice, buf.data(), cnt * sizeof(double), XI_FILE_RUN) != cnt * sizeof(double))
+            throw std::runtime_error("I/O error while reading the sorted slice");
+        if(peer) dist_send(*peer, buf.data(), cnt * sizeof(double));
+        else xi_write(out, buf.data(), cnt * sizeof(double), XI_FILE_RUN);
+        at += cnt;
+    }
+    if(!peer) {
+        out.close();
+        if(!out) throw std::runtime_error("I/O error while writing " + part);
+    }
+}
+
+static void dist_report_fail(const XiSocket &coord, const char *what) {
+    XiDistMsg fail(XI_DIST_FAIL);
+    fail.put_str(what);
+    try {
+        dist_send_msg(coord, fail);
+    } catch(const std::exception &) {
+    }
+}
+
+// Sets `reported` once this worker's failure has been sent to the coordinator
+static uint64_t xi_dist_worker_impl(const XiSocket &coord, const std::string &coord_addr, const XiSortConfig &cfg,
+                                    bool &reported) {
+    // data listener, reachable from the peers
+    std::string data_addr;
+    XiSocket data;
+    const XiDistAddr ca = dist_parse(coord_addr);
+    if(ca.local) {
+        data = dist_listen("unix:" + std::filesystem::absolute(ca.host + "." + cur_call().scratchTag).string(),
+                           data_addr);
+    } else {
+        uint16_t port = 0;
+        data = dist_listen(dist_sock_name(coord.fd, &port) + ":0", data_addr);
+    }
+    XiDistMsg hello(XI_DIST_HELLO);
+    hello.put_str(data_addr);
+    dist_send_msg(coord, hello);
+
+    XiDistMsg job = dist_recv_msg(coord, XI_DIST_JOB);
+    const uint64_t id = job.get_u64(), workers = job.get_u64();
+    const uint64_t first = job.get_u64(), count = job.get_u64();
+    const std::string in_path = job.get_str(), shard_path = job.get_str();
+    const XiDistWorkdir work("xisort_dist_" + cur_call().scratchTag);
+    const std::string slice_path = work.file("slice.bin");
+
+    // 1. sort the slice; the sidecar fences are its regular samples
+    XiSortConfig slice_cfg = cfg;
+    slice_cfg.index_stride = std::max<uint64_t>(1, count / (XI_DIST_OVERSAMPLE * workers));
+    slice_cfg.scratch_dir = work.dir.string();
+    xi_sort_file_impl(in_path, slice_path, slice_cfg, first, count);
+    uint64_t elems = 0;
+    std::vector<uint64_t> fences;
+    load_index(slice_path, elems, fences);
+    XiDistMsg samples(XI_DIST_SAMPLES);
+    samples.put_u64(fences.size());
+    for(uint64_t k : fences) samples.put_u64(k);
+    dist_send_msg(coord, samples);
+
+    // 2. splitters and peers
+    XiDistMsg split = dist_recv_msg(coord, XI_DIST_SPLIT);
+    std::vector<uint64_t> cuts(1, 0);
+    {
+        XiSortedFile sorted(slice_path);
+        for(uint64_t j = 0; j + 1 < workers; ++j) cuts.push_back(sorted.lower_bound(key_to_double(split.get_u64())));
+        cuts.push_back(sorted.size());
+    }
+    std::vector<std::string> peers;
+    for(uint64_t j = 0; j < workers; ++j) peers.push_back(split.get_str());
+
+    // 3. exchange: receive from every peer while sending range j to worker j
+    cur_call().abortFd = coord.fd;
+    std::exception_ptr recvFailure;
+    std::thread receiver(dist_receive_parts, &cur_call(), std::cref(data), workers - 1, std::cref(work),
+                         std::ref(recvFailure));
+    try {
+        XiInFile slice(slice_path, std::ios::binary);
+        if(!slice) throw std::runtime_error("cannot open the sorted slice");
+        for(uint64_t k = 1; k < workers; ++k) {
+            const uint64_t j = (id + k) % workers;     // stagger, so peers are not all hit at once
+            XiSocket peer = dist_connect(peers[(std::size_t)j], XI_DIST_CONNECT_MS);
+            dist_send_range(slice, cuts[(std::size_t)j], cuts[(std::size_t)j + 1], &peer, std::string(), id);
+        }
+        dist_send_range(slice, cuts[(std::size_t)id], cuts[(std::size_t)id + 1], nullptr, work.part(id), id);
+    } catch(const std::exception &e) {
+        // report first: the peers still waiting for this worker's data are only
+        // released by the coordinator's FAIL, and the receiver ends with them
+        dist_report_fail(coord, e.what());
+        reported = true;
+        receiver.join();
+        cur_call().abortFd = -1;
+        throw;
+    } catch(...) {
+        receiver.join();
+        cur_call().abortFd = -1;
+        throw;
+    }
+    receiver.join();
+    cur_call().abortFd = -1;
+    if(recvFailure) std::rethrow_exception(recvFailure);
+    std::filesystem::remove(slice_path);
+    std::filesystem::remove(slice_path + XI_INDEX_SUFFIX);
+
+    // 4. merge the sorted parts into the shard
+    std::vector<std::string> parts;
+    for(uint64_t j = 0; j < workers; ++j) parts.push_back(work.part(j));
+    XiSortConfig merge_cfg = cfg;
+    merge_cfg.buffer_elems = XI_DIST_BLOCK;
+    merge_cfg.scratch_dir = work.dir.string();
+    return xi_set_op_files_impl(parts, shard_path, XI_SET_UNION_ALL, merge_cfg);
+}
+
+// Serve one distributed sort as a worker: connect to the coordinator at coord_addr
+// (retrying while it starts), sort the slice it assigns, exchange key ranges with the
+// other workers and write the assigned output shard. cfg.mem_limit bounds this worker's
+// sort. STRICT mode only. Throws std::runtime_error; the coordinator is told why.
+void xi_dist_worker(const std::string &coord_addr, const XiSortConfig &cfg) {
+    XiCall call;
+    if(cfg.mode != XI_MODE_STRICT) throw std::runtime_error("distributed sort supports STRICT mode only");
+    stats_begin();
+    eventsOn.store(cfg.events, std::memory_order_relaxed);
+    abort_begin(cfg);
+    XiSpan span("xi_dist_worker", "sort");
+    XiSocket coord = dist_connect(coord_addr, XI_DIST_CONNECT_MS);
+    bool reported = false;
+    try {
+        XiDistMsg done(XI_DIST_DONE);
+        done.put_u64(xi_dist_worker_impl(coord, coord_addr, cfg, reported));
+        dist_send_msg(coord, done);
+    } catch(const std::exception &e) {
+        if(!reported) dist_report_fail(coord, e.what());
+        throw;
+    }
+    stats_end(cfg.trace);
+}
+
+// ─── coordinator ─────────────────────────────────────────────────────────────
+// Listens first, so workers can be pointed at address() before sort() runs
+class XiDistCoordinator {
+    XiSocket listener;
+    std::string bound;
+
+public:
+    explicit XiDistCoordinator(const std::string &listen_addr) {
+        listener = dist_listen(listen_addr, bound);
+    }
+
+    // The address workers should connect to (the real port for "<host>:0")
+    const std::string &address() const { return bound; }
+
+    // Sort in_path with `workers` workers into shards out_path.0 ... out_path.<N-1>,
+    // which concatenated in order are the sorted input. Returns the shards. Throws
+    // std::runtime_error, including a worker's own error.
+    std::vector<XiDistShard> sort(std::size_t workers, const std::string &in_path, const std::string &out_path,
+                                  const XiSortConfig &cfg) {
+        XiCall call;
+        if(cfg.mode != XI_MODE_STRICT) throw std::runtime_error("distributed sort supports STRICT mode only");
+        stats_begin();
+        eventsOn.store(cfg.events, std::memory_order_relaxed);
+        abort_begin(cfg);
+        XiSpan span("xi_dist_sort", "sort", "workers", (long long)workers);
+        std::vector<XiDistShard> shards = sort_impl(workers, in_path, out_path);
+        stats_end(cfg.trace);
+        return shards;
+    }
+
+private:
+    // One message of type `expect` from every worker, in arrival order. The first FAIL,
+    // lost connection or cancellation is passed to every worker as FAIL, and the
+    // connections are closed: a healthy worker may be blocked on the failed one.
+    static std::vector<XiDistMsg> gather(std::vector<XiSocket> &conns, uint64_t expect) {
+        std::vector<XiDistMsg> got(conns.size());
+        std::vector<pollfd> p(conns.size());
+        for(std::size_t i = 0; i < conns.size(); ++i) {
+            p[i].fd = conns[i].fd;
+            p[i].events = POLLIN;
+        }
+        try {
+            for(std::size_t left = conns.size(); left; ) {
+                cancel_point();
+                for(pollfd &x : p) x.revents = 0;
+                const int r = ::poll(p.data(), (nfds_t)p.size(), 100);
+                if(r < 0 && errno != EINTR) throw dist_error("poll");
+                for(std::size_t i = 0; r > 0 && i < p.size(); ++i) {
+                    if(!p[i].revents) continue;
+                    try {
+                        got[i] = dist_recv_msg(conns[i], expect);
+                    } catch(const XiCancelled &) {
+                        throw;
+                    } catch(const std::exception &e) {
+                        throw std::runtime_error("worker " + std::to_string(i) + ": " + e.what());
+                    }
+                    p[i].fd = -1;       // answered: poll skips negative descriptors
+                    --left;
+                }
+            }
+        } catch(const std::exception &e) {
+            XiDistMsg fail(XI_DIST_FAIL);
+            fail.put_str(e.what());
+            for(XiSocket &c : conns) {
+                try {
+                    dist_send_msg(c, fail);
+                } catch(const std::exception &) {
+                }
+                c.close();
+            }
+            throw;
+        }
+        return got;
+    }
+
+    std::vector<XiDistShard> sort_impl(std::size_t workers, const std::string &in_path, const std::string &out_path) {
+        if(workers == 0) throw std::runtime_error("distributed sort needs at least one worker");
+        std::error_code ec;
+        const uint64_t total_bytes = std::filesystem::file_size(in_path, ec);
+        if(ec) throw std::runtime_error("cannot stat input file " + in_path);
+        if(total_bytes % sizeof(double)) throw std::runtime_error("input file size not multiple of 8 bytes");
+        const uint64_t total_elems = total_bytes / sizeof(double);
+        const std::string in_abs = std::filesystem::absolute(in_path).string();
+        const std::string out_abs = std::filesystem::absolute(out_path).string();
+
+        auto t1 = std::chrono::steady_clock::now();
+        std::vector<XiSocket> conns;
+        std::vector<std::string> data_addrs;
+        std::vector<XiDistShard> shards;
+        for(std::size_t i = 0; i < workers; ++i) {
+            conns.push_back(dist_accept(listener));
+            data_addrs.push_back(dist_recv_msg(conns.back(), XI_DIST_HELLO).get_str());
+            const uint64_t first = total_elems * i / workers, next = total_elems * (i + 1) / workers;
+            shards.push_back(XiDistShard{out_abs + "." + std::to_string(i), 0});
+            XiDistMsg job(XI_DIST_JOB);
+            job.put_u64(i);
+            job.put_u64(workers);
+            job.put_u64(first);
+            job.put_u64(next - first);
+            job.put_str(in_abs);
+            job.put_str(shards.back().path);
+            dist_send_msg(conns.back(), job);
+        }
+
+        // splitters: evenly spaced keys of all the workers' regular samples
+        std::vector<uint64_t> samples;
+        for(XiDistMsg &m : gather(conns, XI_DIST_SAMPLES)) {
+            for(uint64_t k = m.get_u64(); k; --k) samples.push_back(m.get_u64());
+        }
+        cur_call().stats.run_ms = ms_between(t1, std::chrono::steady_clock::now());
+        std::sort(samples.begin(), samples.end());
+        XiDistMsg split(XI_DIST_SPLIT);
+        for(std::size_t j = 1; j < workers; ++j) {
+            split.put_u64(samples.empty() ? UINT64_MAX : samples[samples.size() * j / workers]);
+        }
+        for(const std::string &a : data_addrs) split.put_str(a);
+        for(XiSocket &c : conns) dist_send_msg(c, split);
+
+        std::vector<XiDistMsg> done = gather(conns, XI_DIST_DONE);
+        for(std::size_t i = 0; i < workers; ++i) {
+            shards[i].elems = done[i].get_u64();
+        }
+        uint64_t sum = 0;
+        for(const XiDistShard &s : shards) sum += s.elems;
+        if(sum != total_elems) throw std::runtime_error("shards do not add up to the input");
+        cur_call().stats.runs = workers;
+        cur_call().stats.merge_rounds = 1;
+        cur_call().stats.merge_ms = ms_between(t1, std::chrono::steady_clock::now()) - cur_call().stats.run_ms;
+        return shards;
+    }
+};
+
+#endif // XISORT_HAVE_DIST
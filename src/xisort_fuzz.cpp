@@ -0,0 +1,409 @@
+// xisort_fuzz.cpp  — Differential fuzzer for every XiSort engine and mode
+// AUTHOR: Faruk Alpay  •  ORCID: 0009-0009-2207-6528
+// -----------------------------------------------------------------------------
+// Each input is sorted by every engine below and compared bit-for-bit with
+// std::stable_sort on double_to_key, so NaN payloads and ±0 must land exactly
+// where the IEEE-754 total order puts them. External modes run with tiny
+// mem_limit / buffer_elems values taken from the input, forcing many runs,
+// odd pairwise rounds and constant buffer refills. The xi_argsort engines apply
+// their permutation back to the input, which must then match the same reference;
+// under the index and value policies equal keys must also keep input order.
+// xi_argsort_file must write values that agree with its permutation, and keeps
+// ties in input order too.
+//
+// Input format (shared by libFuzzer corpora, --replay and saved failures):
+//   byte 0   run length in elements for external modes:  1 + b % 16
+//            (raised to n / 256 so no more than 256 runs are open at once)
+//   byte 1   buffer_elems for the file merges:            1 + b % 8
+//   byte 2+  little-endian doubles (trailing partial bytes ignored)
+//
+// Build:
+//   make fuzz                        (or: cmake --build build --target xisort_fuzz)
+//   make fuzz-libfuzzer              (clang: -fsanitize=fuzzer,address -DXISORT_LIBFUZZER)
+// Run:
+//   ./xisort_fuzz [--iters=<k>] [--seconds=<s>] [--seed=<u64>] [--max-n=<elems>]
+//                 [--engine=<name>]
+//   ./xisort_fuzz --replay=<file>
+// A failure is minimised (element removal, then value simplification) and saved
+// as xisort_fuzz_fail_<engine>.bin in the input format above.
+// -----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "xisort.cpp"       // core sorter + XiSortConfig + double_to_key
+#include "xisort_gen.cpp"   // seeded distributions for the standalone driver
+
+using Clock = std::chrono::steady_clock;
+
+// ─── engines under test ──────────────────────────────────────────────────────
+struct FuzzCase {
+    std::vector<double> v;
+    std::size_t run_elems;      // external mem_limit, in elements
+    std::size_t buffer_elems;
+};
+
+struct FuzzEngine {
+    std::string name;
+    std::function<void(std::vector<double>&, const FuzzCase&)> run;
+};
+
+static const std::string FUZZ_IN  = "xisort_fuzz_in.bin";
+static const std::string FUZZ_OUT = "xisort_fuzz_out.bin";
+static const std::string FUZZ_PERM = "xisort_fuzz_perm.bin";
+
+// Run length actually used: at most 256 runs, so the k-way merge stays well
+// inside the open-file limit
+static std::size_t run_elems(const FuzzCase &fc) {
+    return std::max<std::size_t>(fc.run_elems, (fc.v.size() + 255) / 256);
+}
+
+static void run_xi_sort_file(std::vector<double> &v, const FuzzCase &fc, bool gallop) {
+    {
+        std::ofstream out(FUZZ_IN, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(double));
+    }
+    XiSortConfig cfg;
+    cfg.mem_limit = run_elems(fc) * sizeof(double);
+    cfg.buffer_elems = fc.buffer_elems;
+    cfg.gallop = gallop;
+    xi_sort_file(FUZZ_IN, FUZZ_OUT, cfg);
+    std::ifstream in(FUZZ_OUT, std::ios::binary);
+    in.read(reinterpret_cast<char*>(v.data()), v.size() * sizeof(double));
+    if (static_cast<std::size_t>(in.gcount()) != v.size() * sizeof(double))
+        throw std::runtime_error("short output file");
+}
+
+static std::vector<FuzzEngine> fuzz_engines() {
+    std::vector<FuzzEngine> e;
+    for (int g = 1; g >= 0; --g) {
+        const bool gallop = g != 0;
+        const std::string sfx = gallop ? "" : "/no-gallop";
+        e.push_back({"xi_sort/serial" + sfx, [gallop](std::vector<double> &v, const FuzzCase &) {
+            XiSortConfig cfg; cfg.gallop = gallop;
+            xi_sort(v.data(), v.size(), cfg);
+        }});
+        e.push_back({"xi_sort/parallel" + sfx, [gallop](std::vector<double> &v, const FuzzCase &) {
+            XiSortConfig cfg; cfg.parallel = true; cfg.gallop = gallop;
+            xi_sort(v.data(), v.size(), cfg);
+        }});
+        e.push_back({"xi_sort/external" + sfx, [gallop](std::vector<double> &v, const FuzzCase &fc) {
+            XiSortConfig cfg; cfg.external = true; cfg.gallop = gallop;
+            cfg.mem_limit = run_elems(fc) * sizeof(double);
+            cfg.buffer_elems = fc.buffer_elems;
+            xi_sort(v.data(), v.size(), cfg);
+        }});
+        e.push_back({"xi_sort_file" + sfx, [gallop](std::vector<double> &v, const FuzzCase &fc) {
+            run_xi_sort_file(v, fc, gallop);
+        }});
+    }
+    // tie-break policies: key-only records, and argsort applied back to the input
+    e.push_back({"xi_sort/key-only", [](std::vector<double> &v, const FuzzCase &) {
+        XiSortConfig cfg; cfg.tie_break = XI_TIE_VALUE;
+        xi_sort(v.data(), v.size(), cfg);
+    }});
+    static const std::pair<const char*, XiTieBreak> ties[3] = {
+        {"index", XI_TIE_INDEX}, {"value", XI_TIE_VALUE}, {"random", XI_TIE_RANDOM}};
+    for (const auto &t : ties) {
+        const XiTieBreak tie = t.second;
+        e.push_back({std::string("xi_argsort/") + t.first, [tie](std::vector<double> &v, const FuzzCase &fc) {
+            XiSortConfig cfg; cfg.parallel = (fc.buffer_elems & 1) != 0;
+            cfg.tie_break = tie; cfg.seed = fc.run_elems;
+            std::vector<uint64_t> perm(v.size(), UINT64_MAX);
+            xi_argsort(v.data(), v.size(), perm.data(), cfg);
+            std::vector<double> out(v.size());
+            std::vector<char> seen(v.size(), 0);
+            for (std::size_t r = 0; r < v.size(); ++r) {
+                if (perm[r] >= v.size() || seen[perm[r]]++) throw std::runtime_error("not a permutation");
+                out[r] = v[perm[r]];
+                if (tie != XI_TIE_RANDOM && r > 0 && perm[r] < perm[r - 1] &&
+                    double_to_key(out[r]) == double_to_key(out[r - 1]))
+                    throw std::runtime_error("equal keys out of input order");
+            }
+            v.swap(out);
+        }});
+    }
+    // external argsort: the sorted values must be the input gathered by the permutation
+    e.push_back({"xi_argsort_file", [](std::vector<double> &v, const FuzzCase &fc) {
+        {
+            std::ofstream out(FUZZ_IN, std::ios::binary);
+            out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(double));
+        }
+        XiSortConfig cfg;
+        cfg.mem_limit = run_elems(fc) * sizeof(double);
+        cfg.buffer_elems = fc.buffer_elems;
+        xi_argsort_file(FUZZ_IN, FUZZ_PERM, FUZZ_OUT, cfg);
+        std::vector<uint64_t> perm(v.size());
+        std::vector<double> out(v.size());
+        std::ifstream pin(FUZZ_PERM, std::ios::binary), vin(FUZZ_OUT, std::ios::binary);
+        pin.read(reinterpret_cast<char*>(perm.data()), perm.size() * sizeof(uint64_t));
+        vin.read(reinterpret_cast<char*>(out.data()), out.size() * sizeof(double));
+        if (!pin || !vin) throw std::runtime_error("short output file");
+        for (std::size_t r = 0; r < v.size(); ++r) {
+            if (perm[r] >= v.size() || std::memcmp(&out[r], &v[perm[r]], sizeof(double)) != 0)
+                throw std::runtime_error("values do not match the permutation");
+            if (r > 0 && perm[r] < perm[r - 1] && double_to_key(out[r]) == double_to_key(out[r - 1]))
+                throw std::runtime_error("equal keys out of input order");
+        }
+        v.swap(out);
+    }});
+    return e;
+}
+
+static inline bool key_less(double a, double b) {
+    return double_to_key(a) < double_to_key(b);
+}
+
+// true if `eng` reproduces the reference order (an exception counts as a failure)
+static bool engine_agrees(const FuzzEngine &eng, const FuzzCase &fc, std::string *why) {
+    std::vector<double> ref = fc.v;
+    std::stable_sort(ref.begin(), ref.end(), key_less);
+    std::vector<double> got = fc.v;
+    try {
+        eng.run(got, fc);
+    } catch (const std::exception &ex) {
+        if (why) *why = std::string("exception: ") + ex.what();
+        return false;
+    }
+    for (std::size_t i = 0; i < ref.size(); ++i) {
+        if (double_to_key(ref[i]) != double_to_key(got[i])) {
+            if (why) {
+                char buf[96];
+                std::snprintf(buf, sizeof buf, "first difference at %zu: %016llx != %016llx", i,
+                              (unsigned long long)double_to_key(got[i]),
+                              (unsigned long long)double_to_key(ref[i]));
+                *why = buf;
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+// ─── input encoding ──────────────────────────────────────────────────────────
+static FuzzCase decode(const std::uint8_t *data, std::size_t size) {
+    FuzzCase fc;
+    fc.run_elems = 1 + (size > 0 ? data[0] % 16 : 0);
+    fc.buffer_elems = 1 + (size > 1 ? data[1] % 8 : 0);
+    std::size_t n = size > 2 ? (size - 2) / sizeof(double) : 0;
+    fc.v.resize(n);
+    if (n) std::memcpy(fc.v.data(), data + 2, n * sizeof(double));
+    return fc;
+}
+
+static std::vector<std::uint8_t> encode(const FuzzCase &fc) {
+    std::vector<std::uint8_t> bytes(2 + fc.v.size() * sizeof(double));
+    bytes[0] = static_cast<std::uint8_t>(fc.run_elems - 1);
+    bytes[1] = static_cast<std::uint8_t>(fc.buffer_elems - 1);
+    if (!fc.v.empty()) std::memcpy(bytes.data() + 2, fc.v.data(), fc.v.size() * sizeof(double));
+    return bytes;
+}
+
+// ─── minimisation ────────────────────────────────────────────────────────────
+// Greedy ddmin: drop ever smaller chunks while the engine still disagrees, then
+// try to replace each remaining value by a plainer one.
+static FuzzCase minimise(const FuzzEngine &eng, FuzzCase fc) {
+    for (std::size_t chunk = fc.v.size() / 2; chunk >= 1; chunk /= 2) {
+        for (std::size_t i = 0; i + chunk <= fc.v.size();) {
+            FuzzCase trial = fc;
+            trial.v.erase(trial.v.begin() + i, trial.v.begin() + i + chunk);
+            if (!engine_agrees(eng, trial, nullptr)) fc = trial;
+            else i += chunk;
+        }
+    }
+    const double plain[] = {0.0, 1.0, -1.0};
+    for (std::size_t i = 0; i < fc.v.size(); ++i) {
+        for (double p : plain) {
+            if (double_to_key(fc.v[i]) == double_to_key(p)) break;
+            FuzzCase trial = fc;
+            trial.v[i] = p;
+            if (!engine_agrees(eng, trial, nullptr)) { fc = trial; break; }
+        }
+    }
+    for (std::size_t r = 1; r < fc.run_elems; ++r) {
+        FuzzCase trial = fc;  trial.run_elems = r;
+        if (!engine_agrees(eng, trial, nullptr)) { fc = trial; break; }
+    }
+    return fc;
+}
+
+static void report_failure(const FuzzEngine &eng, const FuzzCase &fc, const std::string &why) {
+    std::cerr << "[xisort_fuzz] " << eng.name << " disagrees with std::stable_sort: " << why
+              << "\n[xisort_fuzz] minimising " << fc.v.size() << " elements…\n";
+    FuzzCase m = minimise(eng, fc);
+    std::string path = "xisort_fuzz_fail_" + eng.name + ".bin";
+    std::replace(path.begin(), path.end(), '/', '_');
+    std::vector<std::uint8_t> bytes = encode(m);
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    std::cerr << "[xisort_fuzz] minimal input: " << m.v.size() << " elements, run_elems = "
+              << m.run_elems << ", buffer_elems = " << m.buffer_elems << " → " << path << "\n";
+    for (std::size_t i = 0; i < m.v.size() && i < 64; ++i) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &m.v[i], sizeof bits);
+        std::fprintf(stderr, "  [%2zu] %016llx  %.17g\n", i, (unsigned long long)bits, m.v[i]);
+    }
+}
+
+// Run every selected engine on one case; false on the first disagreement
+static bool check_case(const std::vector<FuzzEngine> &engines, const FuzzCase &fc, bool big) {
+    for (const auto &eng : engines) {
+        // file-backed modes would write thousands of tiny runs for big inputs
+        const bool on_disk = eng.name.find("external") != std::string::npos
+                          || eng.name.find("file") != std::string::npos;
+        if (big && on_disk) continue;
+        std::string why;
+        if (!engine_agrees(eng, fc, &why)) {
+            report_failure(eng, fc, why);
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef XISORT_LIBFUZZER
+// ─── libFuzzer entry point ───────────────────────────────────────────────────
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size) {
+    static const std::vector<FuzzEngine> engines = fuzz_engines();
+    FuzzCase fc = decode(data, size);
+    if (fc.v.size() > 4096) return 0;
+    for (const auto &eng : engines) {
+        std::string why;
+        if (!engine_agrees(eng, fc, &why)) {
+            std::cerr << "[xisort_fuzz] " << eng.name << ": " << why << "\n";
+            std::abort();   // libFuzzer saves and, with -minimize_crash=1, shrinks the input
+        }
+    }
+    return 0;
+}
+#else
+// ─── standalone driver ───────────────────────────────────────────────────────
+static void die(const std::string &msg) {
+    std::cerr << "[xisort_fuzz] " << msg << "\n";
+    std::exit(EXIT_FAILURE);
+}
+
+// Counter-based stream for the driver's own choices
+struct FuzzRng {
+    std::uint64_t seed, ctr;
+    std::uint64_t next() { return xi_gen_mix(seed, ctr++); }
+    std::size_t below(std::size_t k) { return k ? static_cast<std::size_t>(next() % k) : 0; }
+};
+
+// Values that stress the total order: NaN payloads of both signs and both kinds,
+// ±0, ±inf, subnormal and normal extremes, plus neighbours of 0 and 1
+static double special_value(FuzzRng &rng) {
+    static const std::uint64_t bits[] = {
+        0x0000000000000000ULL, 0x8000000000000000ULL,   // ±0
+        0x0000000000000001ULL, 0x8000000000000001ULL,   // ±min subnormal
+        0x000FFFFFFFFFFFFFULL, 0x800FFFFFFFFFFFFFULL,   // ±max subnormal
+        0x0010000000000000ULL, 0x8010000000000000ULL,   // ±min normal
+        0x7FEFFFFFFFFFFFFFULL, 0xFFEFFFFFFFFFFFFFULL,   // ±max
+        0x7FF0000000000000ULL, 0xFFF0000000000000ULL,   // ±inf
+        0x7FF8000000000000ULL, 0xFFF8000000000000ULL,   // ±qNaN
+        0x7FF0000000000001ULL, 0xFFF0000000000001ULL,   // ±sNaN, smallest payload
+        0x7FFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL,   // ±NaN, largest payload
+        0x3FF0000000000000ULL, 0x3FEFFFFFFFFFFFFFULL    // 1 and its predecessor
+    };
+    const std::size_t k = sizeof(bits) / sizeof(bits[0]);
+    std::uint64_t b = bits[rng.below(k)];
+    if ((b & 0x7FF0000000000000ULL) == 0x7FF0000000000000ULL && (b & 0x000FFFFFFFFFFFFFULL) && rng.below(2))
+        b = (b & 0xFFF8000000000000ULL) | (rng.next() & 0x0007FFFFFFFFFFFFULL) | 1;   // random payload
+    double d;
+    std::memcpy(&d, &b, sizeof d);
+    return d;
+}
+
+static FuzzCase random_case(FuzzRng &rng, std::size_t max_n, bool big) {
+    FuzzCase fc;
+    fc.run_elems = 1 + rng.below(16);
+    fc.buffer_elems = 1 + rng.below(8);
+    std::size_t n = big ? max_n / 2 + rng.below(max_n / 2 + 1)
+                        : (rng.below(4) == 0 ? rng.below(9) : rng.below(max_n + 1));
+    fc.v.resize(n);
+    XiGenDist dist = static_cast<XiGenDist>(rng.below(XI_GEN_COUNT));
+    xi_gen_fill(dist, rng.next(), fc.v);
+    // mutations: specials, copied blocks (duplicates / presorted stretches), reversals
+    std::size_t muts = n ? rng.below(1 + n / 8) : 0;
+    for (std::size_t m = 0; m < muts; ++m) {
+        std::size_t i = rng.below(n);
+        switch (rng.below(4)) {
+            case 0: case 1: fc.v[i] = special_value(rng); break;
+            case 2: {
+                std::size_t len = 1 + rng.below(n - i), j = rng.below(n - len + 1);
+                std::copy(fc.v.begin() + i, fc.v.begin() + i + len, fc.v.begin() + j);
+                break;
+            }
+            default: {
+                std::size_t len = 1 + rng.below(n - i);
+                std::reverse(fc.v.begin() + i, fc.v.begin() + i + len);
+                break;
+            }
+        }
+    }
+    return fc;
+}
+
+int main(int argc, char **argv)
+{
+    std::uint64_t iters = 2000, seed = 1;
+    double seconds = 0.0;
+    std::size_t max_n = 2048;
+    std::string engine_filter, replay;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg.rfind("--iters=", 0) == 0) iters = std::stoull(arg.substr(8));
+        else if (arg.rfind("--seconds=", 0) == 0) seconds = std::stod(arg.substr(10));
+        else if (arg.rfind("--seed=", 0) == 0) seed = std::stoull(arg.substr(7));
+        else if (arg.rfind("--max-n=", 0) == 0) max_n = std::stoull(arg.substr(8));
+        else if (arg.rfind("--engine=", 0) == 0) engine_filter = arg.substr(9);
+        else if (arg.rfind("--replay=", 0) == 0) replay = arg.substr(9);
+        else die("unknown option " + arg);
+    }
+
+    std::vector<FuzzEngine> engines;
+    for (auto &e : fuzz_engines())
+        if (engine_filter.empty() || e.name == engine_filter) engines.push_back(e);
+    if (engines.empty()) die("no engine named " + engine_filter);
+
+    bool ok = true;
+    if (!replay.empty()) {
+        std::ifstream in(replay, std::ios::binary);
+        if (!in) die("cannot open " + replay);
+        std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        ok = check_case(engines, decode(bytes.data(), bytes.size()), false);
+    } else {
+        std::cout << "===== XiSort differential fuzzer =====\n"
+                  << engines.size() << " engines, seed " << seed << ", max_n " << max_n << "\n";
+        FuzzRng rng{seed, 0};
+        auto t0 = Clock::now();
+        std::uint64_t it = 0, elems = 0;
+        for (; ok; ++it) {
+            double el = std::chrono::duration<double>(Clock::now() - t0).count();
+            if (seconds > 0.0 ? el >= seconds : it >= iters) break;
+            // every 64th case is large enough for the OpenMP task split
+            const bool big = (it % 64) == 63;
+            FuzzCase fc = random_case(rng, big ? std::max<std::size_t>(max_n, 1 << 17) : max_n, big);
+            elems += fc.v.size();
+            ok = check_case(engines, fc, big);
+        }
+        std::cout << it << " cases, " << elems << " elements in "
+                  << std::chrono::duration<double>(Clock::now() - t0).count() << " s\n";
+    }
+    std::filesystem::remove(FUZZ_IN);
+    std::filesystem::remove(FUZZ_OUT);
+    std::filesystem::remove(FUZZ_PERM);
+    std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#endif
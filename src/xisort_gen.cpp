@@ -0,0 +1,228 @@
+// xisort_gen.cpp  — Reproducible input generators for XiSort tests and benchmarks
+// AUTHOR: Faruk Alpay  •  ORCID: 0009-0009-2207-6528
+// -----------------------------------------------------------------------------
+// Every element is a pure function of (distribution, seed, n, index): a
+// counter-based splitmix64 stream replaces the serial mt19937 loops, so any
+// slice of a dataset can be generated independently, in parallel, and is
+// bit-identical whatever the thread count or block size. Like xisort.cpp this
+// file is #included by the front-ends (xisort_gen_cli.cpp, the test suite and
+// the benchmark harness); it does not depend on the sorter itself.
+//
+// Distributions (xi_gen_parse / xi_gen_name):
+//   uniform      U(-1, 1)
+//   normal       N(0, 1) via Box–Muller
+//   dups         Test-1 shape: ten distinct values
+//   allequal     a single repeated value
+//   sorted       ascending ramp over (-1, 1)
+//   reverse      descending ramp
+//   nearly       ascending ramp with 1 % uniform outliers
+//   sawtooth     ascending runs of 1024
+//   organpipe    ascending first half, descending second half
+//   ieee         normal values salted with ±0, ±inf and ±NaN
+//   nan          NaNs only: both signs, quiet and signalling, random payloads
+//   zeros        +0 / -0 mixed with the smallest subnormals of both signs
+//   subnormal    random subnormals of both signs
+//   bits         uniformly random 64-bit patterns (every IEEE class)
+//   m3killer     Musser's median-of-3 killer for quicksort-based engines
+//   gallopkiller merge order that alternates 8-element stretches at every
+//                level of a power-of-two mergesort: each merge enters gallop
+//                mode and immediately falls out of it
+// -----------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+enum XiGenDist {
+    XI_GEN_UNIFORM, XI_GEN_NORMAL, XI_GEN_DUPS, XI_GEN_ALLEQUAL, XI_GEN_SORTED,
+    XI_GEN_REVERSE, XI_GEN_NEARLY, XI_GEN_SAWTOOTH, XI_GEN_ORGANPIPE, XI_GEN_IEEE,
+    XI_GEN_NAN, XI_GEN_ZEROS, XI_GEN_SUBNORMAL, XI_GEN_BITS, XI_GEN_M3KILLER,
+    XI_GEN_GALLOPKILLER, XI_GEN_COUNT
+};
+
+static const char *const xiGenNames[XI_GEN_COUNT] = {
+    "uniform", "normal", "dups", "allequal", "sorted",
+    "reverse", "nearly", "sawtooth", "organpipe", "ieee",
+    "nan", "zeros", "subnormal", "bits", "m3killer",
+    "gallopkiller"
+};
+
+static inline const char *xi_gen_name(XiGenDist d) {
+    return (d >= 0 && d < XI_GEN_COUNT) ? xiGenNames[d] : "?";
+}
+
+static inline bool xi_gen_parse(const std::string &name, XiGenDist &d) {
+    for(int i = 0; i < XI_GEN_COUNT; ++i) {
+        if(name == xiGenNames[i]) {
+            d = (XiGenDist)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// splitmix64 output for counter `i` of stream `seed`
+static inline uint64_t xi_gen_mix(uint64_t seed, uint64_t i) {
+    uint64_t x = seed + (i + 1) * 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static inline double xi_gen_bits(uint64_t u) {
+    double d;
+    std::memcpy(&d, &u, sizeof d);
+    return d;
+}
+
+// [0, 1) with 53 random bits
+static inline double xi_gen_unit(uint64_t x) {
+    return (double)(x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Element i of an ascending ramp over (-1, 1)
+static inline double xi_gen_ramp(uint64_t n, uint64_t i) {
+    return -1.0 + 2.0 * ((double)i + 0.5) / (double)n;
+}
+
+static inline uint64_t xi_gen_bitrev(uint64_t x, int bits) {
+    uint64_t r = 0;
+    for(int b = 0; b < bits; ++b) {
+        r = (r << 1) | ((x >> b) & 1);
+    }
+    return r;
+}
+
+// Element `i` of the dataset (dist, seed, n)
+static inline double xi_gen_value(XiGenDist dist, uint64_t seed, uint64_t n, uint64_t i) {
+    // distinct sub-streams per element so Box–Muller & co. never share counters
+    const uint64_t r0 = xi_gen_mix(seed, 2 * i);
+    switch(dist) {
+    case XI_GEN_UNIFORM:
+        return -1.0 + 2.0 * xi_gen_unit(r0);
+    case XI_GEN_NORMAL: {
+        const uint64_t r1 = xi_gen_mix(seed, 2 * i + 1);
+        double u1 = 1.0 - xi_gen_unit(r0);          // (0, 1]
+        double u2 = xi_gen_unit(r1);
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+    case XI_GEN_DUPS: {
+        int b = (int)(r0 % 10);
+        return (b == 0) ? 0.123456789 : (double)b;
+    }
+    case XI_GEN_ALLEQUAL:
+        return 0.5;
+    case XI_GEN_SORTED:
+        return xi_gen_ramp(n, i);
+    case XI_GEN_REVERSE:
+        return xi_gen_ramp(n, n - 1 - i);
+    case XI_GEN_NEARLY:
+        return (r0 % 100 == 0) ? -1.0 + 2.0 * xi_gen_unit(xi_gen_mix(seed, 2 * i + 1))
+                               : xi_gen_ramp(n, i);
+    case XI_GEN_SAWTOOTH:
+        return (double)(i % 1024);
+    case XI_GEN_ORGANPIPE:
+        return (double)((i < n / 2) ? i : n - 1 - i);
+    case XI_GEN_IEEE: {
+        static const double specials[6] = {
+            0.0, -0.0,
+            std::numeric_limits<double>::infinity(),
+            -std::numeric_limits<double>::infinity(),
+            std::numeric_limits<double>::quiet_NaN(),
+            -std::numeric_limits<double>::quiet_NaN()
+        };
+        int p = (int)(r0 % 16);
+        return (p < 6) ? specials[p] : xi_gen_value(XI_GEN_NORMAL, seed, n, i);
+    }
+    case XI_GEN_NAN: {
+        // exponent all ones, non-zero 52-bit payload (bit 51 set = quiet)
+        uint64_t payload = (r0 >> 12) & 0x000FFFFFFFFFFFFFULL;
+        if(payload == 0) payload = 1;
+        return xi_gen_bits((r0 & 0x8000000000000000ULL) | 0x7FF0000000000000ULL | payload);
+    }
+    case XI_GEN_ZEROS: {
+        // ±0 half of the time, otherwise ±(1..4) ulps away from zero
+        uint64_t ulps = (r0 >> 8) & 7;
+        return xi_gen_bits((r0 & 0x8000000000000000ULL) | (ulps > 4 ? 0 : ulps));
+    }
+    case XI_GEN_SUBNORMAL: {
+        uint64_t mant = (r0 >> 12) & 0x000FFFFFFFFFFFFFULL;
+        if(mant == 0) mant = 1;
+        return xi_gen_bits((r0 & 0x8000000000000000ULL) | mant);
+    }
+    case XI_GEN_BITS:
+        return xi_gen_bits(r0);
+    case XI_GEN_M3KILLER: {
+        // Musser (1997): for n = 2k, a[i-1] = i (i odd) or k + i - 1 (i even) and
+        // a[k+i-1] = 2i, for i = 1..k; an odd trailing element gets n
+        const uint64_t k = n / 2;
+        if(i >= 2 * k) return (double)n;
+        if(i < k) {
+            uint64_t j = i + 1;
+            return (double)((j & 1) ? j : k + j - 1);
+        }
+        return (double)(2 * (i - k + 1));
+    }
+    case XI_GEN_GALLOPKILLER: {
+        // position p holds rank r with p = bitrev(r >> 3) << 3 | (r & 7) inside the
+        // largest power-of-two prefix: every merge of two halves takes 8 from one
+        // side, then 8 from the other; the tail is uniform noise above the prefix
+        int bits = 0;
+        while(bits < 63 && ((uint64_t)2 << bits) <= n) ++bits;
+        const uint64_t pow2 = (n == 0) ? 0 : ((uint64_t)1 << bits);
+        if(i >= pow2 || bits < 3) return (double)pow2 + xi_gen_unit(r0);
+        const uint64_t r = (xi_gen_bitrev(i >> 3, bits - 3) << 3) | (i & 7);
+        return (double)r;
+    }
+    default:
+        return 0.0;
+    }
+}
+
+// Fill out[0..count) with elements [first, first + count) of the dataset
+static inline void xi_gen_fill(XiGenDist dist, uint64_t seed, uint64_t n, uint64_t first,
+                               double *out, std::size_t count) {
+    const long long cnt = (long long)count;
+    #pragma omp parallel for schedule(static) if(cnt >= (1LL << 16))
+    for(long long j = 0; j < cnt; ++j) {
+        out[j] = xi_gen_value(dist, seed, n, first + (uint64_t)j);
+    }
+}
+
+static inline void xi_gen_fill(XiGenDist dist, uint64_t seed, std::vector<double> &v) {
+    xi_gen_fill(dist, seed, v.size(), 0, v.data(), v.size());
+}
+
+// Write an n-element dataset to `path`. Blocks are generated in parallel while the
+// previous block is written by a second thread. Throws std::runtime_error.
+static inline void xi_gen_file(const std::string &path, XiGenDist dist, uint64_t seed, uint64_t n) {
+    std::ofstream out(path, std::ios::binary);
+    if(!out) throw std::runtime_error("cannot create " + path);
+    const std::size_t BLOCK = 1 << 20;
+    std::vector<double> buf[2] = {std::vector<double>(BLOCK), std::vector<double>(BLOCK)};
+    std::thread writer;
+    bool ok = true;
+    uint64_t done = 0;
+    for(int cur = 0; done < n; cur ^= 1) {
+        std::size_t cnt = (n - done < BLOCK) ? (std::size_t)(n - done) : BLOCK;
+        xi_gen_fill(dist, seed, n, done, buf[cur].data(), cnt);
+        if(writer.joinable()) writer.join();
+        writer = std::thread([&out, &ok, &buf, cur, cnt]() {
+            out.write(reinterpret_cast<const char*>(buf[cur].data()), (std::streamsize)(cnt * sizeof(double)));
+            ok = ok && (bool)out;
+        });
+        done += cnt;
+    }
+    if(writer.joinable()) writer.join();
+    out.close();
+    if(!ok || !out) throw std::runtime_error("short write on " + path);
+}
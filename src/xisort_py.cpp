@@ -3,24 +3,58 @@
 #include <cstdint>
 #include <cstddef>
 #include <stdexcept>
+#include <string>
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
 namespace py = pybind11;
 // Forward declarations for XiSort
+enum XiTieBreak { XI_TIE_INDEX, XI_TIE_VALUE, XI_TIE_RANDOM, XI_TIE_SHUFFLE };
+enum XiMode { XI_MODE_STRICT, XI_MODE_CURVED };
 struct XiSortConfig {
     bool external;
     bool trace;
     bool parallel;
     std::size_t mem_limit;
     std::size_t buffer_elems;
+    bool gallop;
+    bool events;
+    XiTieBreak tie_break;
+    uint64_t seed;
+    XiMode mode;
+    double epsilon;
+    void* cancel;
+    double timeout_ms;
+    std::size_t index_stride;
+    std::string scratch_dir;
 };
 void xi_sort(double* data, uint64_t n, const XiSortConfig& cfg);
+void xi_argsort(const double* data, uint64_t n, uint64_t* perm, const XiSortConfig& cfg);
+void xi_write_trace_events(const std::string& path);
+static XiTieBreak parse_tie_break(const std::string& name) {
+    if(name == "index") return XI_TIE_INDEX;
+    if(name == "value") return XI_TIE_VALUE;
+    if(name == "random") return XI_TIE_RANDOM;
+    if(name == "shuffle") return XI_TIE_SHUFFLE;
+    throw std::runtime_error("unknown tie_break " + name);
+}
+static XiMode parse_mode(const std::string& name) {
+    if(name == "strict") return XI_MODE_STRICT;
+    if(name == "curved") return XI_MODE_CURVED;
+    throw std::runtime_error("unknown mode " + name);
+}
 // Python wrapper function for xi_sort
 py::array_t<double> xi_sort_py(py::array_t<double> arr,
                                bool external=false, bool trace=false,
                                bool parallel=false,
                                std::size_t mem_limit=SIZE_MAX,
-                               std::size_t buffer_elems=(1ULL<<15)) {
+                               std::size_t buffer_elems=(1ULL<<15),
+                               bool gallop=true,
+                               const std::string& trace_events="",
+                               const std::string& tie_break="index",
+                               uint64_t seed=0,
+                               const std::string& mode="strict",
+                               double epsilon=0.01,
+                               double timeout_ms=0.0) {
     // Extract raw pointer to NumPy array data (C++ double*)
     auto buf = arr.request();
     if(buf.ndim != 1) {
@@ -38,16 +72,69 @@ py::array_t<double> xi_sort_py(py::array_t<double> arr,
     cfg.parallel = parallel;
     cfg.mem_limit = mem_limit;
     cfg.buffer_elems = buffer_elems;
+    cfg.gallop = gallop;
+    cfg.events = !trace_events.empty();
+    cfg.tie_break = parse_tie_break(tie_break);
+    cfg.seed = seed;
+    cfg.mode = parse_mode(mode);
+    cfg.epsilon = epsilon;
+    cfg.cancel = nullptr;
+    cfg.timeout_ms = timeout_ms;
+    cfg.index_stride = 0;
     //xi_sort to perform in-place sorting
     xi_sort(data, n, cfg);
+    if(cfg.events) {
+        xi_write_trace_events(trace_events);
+    }
     // Return the sorted array (same object as input)
     return arr;
 }
+// Python wrapper for xi_argsort: returns the permutation as a new uint64 array
+py::array_t<uint64_t> xi_argsort_py(py::array_t<double, py::array::c_style | py::array::forcecast> arr,
+                                    bool parallel=false,
+                                    const std::string& tie_break="index",
+                                    uint64_t seed=0,
+                                    const std::string& mode="strict",
+                                    double epsilon=0.01,
+                                    double timeout_ms=0.0) {
+    auto buf = arr.request();
+    if(buf.ndim != 1) {
+        throw std::runtime_error("xi_argsort_py: Only 1-dimensional arrays are supported");
+    }
+    uint64_t n = static_cast<uint64_t>(buf.shape[0]);
+    py::array_t<uint64_t> perm(buf.shape[0]);
+    XiSortConfig cfg;
+    cfg.external = false;
+    cfg.trace = false;
+    cfg.parallel = parallel;
+    cfg.mem_limit = SIZE_MAX;
+    cfg.buffer_elems = (1ULL<<15);
+    cfg.gallop = true;
+    cfg.events = false;
+    cfg.tie_break = parse_tie_break(tie_break);
+    cfg.seed = seed;
+    cfg.mode = parse_mode(mode);
+    cfg.epsilon = epsilon;
+    cfg.cancel = nullptr;
+    cfg.timeout_ms = timeout_ms;
+    cfg.index_stride = 0;
+    xi_argsort(static_cast<const double*>(buf.ptr), n,
+               static_cast<uint64_t*>(perm.request().ptr), cfg);
+    return perm;
+}
 // pybind11 module definition
 PYBIND11_MODULE(xisort, m) {
     m.doc() = "XiSort Python binding";
     m.def("xi_sort_py", &xi_sort_py,
           py::arg("arr"), py::arg("external")=false, py::arg("trace")=false,
           py::arg("parallel")=false, py::arg("mem_limit")=SIZE_MAX,
-          py::arg("buffer_elems")=(1ULL<<15));
+          py::arg("buffer_elems")=(1ULL<<15), py::arg("gallop")=true,
+          py::arg("trace_events")="", py::arg("tie_break")="index",
+          py::arg("seed")=0, py::arg("mode")="strict", py::arg("epsilon")=0.01,
+          py::arg("timeout_ms")=0.0);
+    m.def("xi_argsort_py", &xi_argsort_py,
+          py::arg("arr"), py::arg("parallel")=false,
+          py::arg("tie_break")="index", py::arg("seed")=0,
+          py::arg("mode")="strict", py::arg("epsilon")=0.01,
+          py::arg("timeout_ms")=0.0);
 }
@@ -4,10 +4,19 @@
 #include <random>
 #include <chrono>
 #include <fstream>
+#include <iterator>
+#include <map>
 #include <iostream>
 #include <vector>
 #include <filesystem>
+#include <functional>
+#include <thread>
 #include "xisort.cpp"                 // ← Sorter implementation
+#include "xisort_gen.cpp"             // ← reproducible input generators
+#include "xisort_dist.cpp"            // ← distributed coordinator / worker (POSIX)
+#ifdef XISORT_HAVE_DIST
+#include <sys/wait.h>
+#endif
 
 // ─── helpers ─────────────────────────────────────────────────────────
 static inline bool is_sorted_total(const std::vector<double>& v)
@@ -38,11 +47,32 @@ static double elapsed_ms(const std::chrono::steady_clock::time_point& t0)
         .count();
 }
 
+// Runs a traced call twice: both runs must report the same non-zero Φ(χ), with one
+// phi_runs entry per run, and a traced in-memory sort afterwards must not pick up
+// anything the call left behind
+static bool trace_repeats(const std::function<void()>& call)
+{
+    std::vector<double> probe(4096), w;
+    xi_gen_fill(XI_GEN_UNIFORM, 3, probe);
+    XiSortConfig pcfg;   pcfg.trace = true;
+    w = probe;
+    xi_sort(w.data(), w.size(), pcfg);
+    const long long probe_segs = xi_sort_stats().curv_segments;
+    call();
+    const XiSortStats a = xi_sort_stats();
+    call();
+    const XiSortStats b = xi_sort_stats();
+    w = probe;
+    xi_sort(w.data(), w.size(), pcfg);
+    return a.curv_segments > 0 && a.curv_segments == b.curv_segments
+        && std::fabs(a.phi - b.phi) <= 1e-9 * a.phi && a.phi_runs.size() == a.runs
+        && xi_sort_stats().curv_segments == probe_segs;
+}
+
 // ─── constants ───────────────────────────────────────────────────────
 constexpr std::size_t   INMEM_COUNT_BIG   = 100'000'000;     // ~0.8 GB
 constexpr std::size_t   INMEM_COUNT_SMALL = 10'000'000;      // ~80 MB
 constexpr std::uint64_t EXTERNAL_SIZE_GB  = 100;             // 100 GB file
-constexpr std::size_t   BUFFER_ELEMS      = 1ULL << 15;      // 32 768 doubles
 
 // ─── main ────────────────────────────────────────────────────────────
 int main(int argc, char** argv)
@@ -66,6 +96,64 @@ int main(int argc, char** argv)
         std::cout << (is_sorted_total(v) ? "status: OK\n" : "status: FAIL\n");
     }
 
+    // ── Test-0b : Φ(χ) profile per merge level ──────────────────────
+    {
+        std::cout << "\n[Test-0b] Φ(χ) curvature profile\n";
+        // Sorted input: every merge takes its whole left half, then its whole right
+        // half, so level L holds 2 segments per merge of mean length 2^(L-1).
+        const std::size_t N = 1 << 16;
+        std::vector<double> v(N);
+        for (std::size_t i = 0; i < N; ++i) v[i] = static_cast<double>(i);
+        XiSortConfig cfg;   cfg.trace = true;   cfg.parallel = true;
+        xi_sort(v.data(), static_cast<uint64_t>(v.size()), cfg);
+        XiSortStats st = xi_sort_stats();
+        bool ok = st.curv_segments == 2 * static_cast<long long>(N - 1);
+        double phi_sum = 0.0;
+        for (std::size_t l = 1; l < st.phi_levels.size(); ++l) {
+            const XiPhiBin &b = st.phi_levels[l];
+            phi_sum += b.phi;
+            ok = ok && b.elements == static_cast<long long>(N)
+                    && b.elements == b.segments * (1LL << (l - 1));
+        }
+        ok = ok && st.phi_levels.size() == 17 && std::fabs(phi_sum - st.phi) < 1e-6 * st.phi;
+        std::cout << "Φ = " << st.phi << " over " << st.curv_segments << " segments, "
+                  << st.phi_levels.size() - 1 << " levels\n";
+        std::cout << (ok && is_sorted_total(v) ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-0c : edge-case and adversarial generators ──────────────
+    {
+        std::cout << "\n[Test-0c] generator distributions (serial, parallel, external)\n";
+        // Each dataset must be reproducible slice-by-slice and sort identically
+        // on every engine (the external one with tiny runs and buffers).
+        const std::size_t N = 1 << 16;
+        bool ok = true;
+        for (int d = 0; d < XI_GEN_COUNT; ++d) {
+            const XiGenDist dist = static_cast<XiGenDist>(d);
+            std::vector<double> v(N), part(N);
+            xi_gen_fill(dist, 9, v);
+            xi_gen_fill(dist, 9, N, N / 3, part.data() + N / 3, N - N / 3);
+            bool repro = std::memcmp(v.data() + N / 3, part.data() + N / 3,
+                                     (N - N / 3) * sizeof(double)) == 0;
+            std::vector<double> ref = v, par = v, ext = v;
+            XiSortConfig cfg;
+            xi_sort(ref.data(), N, cfg);
+            cfg.parallel = true;
+            xi_sort(par.data(), N, cfg);
+            cfg.parallel = false;   cfg.external = true;
+            cfg.mem_limit = 4096 * sizeof(double);   cfg.buffer_elems = 64;
+            xi_sort(ext.data(), N, cfg);
+            bool same = std::memcmp(ref.data(), par.data(), N * sizeof(double)) == 0
+                     && std::memcmp(ref.data(), ext.data(), N * sizeof(double)) == 0;
+            if (!(repro && same && is_sorted_total(ref))) {
+                std::cout << "  " << xi_gen_name(dist) << ": mismatch\n";
+                ok = false;
+            }
+        }
+        std::cout << XI_GEN_COUNT << " distributions checked\n";
+        std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    }
+
     // ── Test-1 : duplicate-heavy vector ─────────────────────────────
     {
         std::cout << "\n[Test-1] duplicate-heavy distribution\n";
@@ -84,6 +172,258 @@ int main(int argc, char** argv)
         std::cout << (is_sorted_total(v) ? "status: OK\n" : "status: FAIL\n");
     }
 
+    // ── Test-1b : galloping merge on clustered data ─────────────────
+    {
+        std::cout << "\n[Test-1b] galloping merge vs element-wise merge\n";
+        // interleaved ascending blocks of random length: long one-sided stretches
+        const std::size_t N = small ? 2'000'000 : 20'000'000;
+        std::vector<double> v(N);
+        std::mt19937_64 rng(11);
+        std::size_t i = 0;
+        while (i < N) {
+            std::size_t len = 1 + rng() % 4096;
+            double base = static_cast<double>(rng() % 1000);
+            for (std::size_t t = 0; t < len && i < N; ++t, ++i) v[i] = base + t * 1e-3;
+        }
+        std::vector<double> plain = v;
+        XiSortConfig cfg;   cfg.trace = true;   cfg.gallop = false;
+        auto t0 = std::chrono::steady_clock::now();
+        xi_sort(plain.data(), static_cast<uint64_t>(plain.size()), cfg);
+        double ms_plain = elapsed_ms(t0);
+        double phi_plain = xi_sort_stats().phi;
+        cfg.gallop = true;
+        t0 = std::chrono::steady_clock::now();
+        xi_sort(v.data(), static_cast<uint64_t>(v.size()), cfg);
+        double ms_gallop = elapsed_ms(t0);
+        double phi_gallop = xi_sort_stats().phi;
+        std::cout << "time: " << ms_gallop << " ms galloping, " << ms_plain << " ms element-wise\n";
+        bool ok = std::memcmp(v.data(), plain.data(), N * sizeof(double)) == 0
+               && std::fabs(phi_gallop - phi_plain) <= 1e-9 * phi_plain;
+        std::cout << (ok && is_sorted_total(v) ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-1c : tie-break policies (argsort, key-only) ────────────
+    {
+        std::cout << "\n[Test-1c] tie-break policies\n";
+        const std::size_t N = small ? 1'000'000 : 10'000'000;
+        std::vector<double> v(N);
+        xi_gen_fill(XI_GEN_DUPS, 42, v);
+        auto argsort = [&](XiTieBreak tie, uint64_t seed, bool parallel) {
+            XiSortConfig cfg;   cfg.tie_break = tie;   cfg.seed = seed;   cfg.parallel = parallel;
+            std::vector<uint64_t> perm(N);
+            xi_argsort(v.data(), N, perm.data(), cfg);
+            return perm;
+        };
+        // INDEX: equal keys keep input order
+        std::vector<uint64_t> p = argsort(XI_TIE_INDEX, 0, true);
+        bool ok = true;
+        for (std::size_t r = 1; r < N && ok; ++r)
+            ok = double_to_key(v[p[r-1]]) < double_to_key(v[p[r]])
+              || (double_to_key(v[p[r-1]]) == double_to_key(v[p[r]]) && p[r-1] < p[r]);
+        // RANDOM: same seed → same order on any thread count, new seed → new order
+        std::vector<uint64_t> r1 = argsort(XI_TIE_RANDOM, 7, false);
+        ok = ok && r1 == argsort(XI_TIE_RANDOM, 7, true)
+                && r1 != argsort(XI_TIE_RANDOM, 8, false) && r1 != p;
+        for (std::size_t r = 1; r < N && ok; ++r)
+            ok = double_to_key(v[r1[r-1]]) <= double_to_key(v[r1[r]]);
+        // VALUE: key-only records give the same bits as the default
+        std::vector<double> keyed = v, indexed = v;
+        XiSortConfig cfg;   cfg.tie_break = XI_TIE_VALUE;
+        auto t0 = std::chrono::steady_clock::now();
+        xi_sort(keyed.data(), N, cfg);
+        double ms_keyed = elapsed_ms(t0);
+        cfg.tie_break = XI_TIE_INDEX;
+        t0 = std::chrono::steady_clock::now();
+        xi_sort(indexed.data(), N, cfg);
+        double ms_indexed = elapsed_ms(t0);
+        std::cout << "time: " << ms_keyed << " ms key-only, " << ms_indexed << " ms index ties\n";
+        ok = ok && std::memcmp(keyed.data(), indexed.data(), N * sizeof(double)) == 0;
+        std::cout << (ok && is_sorted_total(keyed) ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-1d : CURVED metric (in-memory, external, file) ─────────
+    {
+        std::cout << "\n[Test-1d] CURVED mode\n";
+        // polynomial cosine against libm
+        double cos_err = 0.0;
+        for (int i = 0; i <= 1'000'000; ++i) {
+            double t = i / 1'000'000.0;
+            cos_err = std::max(cos_err, std::fabs(xi_cospi(t) - std::cos(3.141592653589793 * t)));
+        }
+        std::cout << "max |cospi error|: " << cos_err << '\n';
+        bool ok = cos_err < 1e-15;
+        // the metric is strictly increasing, so for well-separated values CURVED
+        // must reproduce the STRICT order, non-finite values included
+        const std::size_t N = small ? 1'000'000 : 10'000'000;
+        std::vector<double> v(N);
+        xi_gen_fill(XI_GEN_UNIFORM, 5, v);
+        for (std::size_t i = 0; i < N; i += 997) v[i] *= 1e3;
+        const double inf = std::numeric_limits<double>::infinity();
+        v[3] = inf;   v[N/2] = -inf;   v[N-2] = std::nan("7");   v[N/3] = -std::nan("");
+        std::vector<double> strict = v;
+        XiSortConfig cfg;   cfg.parallel = true;
+        xi_sort(strict.data(), N, cfg);
+        cfg.mode = XI_MODE_CURVED;
+        std::vector<double> curved = v;
+        auto t0 = std::chrono::steady_clock::now();
+        xi_sort(curved.data(), N, cfg);
+        std::cout << "time: " << elapsed_ms(t0) << " ms (parallel, in memory)\n";
+        ok = ok && std::memcmp(curved.data(), strict.data(), N * sizeof(double)) == 0;
+        // external paths use the same pre-scanned normalisation
+        std::vector<double> ext = v;
+        XiSortConfig ecfg;   ecfg.mode = XI_MODE_CURVED;   ecfg.external = true;
+        ecfg.mem_limit = (N / 5) * sizeof(double);
+        xi_sort(ext.data(), N, ecfg);
+        ok = ok && std::memcmp(ext.data(), strict.data(), N * sizeof(double)) == 0;
+        {
+            std::ofstream f("xisort_curved_in.bin", std::ios::binary);
+            f.write(reinterpret_cast<const char*>(v.data()), N * sizeof(double));
+        }
+        ecfg.external = false;
+        xi_sort_file("xisort_curved_in.bin", "xisort_curved_out.bin", ecfg);
+        std::vector<double> file_out(N);
+        {
+            std::ifstream f("xisort_curved_out.bin", std::ios::binary);
+            f.read(reinterpret_cast<char*>(file_out.data()), N * sizeof(double));
+        }
+        std::filesystem::remove("xisort_curved_in.bin");
+        std::filesystem::remove("xisort_curved_out.bin");
+        ok = ok && std::memcmp(file_out.data(), ext.data(), N * sizeof(double)) == 0;
+        // ±0 share a metric value: the tie-break decides, not the sign bit
+        std::vector<double> z = {0.0, 1.0, -0.0};
+        xi_sort(z.data(), z.size(), cfg);
+        ok = ok && !std::signbit(z[0]) && std::signbit(z[1]);
+        bool threw = false;
+        try {
+            cfg.epsilon = 0.5;
+            xi_sort(z.data(), z.size(), cfg);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        std::cout << (ok && threw ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-1e : non-finite tail (NaN-heavy feed) ──────────────────
+    {
+        std::cout << "\n[Test-1e] NaN/±inf tail split\n";
+        const std::size_t N = small ? 1'000'000 : 10'000'000;
+        std::vector<double> v(N);
+        xi_gen_fill(XI_GEN_NORMAL, 9, v);
+        const double inf = std::numeric_limits<double>::infinity();
+        std::size_t nonfinite = 0;
+        for (std::size_t i = 0; i < N; ++i) {
+            const uint64_t r = xi_gen_mix(99, i) % 100;
+            if (r < 30) v[i] = (r < 27) ? std::nan("") : (r < 28) ? -std::nan("1") : (r < 29) ? inf : -inf;
+            nonfinite += (r < 30);
+        }
+        std::vector<double> ref = v;
+        std::sort(ref.begin(), ref.end(), [](double a, double b) { return double_to_key(a) < double_to_key(b); });
+        auto same = [&](const std::vector<double>& x, const std::vector<double>& y) {
+            return std::memcmp(x.data(), y.data(), x.size() * sizeof(double)) == 0;
+        };
+        std::vector<double> mem = v;
+        XiSortConfig cfg;   cfg.parallel = true;
+        auto t0 = std::chrono::steady_clock::now();
+        xi_sort(mem.data(), N, cfg);
+        std::cout << "time: " << elapsed_ms(t0) << " ms with 30 % non-finite\n";
+        bool ok = same(mem, ref) && xi_sort_stats().tail_elems == nonfinite;
+        std::vector<double> ext = v;
+        XiSortConfig ecfg;   ecfg.external = true;   ecfg.mem_limit = (N / 6) * sizeof(double);
+        xi_sort(ext.data(), N, ecfg);
+        ok = ok && same(ext, ref);
+        // xi_sort_file: canonical NaNs stay in the count map; distinct payloads
+        // overflow it and fall back to an ordinary run
+        auto file_sort = [&](std::vector<double> in, std::size_t mem_limit) {
+            {
+                std::ofstream f("xisort_tail_in.bin", std::ios::binary);
+                f.write(reinterpret_cast<const char*>(in.data()), in.size() * sizeof(double));
+            }
+            XiSortConfig fcfg;   fcfg.mem_limit = mem_limit;   fcfg.buffer_elems = 4096;
+            xi_sort_file("xisort_tail_in.bin", "xisort_tail_out.bin", fcfg);
+            std::ifstream f("xisort_tail_out.bin", std::ios::binary);
+            f.read(reinterpret_cast<char*>(in.data()), in.size() * sizeof(double));
+            std::filesystem::remove("xisort_tail_in.bin");
+            std::filesystem::remove("xisort_tail_out.bin");
+            return in;
+        };
+        ok = ok && same(file_sort(v, (N / 6) * sizeof(double)), ref)
+                && xi_sort_stats().tail_elems == nonfinite;
+        std::vector<double> payloads(N / 4);
+        xi_gen_fill(XI_GEN_NAN, 3, payloads);
+        std::vector<double> pref = payloads;
+        std::sort(pref.begin(), pref.end(), [](double a, double b) { return double_to_key(a) < double_to_key(b); });
+        ok = ok && same(file_sort(payloads, 8192 * sizeof(double)), pref)
+                && xi_sort_stats().tail_elems < payloads.size();
+        std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-1f : concurrent calls keep their own state ─────────────
+    {
+        std::cout << "\n[Test-1f] xi_sort / xi_argsort / xi_group on threads beside a file sort\n";
+        const std::size_t N = 200'000;
+        std::vector<double> v(N);
+        xi_gen_fill(XI_GEN_DUPS, 31, v);
+        for (std::size_t i = 0; i < N; i += 97) v[i] = std::nan("");
+        XiSortConfig cfg;   cfg.trace = true;
+        // reference results and Φ(χ) from one call at a time
+        std::vector<double> ref = v;
+        xi_sort(ref.data(), N, cfg);
+        const XiSortStats sort_ref = xi_sort_stats();
+        std::vector<uint64_t> perm_ref(N);
+        xi_argsort(v.data(), N, perm_ref.data(), cfg);
+        const double arg_phi = xi_sort_stats().phi;
+        std::vector<XiGroup> groups_ref(N);
+        groups_ref.resize(xi_group(v.data(), nullptr, N, groups_ref.data(), cfg));
+        const double group_phi = xi_sort_stats().phi;
+        // a throttled file sort holds its call open the whole time
+        const std::string file_in = "xisort_conc_input.bin", file_out = "xisort_conc_sorted.bin";
+        xi_gen_file(file_in, XI_GEN_UNIFORM, 32, 1'000'000);
+        XiSortConfig fcfg;   fcfg.mem_limit = 1ULL << 20;
+        xi_set_io_throttle(4.0, 0.0);
+        XiSortTask slow = xi_sort_file_async(file_in, file_out, fcfg);
+        std::vector<int> good(3, 0);
+        std::vector<std::thread> pool;
+        for (int t = 0; t < 3; ++t) pool.emplace_back([&, t] {
+            bool same = true;
+            for (int rep = 0; rep < 4; ++rep) {
+                if (t == 0) {
+                    std::vector<double> w = v;
+                    xi_sort(w.data(), N, cfg);
+                    const XiSortStats st = xi_sort_stats();
+                    same = same && std::memcmp(w.data(), ref.data(), N * sizeof(double)) == 0
+                               && st.phi == sort_ref.phi && st.tail_elems == sort_ref.tail_elems;
+                } else if (t == 1) {
+                    std::vector<uint64_t> perm(N);
+                    xi_argsort(v.data(), N, perm.data(), cfg);
+                    same = same && perm == perm_ref && xi_sort_stats().phi == arg_phi;
+                } else {
+                    std::vector<XiGroup> g(N);
+                    g.resize(xi_group(v.data(), nullptr, N, g.data(), cfg));
+                    same = same && g.size() == groups_ref.size() && xi_sort_stats().phi == group_phi;
+                    for (std::size_t k = 0; same && k < g.size(); ++k)
+                        same = g[k].count == groups_ref[k].count && g[k].first == groups_ref[k].first;
+                }
+            }
+            good[t] = same;
+        });
+        for (auto& th : pool) th.join();
+        const bool overlapped = !slow.ready();
+        slow.cancel();
+        bool cancelled = false;
+        try {
+            slow.get();
+        } catch (const XiCancelled&) {
+            cancelled = true;
+        }
+        xi_set_io_throttle(0.0, 0.0);
+        std::filesystem::remove(file_in);
+        std::filesystem::remove(file_out);
+        const bool ok = good[0] && good[1] && good[2] && overlapped && cancelled;
+        std::cout << "threads: " << (good[0] && good[1] && good[2] ? "exact, own stats" : "MIXED UP")
+                  << "; in-memory calls " << (overlapped ? "ran beside" : "waited for") << " the file sort\n";
+        std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    }
+
     // ── Test-2 : in-memory 100 M normal variates ───────────────────
     {
         std::cout << "\n[Test-2] in-memory large sort\n";
@@ -100,6 +440,939 @@ int main(int argc, char** argv)
         print_sample(v);
     }
 
+    // ── Test-3s : small external file sort (many runs, k-way merge) ─
+    {
+        std::cout << "\n[Test-3s] external file sort, tiny mem_limit\n";
+        const std::string file_in  = "xisort_small_input.bin";
+        const std::string file_out = "xisort_small_sorted.bin";
+        const std::size_t N = 1'000'000;
+        std::vector<double> v(N);
+        std::mt19937_64 rng(3);
+        std::normal_distribution<double> gauss(0.0, 1.0);
+        for (auto& x : v) x = gauss(rng);
+        {
+            std::ofstream fout(file_in, std::ios::binary);
+            fout.write(reinterpret_cast<char*>(v.data()), N * sizeof(double));
+        }
+        XiSortConfig cfg;   cfg.mem_limit = 1ULL << 20;   cfg.buffer_elems = 4096;
+        cfg.events = true;
+        xi_clear_trace_events();
+        auto t0 = std::chrono::steady_clock::now();
+        xi_sort_file(file_in, file_out, cfg);
+        std::cout << "time: " << elapsed_ms(t0) << " ms, runs: "
+                  << xi_sort_stats().runs << "\n";
+        // trace export: one chunk_read / run_sort / run_write span per run
+        const std::string file_events = "xisort_small_events.json";
+        xi_write_trace_events(file_events);
+        std::size_t reads = 0, sorts = 0, writes = 0, rounds = 0;
+        {
+            std::ifstream fin(file_events);
+            std::string line;
+            while (std::getline(fin, line)) {
+                reads  += line.find("\"chunk_read\"") != std::string::npos;
+                sorts  += line.find("\"run_sort\"") != std::string::npos;
+                writes += line.find("\"run_write\"") != std::string::npos;
+                rounds += line.find("\"merge_round\"") != std::string::npos;
+            }
+        }
+        const std::size_t runs = xi_sort_stats().runs;
+        bool traced = reads == runs && sorts == runs && writes == runs && rounds == 1;
+        std::cout << "trace events: " << reads << " reads, " << sorts << " sorts, "
+                  << writes << " writes, " << rounds << " merge rounds\n";
+        std::filesystem::remove(file_events);
+        // I/O accounting per file class: input and output cross once, runs twice
+        const XiSortStats st = xi_sort_stats();
+        const uint64_t bytes = N * sizeof(double);
+        bool io_ok = st.io[XI_FILE_INPUT].read.bytes == bytes
+                  && st.io[XI_FILE_RUN].write.bytes == bytes
+                  && st.io[XI_FILE_RUN].read.bytes == bytes
+                  && st.io[XI_FILE_OUTPUT].write.bytes == bytes
+                  && st.io[XI_FILE_RUN].read.ops > 0;
+        // footprint: the chunk buffer plus both XiItem arrays of one run, nothing leaked
+        const uint64_t chunk_elems = cfg.mem_limit / sizeof(double);
+        bool mem_ok = st.mem_live_bytes == 0 && st.mem_allocs == st.mem_frees
+                   && st.mem_peak_bytes >= cfg.mem_limit + 2 * chunk_elems * sizeof(XiItem);
+        std::cout << "peak memory: " << st.mem_peak_bytes << " bytes in "
+                  << st.mem_allocs << " allocations\n";
+        std::cout << "run reads: " << st.io[XI_FILE_RUN].read.ops << " ops, p99 "
+                  << xi_lat_quantile_ms(st.io[XI_FILE_RUN].read, 0.99) << " ms\n";
+        std::vector<double> out(N);
+        {
+            std::ifstream fin(file_out, std::ios::binary);
+            fin.read(reinterpret_cast<char*>(out.data()), N * sizeof(double));
+        }
+        XiSortConfig ref;
+        xi_sort(v.data(), static_cast<uint64_t>(v.size()), ref);
+        bool same = std::memcmp(v.data(), out.data(), N * sizeof(double)) == 0;
+        std::cout << (same && traced && io_ok && mem_ok && is_sorted_total(out) ? "status: OK\n" : "status: FAIL\n");
+        std::filesystem::remove(file_in);
+        std::filesystem::remove(file_out);
+    }
+
+    // ── Test-3a : async file sort, cancellation, deadline, cleanup ──
+    {
+        std::cout << "\n[Test-3a] xi_sort_file_async, cancellation and deadlines\n";
+        const std::string file_in  = "xisort_async_input.bin";
+        const std::string file_out = "xisort_async_sorted.bin";
+        const std::size_t N = 1'000'000;
+        xi_gen_file(file_in, XI_GEN_UNIFORM, 21, N);
+        XiSortConfig cfg;   cfg.mem_limit = 1ULL << 20;   cfg.buffer_elems = 4096;
+        XiSortTask task = xi_sort_file_async(file_in, file_out, cfg);
+        std::atomic<bool> notified(false);
+        uint64_t inner_runs = 0;
+        // the callback runs before get() returns, and may itself call get()
+        task.then([&] { inner_runs = task.get().runs; notified = true; });
+        const XiSortStats st = task.get();
+        std::vector<double> out(N);
+        {
+            std::ifstream fin(file_out, std::ios::binary);
+            fin.read(reinterpret_cast<char*>(out.data()), N * sizeof(double));
+        }
+        bool ok = notified && inner_runs == st.runs
+               && st.runs == (N * sizeof(double) + cfg.mem_limit - 1) / cfg.mem_limit && is_sorted_total(out);
+        std::filesystem::remove(file_out);
+        // two tasks at once, in the same directory: they queue on the shared worker, neither output is mixed up
+        {
+            const std::string file_in2 = "xisort_async_input2.bin", file_out2 = "xisort_async_sorted2.bin";
+            xi_gen_file(file_in2, XI_GEN_NORMAL, 22, N);
+            XiSortTask a = xi_sort_file_async(file_in, file_out, cfg);
+            XiSortTask b = xi_sort_file_async(file_in2, file_out2, cfg);
+            const XiSortStats sa = a.get(), sb = b.get();
+            bool both = sa.runs == st.runs && sb.runs == st.runs;
+            for (const auto &io : {std::make_pair(file_in, file_out), std::make_pair(file_in2, file_out2)}) {
+                std::vector<double> in(N), got(N);
+                std::ifstream fi(io.first, std::ios::binary), fo(io.second, std::ios::binary);
+                fi.read(reinterpret_cast<char*>(in.data()), N * sizeof(double));
+                fo.read(reinterpret_cast<char*>(got.data()), N * sizeof(double));
+                XiSortConfig ref;
+                xi_sort(in.data(), N, ref);
+                both = both && std::memcmp(in.data(), got.data(), N * sizeof(double)) == 0;
+            }
+            std::cout << "concurrent tasks: " << (both ? "both outputs exact" : "MIXED UP") << "\n";
+            ok = ok && both;
+            std::filesystem::remove(file_in2);
+            std::filesystem::remove(file_out2);
+            std::filesystem::remove(file_out);
+        }
+        // an empty handle is inert; assigning over an unfinished task cancels it first
+        {
+            XiSortTask empty;
+            empty.cancel();
+            bool inert = !empty.valid() && !empty.ready();
+            xi_set_io_throttle(40.0, 0.0);      // the sort cannot finish before it is replaced
+            XiSortTask keep = xi_sort_file_async(file_in, file_out, cfg);
+            keep = XiSortTask();
+            xi_set_io_throttle(0.0, 0.0);
+            ok = ok && inert && !keep.valid() && !std::filesystem::exists(file_out);
+        }
+        // cancel a throttled sort mid-flight
+        xi_set_io_throttle(40.0, 0.0);
+        XiSortTask slow = xi_sort_file_async(file_in, file_out, cfg);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        auto t0 = std::chrono::steady_clock::now();
+        slow.cancel();
+        bool cancelled = false;
+        try {
+            slow.get();
+        } catch (const XiCancelled&) {
+            cancelled = true;
+        }
+        std::cout << "cancelled after " << elapsed_ms(t0) << " ms\n";
+        xi_set_io_throttle(0.0, 0.0);
+        // scratch runs and the partial output are gone
+        auto no_scratch = [&] {
+            for (const auto& e : std::filesystem::directory_iterator("."))
+                if (e.path().filename().string().rfind("xisort_run_", 0) == 0) return false;
+            return !std::filesystem::exists(file_out);
+        };
+        ok = ok && no_scratch();
+        // deadline: the input is left a permutation of itself (NaN-heavy, so the
+        // tail split is undone too) and no scratch file survives
+        std::vector<double> v(N), orig;
+        xi_gen_fill(XI_GEN_NAN, 4, v);
+        for (std::size_t i = 0; i < N; i += 3) v[i] = static_cast<double>(i);
+        orig = v;
+        bool timed_out = false;
+        XiSortConfig dcfg;   dcfg.timeout_ms = 1e-3;
+        try {
+            xi_sort(v.data(), N, dcfg);
+        } catch (const XiCancelled&) {
+            timed_out = true;
+        }
+        ok = ok && timed_out;
+        timed_out = false;
+        dcfg.external = true;   dcfg.mem_limit = 1ULL << 16;   dcfg.timeout_ms = 20.0;
+        xi_set_io_throttle(40.0, 0.0);      // the run I/O alone outlasts the deadline
+        try {
+            xi_sort(v.data(), N, dcfg);
+        } catch (const XiCancelled&) {
+            timed_out = true;
+        }
+        xi_set_io_throttle(0.0, 0.0);
+        XiSortConfig ref;
+        xi_sort(v.data(), N, ref);
+        xi_sort(orig.data(), N, ref);
+        ok = ok && timed_out && no_scratch()
+                && std::memcmp(v.data(), orig.data(), N * sizeof(double)) == 0;
+        // a cancel late in an in-memory sort stops inside the final merges
+        {
+            std::vector<double> w(1u << 22), src;
+            xi_gen_fill(XI_GEN_UNIFORM, 23, w);
+            src = w;
+            XiSortConfig lcfg;
+            auto t1 = std::chrono::steady_clock::now();
+            xi_sort(w.data(), w.size(), lcfg);
+            const double full_ms = elapsed_ms(t1);
+            std::vector<double> sorted = w;
+            std::atomic<bool> stop(false);
+            lcfg.cancel = &stop;
+            bool late = false;
+            double lag = 0.0;
+            // a run that beats its own timing finishes before the flag: cancel earlier
+            for (double at = 0.9; !late && at > 0.5; at -= 0.1) {
+                w = src;
+                stop = false;
+                std::chrono::steady_clock::time_point t_cancel;
+                std::thread canceller([&] {
+                    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(at * full_ms));
+                    t_cancel = std::chrono::steady_clock::now();
+                    stop = true;
+                });
+                try {
+                    xi_sort(w.data(), w.size(), lcfg);
+                } catch (const XiCancelled&) {
+                    late = true;
+                }
+                const auto t_end = std::chrono::steady_clock::now();
+                canceller.join();
+                lag = std::chrono::duration<double, std::milli>(t_end - t_cancel).count();
+            }
+            std::cout << "late cancel stopped " << lag << " ms after the flag (sort takes "
+                      << full_ms << " ms)\n";
+            xi_sort(w.data(), w.size(), XiSortConfig());
+            ok = ok && late && lag < std::max(50.0, full_ms / 20.0)
+                    && std::memcmp(w.data(), sorted.data(), w.size() * sizeof(double)) == 0;
+        }
+        std::filesystem::remove(file_in);
+        std::cout << (ok && cancelled ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-3g : external argsort (permutation file) ───────────────
+    {
+        std::cout << "\n[Test-3g] xi_argsort_file, compact run records\n";
+        const std::string file_in   = "xisort_arg_input.bin";
+        const std::string file_perm = "xisort_arg_perm.bin";
+        const std::string file_vals = "xisort_arg_sorted.bin";
+        const std::size_t N = 300'000;
+        std::vector<double> v(N);
+        xi_gen_fill(XI_GEN_IEEE, 8, v);                 // NaNs, ±0, ±inf
+        for (std::size_t i = 0; i < N; i += 2) v[i] = static_cast<double>(i % 97);
+        {
+            std::ofstream fout(file_in, std::ios::binary);
+            fout.write(reinterpret_cast<char*>(v.data()), N * sizeof(double));
+        }
+        auto read_u64 = [](const std::string& path, std::size_t n) {
+            std::vector<uint64_t> r(n);
+            std::ifstream fin(path, std::ios::binary);
+            fin.read(reinterpret_cast<char*>(r.data()), n * sizeof(uint64_t));
+            return r;
+        };
+        bool ok = true;
+        for (XiTieBreak tb : {XI_TIE_INDEX, XI_TIE_RANDOM}) {
+            XiSortConfig cfg;   cfg.mem_limit = 1ULL << 16;   cfg.buffer_elems = 1000;
+            cfg.tie_break = tb;   cfg.seed = 5;
+            xi_argsort_file(file_in, file_perm, file_vals, cfg);
+            const XiSortStats st = xi_sort_stats();
+            // the in-memory argsort of the same config gives the same permutation
+            XiSortConfig mcfg;   mcfg.tie_break = tb;   mcfg.seed = 5;
+            std::vector<uint64_t> ref(N);
+            xi_argsort(v.data(), N, ref.data(), mcfg);
+            const std::vector<uint64_t> perm = read_u64(file_perm, N);
+            const std::vector<uint64_t> vals = read_u64(file_vals, N);
+            bool vals_ok = true;
+            for (std::size_t r = 0; r < N; ++r)
+                vals_ok = vals_ok && std::memcmp(&vals[r], &v[perm[r]], sizeof(double)) == 0;
+            // runs cross the disk once each way as 13-byte records
+            const uint64_t run_bytes = N * (sizeof(double) + 5);
+            bool io_ok = st.runs == (N * sizeof(double) + cfg.mem_limit - 1) / cfg.mem_limit
+                      && st.io[XI_FILE_RUN].write.bytes == run_bytes
+                      && st.io[XI_FILE_RUN].read.bytes == run_bytes
+                      && st.io[XI_FILE_OUTPUT].write.bytes == 2 * N * sizeof(uint64_t);
+            std::cout << (tb == XI_TIE_INDEX ? "index" : "random") << ": " << st.runs << " runs, "
+                      << st.io[XI_FILE_RUN].write.bytes << " run bytes\n";
+            ok = ok && perm == ref && vals_ok && io_ok;
+        }
+        // without a values path only the permutation is written
+        XiSortConfig cfg;   cfg.buffer_elems = 1000;
+        std::filesystem::remove(file_vals);
+        xi_argsort_file(file_in, file_perm, "", cfg);
+        const std::size_t runs = xi_sort_stats().runs;
+        std::vector<uint64_t> ref(N);
+        xi_argsort(v.data(), N, ref.data(), XiSortConfig());
+        ok = ok && read_u64(file_perm, N) == ref && runs == 1
+                && !std::filesystem::exists(file_vals);
+        // traced calls report their own Φ(χ)
+        cfg.mem_limit = 1ULL << 16;   cfg.trace = true;
+        const bool trace_ok = trace_repeats([&] { xi_argsort_file(file_in, file_perm, "", cfg); });
+        std::cout << "trace: " << (trace_ok ? "isolated" : "leaks") << "\n";
+        ok = ok && trace_ok;
+        std::filesystem::remove(file_in);
+        std::filesystem::remove(file_perm);
+        std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-3r : variable-length records (length-prefixed, delimited) ──
+    {
+        std::cout << "\n[Test-3r] xi_sort_records_file, length-prefixed and text lines\n";
+        const std::string file_in  = "xisort_rec_input.bin";
+        const std::string file_out = "xisort_rec_sorted.bin";
+        const std::size_t N = 20'000;
+        std::mt19937_64 rng(9);
+        auto key_of = [&rng] {
+            const uint64_t r = rng() % 50;
+            return r == 0 ? std::numeric_limits<double>::quiet_NaN() : static_cast<double>(r) * 0.25 - 3.0;
+        };
+        auto file_bytes = [](const std::string& path) {
+            std::ifstream fin(path, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+        };
+        auto sort_check = [&](std::vector<std::pair<double, std::string>> recs, const XiRecordFormat& fmt,
+                              bool cut_last) {
+            {
+                std::string in;
+                for (const auto& r : recs) in += r.second;
+                if (cut_last) in.pop_back();
+                std::ofstream fout(file_in, std::ios::binary);
+                fout << in;
+            }
+            XiSortConfig cfg;   cfg.mem_limit = 1ULL << 16;   cfg.buffer_elems = 512;
+            xi_sort_records_file(file_in, file_out, fmt, cfg);
+            const XiSortStats st = xi_sort_stats();
+            std::stable_sort(recs.begin(), recs.end(), [](const auto& a, const auto& b) {
+                return double_to_key(a.first) < double_to_key(b.first);
+            });
+            std::string expect;
+            for (const auto& r : recs) expect += r.second;
+            // each pass copies every record exactly once
+            const uint64_t bytes = expect.size();
+            bool ok = file_bytes(file_out) == expect && st.runs > 1
+                   && st.io[XI_FILE_RUN].write.bytes == bytes && st.io[XI_FILE_OUTPUT].write.bytes == bytes;
+            std::cout << recs.size() << " records, " << bytes << " bytes, " << st.runs << " runs\n";
+            return ok;
+        };
+        // 4-byte tag, 8-byte key, 0..300 bytes of payload
+        std::vector<std::pair<double, std::string>> recs;
+        for (std::size_t i = 0; i < N; ++i) {
+            const double k = key_of();
+            std::string payload(12 + rng() % 301, static_cast<char>('a' + i % 26));
+            std::memcpy(&payload[4], &k, sizeof k);
+            const uint32_t len = static_cast<uint32_t>(payload.size());
+            recs.push_back({k, std::string(reinterpret_cast<const char*>(&len), 4) + payload});
+        }
+        XiRecordFormat bin;   bin.key_offset = 4;
+        bool ok = sort_check(recs, bin, false);
+        // text lines keyed by their first field; the last line lacks its newline
+        recs.clear();
+        for (std::size_t i = 0; i + 1 < N; ++i) {
+            const double k = key_of();
+            char line[64];
+            std::snprintf(line, sizeof line, "%.17g,%zu\n", k, i);
+            recs.push_back({k, line});
+        }
+        recs.push_back({-100.0, "-100,last\n"});
+        XiRecordFormat text;   text.framing = XI_FRAME_DELIM;   text.key_text = true;
+        ok = sort_check(recs, text, true) && ok;
+        // traced calls report their own Φ(χ)
+        XiSortConfig tcfg;   tcfg.mem_limit = 1ULL << 16;   tcfg.buffer_elems = 512;   tcfg.trace = true;
+        const bool trace_ok = trace_repeats([&] { xi_sort_records_file(file_in, file_out, text, tcfg); });
+        std::cout << "trace: " << (trace_ok ? "isolated" : "leaks") << "\n";
+        ok = ok && trace_ok;
+        std::filesystem::remove(file_out);
+        std::filesystem::remove(file_in);
+        std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-3c : group-by aggregation (in memory and fused into the merge) ──
+    {
+        std::cout << "\n[Test-3c] xi_group / xi_group_file, count, sum, first/last\n";
+        const std::string file_in  = "xisort_group_input.bin";
+        const std::string file_pay = "xisort_group_payload.bin";
+        const std::string file_out = "xisort_group_out.bin";
+        const std::size_t N = 400'000;
+        std::vector<double> v(N), pay(N);
+        xi_gen_fill(XI_GEN_DUPS, 12, v);
+        for (std::size_t i = 0; i < N; i += 1000) v[i] = (i & 1000) ? -0.0 : std::nan("1");
+        for (std::size_t i = 0; i < N; ++i) pay[i] = static_cast<double>(i % 7);   // exact sums
+        {
+            std::ofstream fin(file_in, std::ios::binary), fpay(file_pay, std::ios::binary);
+            fin.write(reinterpret_cast<char*>(v.data()), N * sizeof(double));
+            fpay.write(reinterpret_cast<char*>(pay.data()), N * sizeof(double));
+        }
+        // reference: one ordered map entry per total-order key
+        std::map<uint64_t, XiGroup> ref;
+        for (std::size_t i = 0; i < N; ++i) {
+            auto ins = ref.insert({double_to_key(v[i]), XiGroup{v[i], 0, 0.0, i, i}});
+            XiGroup& g = ins.first->second;
+            g.count += 1;   g.sum += pay[i];   g.last = i;
+        }
+        auto same = [&ref](const std::vector<XiGroup>& got) {
+            if (got.size() != ref.size()) return false;
+            std::size_t k = 0;
+            for (const auto& kv : ref) {
+                const XiGroup& a = kv.second;
+                const XiGroup& b = got[k++];
+                if (double_to_key(b.value) != kv.first || a.count != b.count || a.sum != b.sum
+                    || a.first != b.first || a.last != b.last) return false;
+            }
+            return true;
+        };
+        std::vector<XiGroup> mem(N);
+        mem.resize(xi_group(v.data(), pay.data(), N, mem.data(), XiSortConfig()));
+        bool ok = same(mem);
+        XiSortConfig pcfg;   pcfg.parallel = true;
+        mem.resize(N);
+        mem.resize(xi_group(v.data(), pay.data(), N, mem.data(), pcfg));
+        ok = ok && same(mem);
+        XiSortConfig cfg;   cfg.mem_limit = 1ULL << 18;   cfg.buffer_elems = 64;
+        xi_group_file(file_in, file_pay, file_out, cfg);
+        const XiSortStats st = xi_sort_stats();
+        std::vector<XiGroup> ext(std::filesystem::file_size(file_out) / sizeof(XiGroup));
+        {
+            std::ifstream fin(file_out, std::ios::binary);
+            fin.read(reinterpret_cast<char*>(ext.data()), ext.size() * sizeof(XiGroup));
+        }
+        // runs hold one record per distinct value: far below the input size
+        ok = ok && same(ext) && st.runs > 1
+                && st.io[XI_FILE_RUN].write.bytes <= st.runs * ref.size() * sizeof(XiGroup);
+        // chunks are sized by what an element really holds; the merge adds a record
+        // buffer and a stream buffer per run
+        const uint64_t merge_bufs = (st.runs + 1) * (cfg.buffer_elems * sizeof(XiGroup) + XI_STREAM_BUF);
+        ok = ok && st.mem_peak_bytes <= cfg.mem_limit + merge_bufs;
+        std::cout << ref.size() << " groups, " << st.runs << " runs, "
+                  << st.io[XI_FILE_RUN].write.bytes << " run bytes for "
+                  << N * sizeof(double) << " input bytes, peak " << st.mem_peak_bytes << " bytes\n";
+        // traced calls report their own Φ(χ)
+        XiSortConfig tcfg;   tcfg.trace = true;
+        cfg.trace = true;
+        std::vector<XiGroup> traced(N);
+        const bool trace_ok =
+            trace_repeats([&] { xi_group(v.data(), pay.data(), N, traced.data(), tcfg); })
+            && trace_repeats([&] { xi_group_file(file_in, file_pay, file_out, cfg); });
+        std::cout << "trace: " << (trace_ok ? "isolated" : "leaks") << "\n";
+        ok = ok && trace_ok;
+        std::filesystem::remove(file_in);
+        std::filesystem::remove(file_pay);
+        std::filesystem::remove(file_out);
+        std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-3k : top-k / bottom-k selection (one read, no spill) ───
+    {
+        std::cout << "\n[Test-3k] xi_topk / xi_topk_file, ties and IEEE order\n";
+        const std::string file_in = "xisort_topk_input.bin";
+        const std::size_t N = 1'500'000;
+        std::vector<double> v(N);
+        xi_gen_fill(XI_GEN_IEEE, 31, v);
+        for (std::size_t i = 0; i < N; i += 5) v[i] = static_cast<double>(i % 3);   // heavy ties
+        {
+            std::ofstream fout(file_in, std::ios::binary);
+            fout.write(reinterpret_cast<char*>(v.data()), N * sizeof(double));
+        }
+        // reference: rank by key (descending for top-k), lower index first
+        auto reference = [&v](std::size_t k, bool largest) {
+            std::vector<uint64_t> idx(v.size());
+            for (std::size_t i = 0; i < idx.size(); ++i) idx[i] = i;
+            std::stable_sort(idx.begin(), idx.end(), [&](uint64_t a, uint64_t b) {
+                const uint64_t ka = double_to_key(v[a]), kb = double_to_key(v[b]);
+                return largest ? ka > kb : ka < kb;
+            });
+            idx.resize(k);
+            std::sort(idx.begin(), idx.end(), [&](uint64_t a, uint64_t b) {
+                const uint64_t ka = double_to_key(v[a]), kb = double_to_key(v[b]);
+                return ka < kb || (ka == kb && a < b);
+            });
+            return idx;
+        };
+        auto same = [&v](const std::vector<XiSelected>& got, const std::vector<uint64_t>& ref) {
+            if (got.size() != ref.size()) return false;
+            for (std::size_t i = 0; i < ref.size(); ++i)
+                if (got[i].index != ref[i] || std::memcmp(&got[i].value, &v[ref[i]], sizeof(double)) != 0)
+                    return false;
+            return true;
+        };
+        bool ok = true;
+        for (std::size_t k : {std::size_t(1), std::size_t(1000), std::size_t(400'000)}) {
+            for (bool largest : {true, false}) {
+                const std::vector<uint64_t> ref = reference(k, largest);
+                XiSortConfig cfg;   cfg.parallel = (k == 1000);
+                const bool mem = same(xi_topk(v.data(), N, k, largest, cfg), ref);
+                const bool file = same(xi_topk_file(file_in, k, largest, cfg), ref);
+                const XiSortStats st = xi_sort_stats();
+                const bool io = st.io[XI_FILE_INPUT].read.bytes == N * sizeof(double)
+                             && st.io[XI_FILE_RUN].write.bytes == 0 && st.io[XI_FILE_OUTPUT].write.bytes == 0;
+                std::cout << (largest ? "top-" : "bottom-") << k << ": " << (mem && file && io ? "match" : "MISMATCH")
+                          << ", " << st.run_ms << " ms\n";
+                ok = ok && mem && file && io;
+            }
+        }
+        XiSortConfig tight;   tight.mem_limit = 1ULL << 16;
+        bool threw = false;
+        try {
+            xi_topk_file(file_in, 100'000, true, tight);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        ok = ok && threw && xi_topk(v.data(), N, 0, true, XiSortConfig()).empty()
+                && xi_topk(v.data(), 10, 50, false, XiSortConfig()).size() == 10;
+        std::filesystem::remove(file_in);
+        std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-3q : exact quantiles by histogram narrowing ────────────
+    {
+        std::cout << "\n[Test-3q] xi_select_ranks_file / xi_quantiles_file\n";
+        const std::string file_in = "xisort_quant_input.bin";
+        const std::size_t N = 2'000'000;
+        bool ok = true;
+        for (XiGenDist dist : {XI_GEN_NORMAL, XI_GEN_IEEE, XI_GEN_DUPS}) {
+            xi_gen_file(file_in, dist, 17, N);
+            std::vector<double> v(N);
+            {
+                std::ifstream fin(file_in, std::ios::binary);
+                fin.read(reinterpret_cast<char*>(v.data()), N * sizeof(double));
+            }
+            std::vector<uint64_t> keys(N);
+            for (std::size_t i = 0; i < N; ++i) keys[i] = double_to_key(v[i]);
+            std::sort(keys.begin(), keys.end());
+            std::vector<uint64_t> ranks = {0, N - 1, N / 2, 12345, 1'999'000};
+            std::vector<double> qs = {0.0, 0.01, 0.5, 0.99, 0.999, 1.0};
+            for (int budget = 0; budget < 2; ++budget) {
+                XiSortConfig cfg;   cfg.parallel = budget == 1;
+                if (budget) cfg.mem_limit = 1ULL << 20;      // 128 Ki candidate keys
+                const std::vector<double> got = xi_select_ranks_file(file_in, ranks, cfg);
+                const XiSortStats st = xi_sort_stats();
+                bool match = got.size() == ranks.size();
+                for (std::size_t i = 0; match && i < ranks.size(); ++i)
+                    match = double_to_key(got[i]) == keys[ranks[i]];
+                const std::vector<double> qv = xi_quantiles_file(file_in, qs, cfg);
+                for (std::size_t i = 0; match && i < qs.size(); ++i)
+                    match = double_to_key(qv[i]) == keys[static_cast<std::size_t>(std::floor(qs[i] * (N - 1)))];
+                const bool io = st.io[XI_FILE_INPUT].read.bytes == st.merge_rounds * N * sizeof(double)
+                             && st.io[XI_FILE_RUN].write.bytes == 0;
+                std::cout << xi_gen_name(dist) << (budget ? ", 1 MiB" : ", unbounded") << ": "
+                          << st.merge_rounds << " passes, " << (match ? "exact" : "MISMATCH") << "\n";
+                ok = ok && match && io && (budget || st.merge_rounds == 1);
+                if (budget && dist == XI_GEN_NORMAL) ok = ok && st.merge_rounds == 2;
+            }
+        }
+        // thousands of ranks under a small budget: the histograms stay inside it
+        {
+            xi_gen_file(file_in, XI_GEN_NORMAL, 18, N);
+            std::vector<double> v(N);
+            {
+                std::ifstream fin(file_in, std::ios::binary);
+                fin.read(reinterpret_cast<char*>(v.data()), N * sizeof(double));
+            }
+            std::vector<uint64_t> keys(N);
+            for (std::size_t i = 0; i < N; ++i) keys[i] = double_to_key(v[i]);
+            std::sort(keys.begin(), keys.end());
+            std::vector<uint64_t> ranks;
+            for (std::size_t i = 0; i < 3000; ++i) ranks.push_back(i * (N / 3000));
+            XiSortConfig cfg;   cfg.parallel = true;   cfg.mem_limit = 256 * 1024;
+            const std::vector<double> got = xi_select_ranks_file(file_in, ranks, cfg);
+            const XiSortStats st = xi_sort_stats();
+            bool match = got.size() == ranks.size();
+            for (std::size_t i = 0; match && i < ranks.size(); ++i)
+                match = double_to_key(got[i]) == keys[ranks[i]];
+            const uint64_t block = (1ULL << 20) * sizeof(double);
+            // the read block, plus the gathered keys held per slice and then merged
+            const bool bounded = st.mem_peak_bytes <= block + 3 * cfg.mem_limit;
+            std::cout << ranks.size() << " ranks, 256 KiB: " << st.merge_rounds << " passes, peak "
+                      << st.mem_peak_bytes / 1024 << " KiB, " << (match ? "exact" : "MISMATCH") << "\n";
+            ok = ok && match && bounded;
+        }
+        bool threw = false;
+        try {
+            xi_select_ranks_file(file_in, {N}, XiSortConfig());
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        std::filesystem::remove(file_in);
+        std::cout << (ok && threw ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-3i : sparse index sidecar and its query API ────────────
+    {
+        std::cout << "\n[Test-3i] xi_sort_file index sidecar, XiSortedFile lookups\n";
+        const std::string file_in  = "xisort_index_input.bin";
+        const std::string file_out = "xisort_index_sorted.bin";
+        const std::size_t N = 1'000'003;
+        xi_gen_file(file_in, XI_GEN_IEEE, 23, N);
+        XiSortConfig cfg;   cfg.mem_limit = 1ULL << 20;   cfg.index_stride = 4096;
+        xi_sort_file(file_in, file_out, cfg);
+        std::vector<double> v(N);
+        {
+            std::ifstream fin(file_out, std::ios::binary);
+            fin.read(reinterpret_cast<char*>(v.data()), N * sizeof(double));
+        }
+        std::vector<uint64_t> keys(N);
+        for (std::size_t i = 0; i < N; ++i) keys[i] = double_to_key(v[i]);
+        XiSortedFile sf(file_out);
+        bool ok = sf.size() == N;
+        std::vector<double> probes = {0.0, -0.0, 1.0, -1.0, 1e-300,
+                                      std::numeric_limits<double>::infinity(),
+                                      -std::numeric_limits<double>::infinity(),
+                                      std::nan(""), -std::nan(""), v[0], v[N - 1], v[4096], v[4095]};
+        std::mt19937_64 rng(5);
+        std::normal_distribution<double> gauss(0.0, 1.0);
+        for (int i = 0; i < 200; ++i) probes.push_back(gauss(rng));
+        for (double x : probes) {
+            const uint64_t k = double_to_key(x);
+            const uint64_t lb = std::lower_bound(keys.begin(), keys.end(), k) - keys.begin();
+            const uint64_t ub = std::upper_bound(keys.begin(), keys.end(), k) - keys.begin();
+            const uint64_t r0 = sf.block_reads();
+            ok = ok && sf.lower_bound(x) == lb && sf.block_reads() - r0 <= 1 && sf.upper_bound(x) == ub;
+        }
+        // range count: two block reads; range scan matches the slice
+        const uint64_t r0 = sf.block_reads();
+        const uint64_t lo = std::lower_bound(keys.begin(), keys.end(), double_to_key(-0.5)) - keys.begin();
+        const uint64_t hi = std::lower_bound(keys.begin(), keys.end(), double_to_key(0.25)) - keys.begin();
+        ok = ok && sf.count(-0.5, 0.25) == hi - lo && sf.block_reads() - r0 <= 2;
+        const std::vector<double> part = sf.range(-0.5, 0.25);
+        ok = ok && part.size() == hi - lo
+                && std::memcmp(part.data(), v.data() + lo, part.size() * sizeof(double)) == 0;
+        std::cout << probes.size() << " probes, " << sf.block_reads() << " block reads, sidecar "
+                  << std::filesystem::file_size(file_out + ".xidx") << " bytes\n";
+        // re-sorting without an index removes the now stale sidecar
+        cfg.index_stride = 0;
+        xi_sort_file(file_in, file_out, cfg);
+        ok = ok && !std::filesystem::exists(file_out + ".xidx");
+        bool threw = false;
+        try {
+            XiSortedFile missing(file_out);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        std::filesystem::remove(file_in);
+        std::filesystem::remove(file_out);
+        std::cout << (ok && threw ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-3j : set operations and merge-join over sorted files ──
+    {
+        std::cout << "\n[Test-3j] xi_set_op_files / xi_merge_join_files vs std:: set algorithms\n";
+        const std::string raw = "xisort_set_raw.bin";
+        const std::string files[3] = {"xisort_set_a.bin", "xisort_set_b.bin", "xisort_set_c.bin"};
+        const std::string file_out = "xisort_set_out.bin";
+        const std::size_t sizes[3] = {30'000, 20'000, 25'000};
+        const double specials[4] = {0.0, -0.0, std::numeric_limits<double>::infinity(), std::nan("")};
+        std::vector<uint64_t> keys[3];
+        std::mt19937_64 rng(99);
+        std::normal_distribution<double> gauss(0.0, 60.0);
+        XiSortConfig cfg;   cfg.buffer_elems = 256;   cfg.index_stride = 128;
+        for (int f = 0; f < 3; ++f) {
+            std::vector<double> v(sizes[f]);
+            for (double& x : v) x = (rng() % 50 == 0) ? specials[rng() % 4] : std::round(gauss(rng)) / 4.0;
+            if (f == 2) for (double& x : v) x += 40.0;     // c overlaps a and b only partly
+            {
+                std::ofstream fout(raw, std::ios::binary);
+                fout.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(double));
+            }
+            xi_sort_file(raw, files[f], cfg);
+            for (double x : v) keys[f].push_back(double_to_key(x));
+            std::sort(keys[f].begin(), keys[f].end());
+        }
+        auto read_keys = [&](const std::string& path) {
+            std::vector<double> v(std::filesystem::file_size(path) / sizeof(double));
+            std::ifstream fin(path, std::ios::binary);
+            fin.read(reinterpret_cast<char*>(v.data()), v.size() * sizeof(double));
+            std::vector<uint64_t> k;
+            for (double x : v) k.push_back(double_to_key(x));
+            return k;
+        };
+        std::vector<uint64_t> uniq[3];
+        for (int f = 0; f < 3; ++f) {
+            uniq[f] = keys[f];
+            uniq[f].erase(std::unique(uniq[f].begin(), uniq[f].end()), uniq[f].end());
+        }
+        std::vector<uint64_t> ab, abc, all, dist, diff;
+        std::set_intersection(uniq[0].begin(), uniq[0].end(), uniq[1].begin(), uniq[1].end(), std::back_inserter(ab));
+        std::set_intersection(ab.begin(), ab.end(), uniq[2].begin(), uniq[2].end(), std::back_inserter(abc));
+        for (int f = 0; f < 3; ++f) all.insert(all.end(), keys[f].begin(), keys[f].end());
+        std::sort(all.begin(), all.end());
+        dist = all;
+        dist.erase(std::unique(dist.begin(), dist.end()), dist.end());
+        std::vector<uint64_t> bc;
+        std::set_union(uniq[1].begin(), uniq[1].end(), uniq[2].begin(), uniq[2].end(), std::back_inserter(bc));
+        std::set_difference(uniq[0].begin(), uniq[0].end(), bc.begin(), bc.end(), std::back_inserter(diff));
+        const std::vector<std::string> in3(files, files + 3);
+        bool ok = true;
+        const struct { XiSetOp op; const std::vector<uint64_t>* want; const char* name; } cases[4] = {
+            {XI_SET_INTERSECT, &abc, "intersect"}, {XI_SET_UNION, &dist, "union"},
+            {XI_SET_UNION_ALL, &all, "union-all"}, {XI_SET_DIFFERENCE, &diff, "difference"}};
+        for (const auto& c : cases) {
+            const uint64_t n = xi_set_op_files(in3, file_out, c.op, cfg);
+            const bool good = n == c.want->size() && read_keys(file_out) == *c.want;
+            std::cout << c.name << ": " << n << " values " << (good ? "ok" : "MISMATCH") << "\n";
+            ok = ok && good;
+        }
+        // merge-join a with c: every equal pair, by value, then left, then right position
+        std::vector<uint64_t> want;
+        for (std::size_t l = 0, r0 = 0; l < keys[0].size(); ++l) {
+            while (r0 < keys[2].size() && keys[2][r0] < keys[0][l]) ++r0;
+            for (std::size_t r = r0; r < keys[2].size() && keys[2][r] == keys[0][l]; ++r) {
+                want.push_back(l);
+                want.push_back(r);
+            }
+        }
+        const uint64_t pairs = xi_merge_join_files(files[0], files[2], file_out, cfg);
+        std::vector<uint64_t> got(std::filesystem::file_size(file_out) / sizeof(uint64_t));
+        {
+            std::ifstream fin(file_out, std::ios::binary);
+            fin.read(reinterpret_cast<char*>(got.data()), got.size() * sizeof(uint64_t));
+        }
+        ok = ok && pairs * 2 == want.size() && got == want;
+        std::cout << "join: " << pairs << " pairs " << (got == want ? "ok" : "MISMATCH") << "\n";
+        // a narrow probe file against a large indexed one: the fences skip most blocks
+        const std::size_t N = 1'000'000;
+        xi_gen_file(raw, XI_GEN_SORTED, 1, N);
+        cfg.buffer_elems = 4096;   cfg.index_stride = 4096;
+        xi_sort_file(raw, files[0], cfg);
+        {
+            std::vector<double> probe;
+            for (int i = 0; i < 64; ++i) probe.push_back(xi_gen_ramp(N, 500'000 + 37 * i));
+            std::ofstream fout(files[1], std::ios::binary);
+            fout.write(reinterpret_cast<const char*>(probe.data()), probe.size() * sizeof(double));
+        }
+        std::filesystem::remove(files[1] + ".xidx");
+        const uint64_t hit = xi_set_op_files({files[0], files[1]}, file_out, XI_SET_INTERSECT, cfg);
+        const uint64_t bytes = xi_sort_stats().io[XI_FILE_INPUT].read.bytes;
+        std::cout << "indexed intersect: " << hit << " hits, read " << bytes << " of "
+                  << N * sizeof(double) + 64 * sizeof(double) << " bytes\n";
+        ok = ok && hit == 64 && bytes < N * sizeof(double) / 20;
+        // an unsorted input is rejected
+        xi_gen_file(raw, XI_GEN_REVERSE, 1, 1000);
+        bool threw = false;
+        try {
+            xi_set_op_files({raw, files[1]}, file_out, XI_SET_UNION, cfg);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        ok = ok && threw && !std::filesystem::exists(file_out);
+        std::filesystem::remove(raw);
+        for (const std::string& f : files) {
+            std::filesystem::remove(f);
+            std::filesystem::remove(f + ".xidx");
+        }
+        std::filesystem::remove(file_out);
+        std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-3o : bounded-disorder reorder of a nearly sorted stream ─
+    {
+        std::cout << "\n[Test-3o] XiReorderBuffer / xi_reorder_file on a k-sorted stream\n";
+        const std::string file_in  = "xisort_reorder_input.bin";
+        const std::string file_out = "xisort_reorder_sorted.bin";
+        const std::size_t N = 1'000'000, K = 2048;
+        // a ramp shuffled inside aligned blocks of K: no value is K or more positions out
+        std::vector<double> v(N);
+        for (std::size_t i = 0; i < N; ++i) v[i] = xi_gen_ramp(N, i);
+        std::mt19937_64 rng(3);
+        for (std::size_t b = 0; b < N; b += K) std::shuffle(v.begin() + b, v.begin() + std::min(N, b + K), rng);
+        v[N / 2] = 0.0;   v[N / 2 + 1] = -0.0;   // -0 sorts before +0, one position away
+        std::vector<double> want = v;
+        std::sort(want.begin(), want.end(), [](double a, double b) { return double_to_key(a) < double_to_key(b); });
+        bool ok = true;
+        // streaming: a value is released exactly `window` pushes after the window fills
+        {
+            XiReorderBuffer rb(K);
+            std::vector<double> out;
+            rb.push(v.data(), K, out);
+            ok = ok && out.empty() && rb.held() == K;
+            rb.push(v.data() + K, 10, out);
+            ok = ok && out.size() == 10;
+            rb.push(v.data() + K + 10, N - K - 10, out);
+            rb.finish(out);
+            ok = ok && rb.late() == 0 && std::memcmp(out.data(), want.data(), N * sizeof(double)) == 0;
+            bool threw = false;
+            XiReorderBuffer tight(K / 8);
+            try {
+                tight.push(v.data(), N, out);
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            ok = ok && threw;
+        }
+        {
+            std::ofstream fout(file_in, std::ios::binary);
+            fout.write(reinterpret_cast<const char*>(v.data()), N * sizeof(double));
+        }
+        auto read_out = [&]() {
+            std::vector<double> got(std::filesystem::file_size(file_out) / sizeof(double));
+            std::ifstream fin(file_out, std::ios::binary);
+            fin.read(reinterpret_cast<char*>(got.data()), got.size() * sizeof(double));
+            return got;
+        };
+        XiSortConfig cfg;   cfg.mem_limit = 1ULL << 20;
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t late = xi_reorder_file(file_in, file_out, K, cfg);
+        const double in_window_ms = elapsed_ms(t0);
+        std::vector<double> got = read_out();
+        ok = ok && late == 0 && got.size() == N && std::memcmp(got.data(), want.data(), N * sizeof(double)) == 0;
+        // a window below the disorder: late values go through the external path
+        late = xi_reorder_file(file_in, file_out, K / 8, cfg);
+        got = read_out();
+        ok = ok && late > 0 && got.size() == N && std::memcmp(got.data(), want.data(), N * sizeof(double)) == 0;
+        for (const auto& e : std::filesystem::directory_iterator("."))
+            if (e.path().filename().string().rfind("xisort_lag", 0) == 0) ok = false;
+        std::cout << "window " << K << ": " << in_window_ms << " ms; window " << K / 8 << ": "
+                  << late << " late values merged back\n";
+        std::filesystem::remove(file_in);
+        std::filesystem::remove(file_out);
+        std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    }
+
+    // ── Test-3d : distributed sort, coordinator + local worker processes ─
+#ifdef XISORT_HAVE_DIST
+    {
+        std::cout << "\n[Test-3d] XiDistCoordinator with forked workers (Unix socket, TCP)\n";
+        const std::string file_in  = "xisort_dist_input.bin";
+        const std::string file_out = "xisort_dist_sorted.bin";
+        const std::size_t N = 1'500'001;
+        xi_gen_file(file_in, XI_GEN_IEEE, 41, N);
+        std::vector<double> want(N);
+        xi_gen_fill(XI_GEN_IEEE, 41, N, 0, want.data(), N);
+        std::sort(want.begin(), want.end(), [](double a, double b) { return double_to_key(a) < double_to_key(b); });
+        XiSortConfig cfg;   cfg.mem_limit = 1ULL << 20;   cfg.buffer_elems = 4096;   cfg.timeout_ms = 60000.0;
+        // workers are forked processes; each sorts serially (no OpenMP after fork)
+        // crash 1: worker 0 hangs up before HELLO; crash 2: it fails right after SPLIT,
+        // while its data listener stays open but never accepts, so its peers block on it
+        auto spawn = [&](const std::string& addr, std::size_t n, int crash) {
+            std::vector<pid_t> pids;
+            for (std::size_t i = 0; i < n; ++i) {
+                const pid_t pid = fork();
+                if (pid == 0) {
+                    int rc = 0;
+                    try {
+                        if (crash && i == 0) abort_begin(XiSortConfig());   // no deadline left over from the parent
+                        if (crash == 1 && i == 0) {
+                            XiSocket s = dist_connect(addr, XI_DIST_CONNECT_MS);   // hangs up at once
+                            _exit(0);
+                        }
+                        if (crash == 2 && i == 0) {
+                            std::string data_addr;
+                            XiSocket data = dist_listen("127.0.0.1:0", data_addr);
+                            XiSocket s = dist_connect(addr, XI_DIST_CONNECT_MS);
+                            XiDistMsg hello(XI_DIST_HELLO);
+                            hello.put_str(data_addr);
+                            dist_send_msg(s, hello);
+                            dist_recv_msg(s, XI_DIST_JOB);
+                            XiDistMsg none(XI_DIST_SAMPLES);
+                            none.put_u64(0);
+                            dist_send_msg(s, none);
+                            dist_recv_msg(s, XI_DIST_SPLIT);
+                            dist_report_fail(s, "injected failure after SPLIT");
+                            try {
+                                dist_recv_msg(s, XI_DIST_DONE);     // until the coordinator relays it
+                            } catch (const std::exception&) {
+                            }
+                            _exit(0);
+                        }
+                        xi_dist_worker(addr, cfg);
+                    } catch (const std::exception&) {
+                        rc = 1;
+                    }
+                    _exit(rc);
+                }
+                pids.push_back(pid);
+            }
+            return pids;
+        };
+        auto reap = [](const std::vector<pid_t>& pids) {
+            int failed = 0;
+            for (pid_t pid : pids) {
+                int status = 0;
+                waitpid(pid, &status, 0);
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failed;
+            }
+            return failed;
+        };
+        bool ok = true;
+        const struct { const char* addr; std::size_t workers; } runs[2] = {
+            {"unix:xisort_dist_test.sock", 3}, {"127.0.0.1:0", 2}};
+        for (const auto& r : runs) {
+            std::vector<XiDistShard> shards;
+            XiDistCoordinator coord(r.addr);
+            const std::vector<pid_t> pids = spawn(coord.address(), r.workers, 0);
+            auto t0 = std::chrono::steady_clock::now();
+            try {
+                shards = coord.sort(r.workers, file_in, file_out, cfg);
+            } catch (const std::exception& e) {
+                std::cout << "coordinator: " << e.what() << "\n";
+            }
+            const double ms = elapsed_ms(t0);
+            const int failed = reap(pids);
+            std::vector<double> got;
+            std::size_t largest = 0;
+            for (const XiDistShard& sh : shards) {
+                std::vector<double> part(sh.elems);
+                std::ifstream fin(sh.path, std::ios::binary);
+                fin.read(reinterpret_cast<char*>(part.data()), part.size() * sizeof(double));
+                got.insert(got.end(), part.begin(), part.end());
+                largest = std::max<std::size_t>(largest, sh.elems);
+                std::filesystem::remove(sh.path);
+            }
+            const bool good = failed == 0 && shards.size() == r.workers && got.size() == N
+                           && std::memcmp(got.data(), want.data(), N * sizeof(double)) == 0;
+            std::cout << coord.address() << ": " << r.workers << " workers, " << ms << " ms, largest shard "
+                      << largest << " of " << N << (good ? " ok" : " MISMATCH") << "\n";
+            ok = ok && good && largest < N / r.workers + N / 20;
+        }
+        // a worker that hangs up fails the sort everywhere instead of hanging it
+        {
+            std::vector<pid_t> pids;
+            bool threw = false;
+            {
+                XiDistCoordinator coord("unix:xisort_dist_test.sock");
+                pids = spawn(coord.address(), 2, 1);
+                try {
+                    coord.sort(2, file_in, file_out, cfg);
+                } catch (const std::runtime_error&) {
+                    threw = true;
+                }
+            }   // closing the listener releases a worker that was never accepted
+            const int failed = reap(pids);
+            std::cout << "worker lost: coordinator " << (threw ? "failed" : "did not fail") << ", "
+                      << failed << " worker(s) failed\n";
+            ok = ok && threw && failed == 1;
+        }
+        // a worker failing mid-exchange is relayed to its peers well before the deadline
+        {
+            std::vector<pid_t> pids;
+            std::string why;
+            double ms = 0.0;
+            {
+                XiDistCoordinator coord("unix:xisort_dist_test.sock");
+                pids = spawn(coord.address(), 3, 2);
+                auto t0 = std::chrono::steady_clock::now();
+                try {
+                    coord.sort(3, file_in, file_out, cfg);
+                } catch (const std::runtime_error& e) {
+                    why = e.what();
+                }
+                ms = elapsed_ms(t0);
+            }
+            const int failed = reap(pids);
+            std::cout << "worker failed after SPLIT: coordinator \"" << why << "\" after " << ms << " ms, "
+                      << failed << " worker(s) failed\n";
+            ok = ok && why.find("injected") != std::string::npos && ms < 10000.0 && failed == 2;
+        }
+        std::filesystem::remove(file_in);
+        ok = ok && !std::filesystem::exists("xisort_dist_test.sock");
+        std::cout << (ok ? "status: OK\n" : "status: FAIL\n");
+    }
+#endif
+
     // ── Test-3 : external 100 GB file sort (disk) ───────────────────
     if (!small) {
         std::cout << "\n[Test-3] external " << EXTERNAL_SIZE_GB
@@ -113,20 +1386,9 @@ int main(int argc, char** argv)
             (EXTERNAL_SIZE_GB * 1024ULL * 1024ULL * 1024ULL) / sizeof(double);
         if (!std::filesystem::exists(file_in)) {
             std::cout << "  Generating input file… (one-time)\n";
-            std::ofstream fout(file_in, std::ios::binary);
-            std::mt19937_64 rng(777);
-            std::uniform_real_distribution<double> dist(-1.0, 1.0);
-            std::vector<double> buf(BUFFER_ELEMS);
-            uint64_t written = 0;
-            while (written < elems) {
-                std::size_t chunk =
-                    std::min<uint64_t>(BUFFER_ELEMS, elems - written);
-                for (std::size_t i = 0; i < chunk; ++i) buf[i] = dist(rng);
-                fout.write(reinterpret_cast<char*>(buf.data()),
-                           chunk * sizeof(double));
-                written += chunk;
-            }
-            fout.close();
+            auto tg = std::chrono::steady_clock::now();
+            xi_gen_file(file_in, XI_GEN_UNIFORM, 777, elems);
+            std::cout << "  generated in " << elapsed_ms(tg) / 1000.0 << " s\n";
         }
 
         /* B. call external CLI sorter ------------------------------ */